@@ -21,6 +21,9 @@
 #include "lemon/translator/Nativizer.h"
 #include "lemon/translator/Translator.h"
 
+#include <atomic>
+#include <thread>
+
 
 namespace lemon
 {
@@ -33,6 +36,26 @@ namespace lemon
 			node.setLineNumber(lineNumber);
 			return node;
 		}
+
+		bool hasLocalConstantDefinitions(const BlockNode& blockNode)
+		{
+			for (size_t i = 0; i < blockNode.mNodes.size(); ++i)
+			{
+				const Node& node = blockNode.mNodes[i];
+				if (node.getType() == Node::Type::BLOCK)
+				{
+					if (hasLocalConstantDefinitions(node.as<BlockNode>()))
+						return true;
+				}
+				else if (node.getType() == Node::Type::UNDEFINED)
+				{
+					const TokenList& tokens = node.as<UndefinedNode>().mTokenList;
+					if (!tokens.empty() && isKeyword(tokens[0], Keyword::CONSTANT))
+						return true;
+				}
+			}
+			return false;
+		}
 	}
 
 
@@ -143,10 +166,7 @@ namespace lemon
 			processGlobalDefinitions(rootNode);
 
 			// Process and compile function contents
-			for (FunctionNode* node : mFunctionNodes)
-			{
-				processSingleFunction(*node);
-			}
+			processFunctionContents();
 
 		#if 0
 			// Just for debugging: Build compiled hash
@@ -712,14 +732,88 @@ namespace lemon
 		return function;
 	}
 
-	void Compiler::processSingleFunction(FunctionNode& functionNode)
+	void Compiler::processFunctionContents()
+	{
+		// Errors get collected per function, and the one of the first failed function in source order gets reported
+		//  -> That's the same error that a purely sequential compilation would report, regardless of which thread finished first
+		std::vector<std::exception_ptr> exceptions(mFunctionNodes.size());
+
+		// Local constant arrays get registered in the module, so functions defining local constants are compiled first, in their original order
+		//  -> This way, constant array IDs are the same as with a purely sequential compilation
+		std::vector<size_t> independentFunctionIndices;
+		independentFunctionIndices.reserve(mFunctionNodes.size());
+		for (size_t index = 0; index < mFunctionNodes.size(); ++index)
+		{
+			if (hasLocalConstantDefinitions(*mFunctionNodes[index]->mContent))
+			{
+				try
+				{
+					processSingleFunction(*mFunctionNodes[index], mTokenProcessing);
+				}
+				catch (...)
+				{
+					exceptions[index] = std::current_exception();
+				}
+			}
+			else
+			{
+				independentFunctionIndices.push_back(index);
+			}
+		}
+
+		// All other functions only depend on the global definitions and can be compiled in parallel
+		//  -> Each task is one worker loop with its own token processing instance, picking the next function not processed yet
+		const size_t numThreads = std::min<size_t>(std::thread::hardware_concurrency(), independentFunctionIndices.size() / 32);
+		std::atomic<size_t> nextIndex = 0;
+		const auto processFunctions = [&](TokenProcessing& tokenProcessing)
+		{
+			while (true)
+			{
+				const size_t index = nextIndex++;
+				if (index >= independentFunctionIndices.size())
+					break;
+
+				const size_t functionIndex = independentFunctionIndices[index];
+				try
+				{
+					processSingleFunction(*mFunctionNodes[functionIndex], tokenProcessing);
+				}
+				catch (...)
+				{
+					exceptions[functionIndex] = std::current_exception();
+				}
+			}
+		};
+
+		if (numThreads < 2)
+		{
+			processFunctions(mTokenProcessing);
+		}
+		else
+		{
+			WorkerPool workerPool(numThreads - 1);
+			workerPool.execute(numThreads, [&](size_t taskIndex)
+			{
+				TokenProcessing tokenProcessing(mGlobalsLookup, mCompileOptions);
+				processFunctions(tokenProcessing);
+			});
+		}
+
+		for (const std::exception_ptr& exception : exceptions)
+		{
+			if (nullptr != exception)
+				std::rethrow_exception(exception);
+		}
+	}
+
+	void Compiler::processSingleFunction(FunctionNode& functionNode, TokenProcessing& tokenProcessing)
 	{
 		BlockNode& content = *functionNode.mContent;
 		ScriptFunction& function = *functionNode.mFunction;
 		function.mStartLineNumber = functionNode.getLineNumber();
 
 		// Build scope context for processing
-		ScopeContext scopeContext;
+		ScopeContext scopeContext(tokenProcessing);
 		for (LocalVariable* localVariable : function.mLocalVariablesByID)
 		{
 			// All local variables so far have to be parameters; add each to the scope
@@ -1096,11 +1190,12 @@ namespace lemon
 
 	void Compiler::processTokens(TokenList& tokens, ScriptFunction& function, ScopeContext& scopeContext, uint32 lineNumber, const DataTypeDefinition* resultType)
 	{
-		mTokenProcessing.mContext.mFunction = &function;
-		mTokenProcessing.mContext.mLocalVariables = &scopeContext.mLocalVariables;
-		mTokenProcessing.mContext.mLocalConstants = &scopeContext.mLocalConstants;
-		mTokenProcessing.mContext.mLocalConstantArrays = &scopeContext.mLocalConstantArrays;
-		mTokenProcessing.processTokens(tokens, lineNumber, resultType);
+		TokenProcessing& tokenProcessing = scopeContext.mTokenProcessing;
+		tokenProcessing.mContext.mFunction = &function;
+		tokenProcessing.mContext.mLocalVariables = &scopeContext.mLocalVariables;
+		tokenProcessing.mContext.mLocalConstants = &scopeContext.mLocalConstants;
+		tokenProcessing.mContext.mLocalConstantArrays = &scopeContext.mLocalConstantArrays;
+		tokenProcessing.processTokens(tokens, lineNumber, resultType);
 	}
 
 	void Compiler::processConstantDefinition(TokenList& tokens, NodesIterator& nodesIterator, ScopeContext* scopeContext)
@@ -1120,7 +1215,7 @@ namespace lemon
 			CHECK_ERROR(tokens[5].getType() == Token::Type::IDENTIFIER, "Expected identifier in constant array definition", lineNumber);
 			CHECK_ERROR(isOperator(tokens[6], Operator::ASSIGN), "Expected assignment at the end of constant array definition", lineNumber);
 
-			static std::vector<uint64> values;
+			static thread_local std::vector<uint64> values;
 			values.clear();
 			values.reserve(0x20);
 
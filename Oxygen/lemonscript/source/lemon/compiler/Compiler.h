@@ -64,8 +64,10 @@ namespace lemon
 			std::vector<Constant> mLocalConstants;
 			std::vector<ConstantArray*> mLocalConstantArrays;
 			std::vector<StackItem> mScopeStack;			// Number of local variables for each scope on the stack
+			TokenProcessing& mTokenProcessing;			// Each thread compiling functions uses its own instance
 
-			ScopeContext()
+			explicit ScopeContext(TokenProcessing& tokenProcessing) :
+				mTokenProcessing(tokenProcessing)
 			{
 				mScopeStack.reserve(4);
 			}
@@ -99,7 +101,8 @@ namespace lemon
 		// Node processing
 		void processGlobalDefinitions(BlockNode& rootNode);
 		ScriptFunction& processFunctionHeader(Node& node, const TokenList& tokens);
-		void processSingleFunction(FunctionNode& functionNode);
+		void processFunctionContents();
+		void processSingleFunction(FunctionNode& functionNode, TokenProcessing& tokenProcessing);
 		void processUndefinedNodesInBlock(BlockNode& blockNode, ScriptFunction& function, ScopeContext& scopeContext);
 		Node* processUndefinedNode(UndefinedNode& undefinedNode, ScriptFunction& function, ScopeContext& scopeContext, NodesIterator& nodesIterator);
 		Node* gatherNextStatement(NodesIterator& nodesIterator, ScriptFunction& function, ScopeContext& scopeContext);
@@ -793,7 +793,7 @@ namespace lemon
 			anotherRun = false;
 
 			// Build up a list of jump targets
-			static std::vector<bool> isOpcodeJumpTarget;
+			static thread_local std::vector<bool> isOpcodeJumpTarget;
 			{
 				isOpcodeJumpTarget.clear();
 				isOpcodeJumpTarget.resize(mOpcodes.size(), false);
@@ -978,7 +978,7 @@ namespace lemon
 				mOpcodes[i].mFlags |= Opcode::Flag::TEMP_FLAG;
 			}
 
-			static std::vector<size_t> openSeeds;
+			static thread_local std::vector<size_t> openSeeds;
 			openSeeds.clear();
 			openSeeds.push_back(0);
 			for (const ScriptFunction::Label& label : mFunction.mLabels)
@@ -1070,7 +1070,7 @@ namespace lemon
 	void FunctionCompiler::cleanupNOPs()
 	{
 		// Remove all NOPs and update all jump targets etc. appropriately
-		static std::vector<int> indexRemap;
+		static thread_local std::vector<int> indexRemap;
 		indexRemap.clear();
 		indexRemap.resize(mOpcodes.size());
 		size_t newSize = 0;
@@ -9,6 +9,8 @@
 #pragma once
 
 #include <rmxbase.h>
+#include <atomic>
+#include <mutex>
 
 
 namespace genericmanager
@@ -58,7 +60,7 @@ namespace genericmanager
 
 	private:
 		const Type mType;
-		uint32 mReferenceCounter = 0;
+		uint32 mReferenceCounter = 0;	// Not thread-safe, elements must never be shared between threads (see "insertDefineToken")
 	};
 
 
@@ -80,12 +82,35 @@ namespace genericmanager
 		class ElementFactory : public ElementFactoryBase<ELEMENT>
 		{
 		public:
-			inline ELEMENT& create() override  { return mElementPool.createObject(); }
-			inline void destroy(ELEMENT& element) override  { mElementPool.destroyObject(static_cast<T&>(element)); }
-			inline void shrinkPool() override  { mElementPool.shrink(); }
+			ELEMENT& create() override
+			{
+				// Only taking the memory from the pool needs to be locked, not the construction
+				T* object;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					object = &mElementPool.allocObject();
+				}
+				return *new (static_cast<void*>(object)) T();
+			}
+
+			void destroy(ELEMENT& element) override
+			{
+				// Destruction can release further elements, possibly of the same type, so do it outside of the lock
+				T& object = static_cast<T&>(element);
+				object.~T();
+				std::lock_guard<std::mutex> lock(mMutex);
+				mElementPool.freeObject(object);
+			}
+
+			void shrinkPool() override
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mElementPool.shrink();
+			}
 
 		private:
-			ObjectPool<T, 256> mElementPool;
+			PodStructPool<T, 256> mElementPool;		// Used as a pure memory pool, construction and destruction are done by the factory
+			std::mutex mMutex;						// One lock per element type, only held for taking or returning memory
 		};
 
 
@@ -104,20 +129,24 @@ namespace genericmanager
 				if (type < 0x80)
 				{
 					// Use std::vector
-					if (nullptr != mClassFactoriesList[type])
-					{
-						return *mClassFactoriesList[type];
-					}
-					else
+					//  -> Factories never get removed, so only their creation needs to be locked
+					FactoryBase* factory = mClassFactoriesList[type].load(std::memory_order_acquire);
+					if (nullptr == factory)
 					{
-						FactoryBase* factory = new ElementFactory<ELEMENT, T>();
-						mClassFactoriesList[type] = factory;
-						return *factory;
+						std::lock_guard<std::mutex> lock(mMutex);
+						factory = mClassFactoriesList[type].load(std::memory_order_relaxed);
+						if (nullptr == factory)
+						{
+							factory = new ElementFactory<ELEMENT, T>();
+							mClassFactoriesList[type].store(factory, std::memory_order_release);
+						}
 					}
+					return *factory;
 				}
 				else
 				{
 					// Use std::map
+					std::lock_guard<std::mutex> lock(mMutex);
 					const auto it = mClassFactoriesMap.find(type);
 					if (it != mClassFactoriesMap.end())
 					{
@@ -137,13 +166,15 @@ namespace genericmanager
 				const uint32 type = (uint32)type_;
 				if (type < 0x80)
 				{
-					if (nullptr != mClassFactoriesList[type])
+					FactoryBase* factory = mClassFactoriesList[type].load(std::memory_order_acquire);
+					if (nullptr != factory)
 					{
-						return *mClassFactoriesList[type];
+						return *factory;
 					}
 				}
 				else
 				{
+					std::lock_guard<std::mutex> lock(mMutex);
 					const auto it = mClassFactoriesMap.find(type);
 					if (it != mClassFactoriesMap.end())
 					{
@@ -159,9 +190,11 @@ namespace genericmanager
 			{
 				for (size_t index = 0; index < 0x80; ++index)
 				{
-					if (nullptr != mClassFactoriesList[index])
-						mClassFactoriesList[index]->shrinkPool();
+					FactoryBase* factory = mClassFactoriesList[index].load(std::memory_order_acquire);
+					if (nullptr != factory)
+						factory->shrinkPool();
 				}
+				std::lock_guard<std::mutex> lock(mMutex);
 				for (const auto& pair : mClassFactoriesMap)
 				{
 					pair.second->shrinkPool();
@@ -169,8 +202,9 @@ namespace genericmanager
 			}
 
 		private:
-			FactoryBase* mClassFactoriesList[0x80] = { nullptr };	// Used for types that are less than 0x80 as unsigned integer
-			std::map<uint32, FactoryBase*> mClassFactoriesMap;		// Used for types that are 0x80 or higher as unsigned integer
+			std::atomic<FactoryBase*> mClassFactoriesList[0x80] = { };	// Used for types that are less than 0x80 as unsigned integer
+			std::map<uint32, FactoryBase*> mClassFactoriesMap;			// Used for types that are 0x80 or higher as unsigned integer
+			std::mutex mMutex;											// Only for creation of factories and access to the map
 		};
 	}
 
@@ -207,7 +241,7 @@ namespace genericmanager
 		}
 
 	private:
-		static inline detail::ElementFactoryMap<ELEMENT> mFactoryMap;
+		static inline detail::ElementFactoryMap<ELEMENT> mFactoryMap;	// Thread-safe, as elements get created and destroyed by multiple threads during parallel compilation
 	};
 
 
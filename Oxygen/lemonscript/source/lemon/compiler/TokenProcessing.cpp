@@ -21,6 +21,52 @@ namespace lemon
 
 	namespace
 	{
+		void insertDefineToken(TokenList& tokens, Token& token, size_t index)
+		{
+			// Define contents are shared by all usages, but tokens get modified during processing (e.g. their data type gets set)
+			//  -> Always insert copies, so that multiple functions can be processed at the same time without sharing any tokens or reference counters
+			switch (token.getType())
+			{
+				case Token::Type::KEYWORD:
+					tokens.createAt<KeywordToken>(index).mKeyword = token.as<KeywordToken>().mKeyword;
+					break;
+
+				case Token::Type::VARTYPE:
+					tokens.createAt<VarTypeToken>(index).mDataType = token.as<VarTypeToken>().mDataType;
+					break;
+
+				case Token::Type::OPERATOR:
+					tokens.createAt<OperatorToken>(index).mOperator = token.as<OperatorToken>().mOperator;
+					break;
+
+				case Token::Type::CONSTANT:
+				{
+					ConstantToken& newToken = tokens.createAt<ConstantToken>(index);
+					newToken.mValue = token.as<ConstantToken>().mValue;
+					newToken.mDataType = token.as<ConstantToken>().mDataType;
+					break;
+				}
+
+				case Token::Type::IDENTIFIER:
+				{
+					IdentifierToken& newToken = tokens.createAt<IdentifierToken>(index);
+					newToken.mName = token.as<IdentifierToken>().mName;
+					newToken.mResolved = token.as<IdentifierToken>().mResolved;
+					newToken.mDataType = token.as<IdentifierToken>().mDataType;
+					break;
+				}
+
+				case Token::Type::LABEL:
+					tokens.createAt<LabelToken>(index).mName = token.as<LabelToken>().mName;
+					break;
+
+				default:
+					// Define contents only consist of the token types created in "Compiler::buildNodesFromCodeLines"
+					RMX_ERROR("Unsupported token type in define content", );
+					break;
+			}
+		}
+
 		std::string getOperatorNotAllowedErrorMessage(Operator op)
 		{
 			if (op >= Operator::UNARY_NOT && op <= Operator::UNARY_INCREMENT)
@@ -196,7 +242,7 @@ namespace lemon
 					tokens.erase(i);
 					for (size_t k = 0; k < define.mContent.size(); ++k)
 					{
-						tokens.insert(define.mContent[k], i + k);
+						insertDefineToken(tokens, define.mContent[k], i + k);
 					}
 
 					// TODO: Add implicit cast if necessary
@@ -247,7 +293,7 @@ namespace lemon
 
 	void TokenProcessing::processParentheses(TokenList& tokens)
 	{
-		static std::vector<std::pair<ParenthesisType, size_t>> parenthesisStack;	// Not multi-threading safe
+		static thread_local std::vector<std::pair<ParenthesisType, size_t>> parenthesisStack;
 		parenthesisStack.clear();
 		for (size_t i = 0; i < tokens.size(); ++i)
 		{
@@ -307,7 +353,7 @@ namespace lemon
 		}
 
 		// Find comma positions
-		static std::vector<size_t> commaPositions;	// Not multi-threading safe
+		static thread_local std::vector<size_t> commaPositions;
 		commaPositions.clear();
 		for (size_t i = 0; i < tokens.size(); ++i)
 		{
@@ -591,7 +637,7 @@ namespace lemon
 				tokens.erase(i+1);
 
 				// Assign types
-				static std::vector<const DataTypeDefinition*> parameterTypes;	// Not multi-threading safe
+				static thread_local std::vector<const DataTypeDefinition*> parameterTypes;
 				parameterTypes.resize(functionToken.mParameters.size());
 				for (size_t i = 0; i < functionToken.mParameters.size(); ++i)
 				{
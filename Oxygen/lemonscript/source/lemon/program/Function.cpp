@@ -95,9 +95,11 @@ namespace lemon
 
 	uint32 Function::getSignatureHash() const
 	{
-		if (mSignatureHash == 0)
+		uint32 signatureHash = mSignatureHash.load(std::memory_order_relaxed);
+		if (signatureHash == 0)
 		{
-			static std::vector<uint32> data;
+			// Threads racing here all calculate the same hash, so it does not matter which one stores it
+			static thread_local std::vector<uint32> data;
 			data.clear();
 			data.push_back(mReturnType->getDataTypeHash());
 			for (const Parameter& parameter : mParameters)
@@ -105,14 +107,15 @@ namespace lemon
 				data.push_back(parameter.mDataType->getDataTypeHash());
 			}
 
-			mSignatureHash = rmx::getFNV1a_32((const uint8*)&data[0], data.size() * sizeof(uint32));
-			while (mSignatureHash == 0)		// That should be a really rare case anyway
+			signatureHash = rmx::getFNV1a_32((const uint8*)&data[0], data.size() * sizeof(uint32));
+			while (signatureHash == 0)		// That should be a really rare case anyway
 			{
 				data.push_back(0xcd000000);		// Just add anything to get away from hash 0
-				mSignatureHash = rmx::getFNV1a_32((const uint8*)&data[0], data.size() * sizeof(uint32));
+				signatureHash = rmx::getFNV1a_32((const uint8*)&data[0], data.size() * sizeof(uint32));
 			}
+			mSignatureHash.store(signatureHash, std::memory_order_relaxed);
 		}
-		return mSignatureHash;
+		return signatureHash;
 	}
 
 
@@ -222,12 +225,16 @@ namespace lemon
 
 	uint64 ScriptFunction::addToCompiledHash(uint64 hash) const
 	{
+		// Only include the opcode flags that runtime opcodes get built from, as these are also the only ones that survive module serialization
+		const uint8 RELEVANT_FLAGS = Opcode::Flag::CTRLFLOW | Opcode::Flag::SEQ_BREAK;
+
 		detail::QuickDataHasher dataHasher(hash);
 		for (const Opcode& opcode : mOpcodes)
 		{
-			dataHasher.prepareNextData(10);
+			dataHasher.prepareNextData(11);
 			dataHasher.addData((uint8)opcode.mType);
 			dataHasher.addData((uint8)opcode.mDataType);
+			dataHasher.addData((uint8)(opcode.mFlags & RELEVANT_FLAGS));
 			if (opcode.mParameter != 0)
 				dataHasher.addData((uint64)opcode.mParameter);
 		}
@@ -12,6 +12,7 @@
 #include "lemon/program/SourceFileInfo.h"
 #include "lemon/program/Variable.h"
 #include "lemon/utility/FlyweightString.h"
+#include <atomic>
 
 
 namespace lemon
@@ -81,7 +82,7 @@ namespace lemon
 		// Signature
 		const DataTypeDefinition* mReturnType = &PredefinedDataTypes::VOID;
 		ParameterList mParameters;
-		mutable uint32 mSignatureHash = 0;
+		mutable std::atomic<uint32> mSignatureHash = 0;	// Gets built on demand, possibly by multiple threads compiling functions at the same time
 	};
 
 
@@ -309,11 +309,13 @@ namespace lemon
 
 	LocalVariable& Module::createLocalVariable()
 	{
+		std::lock_guard<std::mutex> lock(mLocalVariablesPoolMutex);
 		return mLocalVariablesPool.createObject();
 	}
 
 	void Module::destroyLocalVariable(LocalVariable& variable)
 	{
+		std::lock_guard<std::mutex> lock(mLocalVariablesPoolMutex);
 		mLocalVariablesPool.destroyObject(variable);
 	}
 
@@ -369,6 +371,65 @@ namespace lemon
 		return (uint32)(mFunctions.size() + mGlobalVariables.size() + mConstants.size() + mConstantArrays.size() + mDefines.size() + mStringLiterals.size());
 	}
 
+	uint64 Module::buildDefinitionsHash()
+	{
+		// Other than "buildDependencyHash", this covers everything that code in modules compiled after this one can refer to
+		//  -> Script function contents don't affect the compilation of other modules, so they are not part of this
+		std::vector<uint8> buffer;
+		VectorBinarySerializer serializer(false, buffer);
+		serializer.write(mFirstFunctionID);
+		serializer.write(mFirstVariableID);
+		serializer.write(mFirstConstantArrayID);
+
+		for (const Constant* constant : mPreprocessorDefinitions)
+		{
+			serializer.write(constant->getName().getHash());
+			serializer.write(constant->mValue);
+		}
+
+		for (const Function* function : mFunctions)
+		{
+			serializer.writeAs<uint8>(function->getType());
+			serializer.write(function->getNameAndSignatureHash());
+		}
+
+		for (const Variable* variable : mGlobalVariables)
+		{
+			serializer.write(variable->getName().getHash());
+			serializer.write(variable->getID());
+			DataTypeSerializer::writeDataType(serializer, variable->getDataType());
+		}
+
+		for (const Constant* constant : mConstants)
+		{
+			serializer.write(constant->getName().getHash());
+			DataTypeSerializer::writeDataType(serializer, constant->getDataType());
+			serializer.write(constant->mValue);
+		}
+
+		serializer.writeAs<uint16>(mNumGlobalConstantArrays);
+		for (ConstantArray* constantArray : mConstantArrays)
+		{
+			serializer.write(constantArray->getName().getHash());
+			DataTypeSerializer::writeDataType(serializer, constantArray->getElementDataType());
+			constantArray->serializeData(serializer);
+		}
+
+		for (Define* define : mDefines)
+		{
+			serializer.write(define->getName().getHash());
+			DataTypeSerializer::writeDataType(serializer, define->getDataType());
+			TokenSerializer::serializeTokenList(serializer, define->mContent);
+		}
+
+		for (FlyweightString str : mStringLiterals)
+		{
+			serializer.write(str.getHash());
+		}
+
+		return rmx::getFNV1a_64(buffer.data(), buffer.size());
+	}
+
 	bool Module::serialize(VectorBinarySerializer& outerSerializer, uint32 dependencyHash, uint32 appVersion)
 	{
 		// Format version history:
@@ -385,11 +446,12 @@ namespace lemon
 		//  - 0x0a = Added dependency hash
 		//  - 0x0b = Added app version
 		//  - 0x0c = Added address hook serialization
+		//  - 0x0d = Added first constant array ID
 
 		// Signature and version number
 		const uint32 SIGNATURE = *(uint32*)"LMD|";
 		const uint16 MINIMUM_VERSION = 0x0c;
-		uint16 version = 0x0c;
+		uint16 version = 0x0d;
 
 		if (outerSerializer.isReading())
 		{
@@ -431,6 +493,8 @@ namespace lemon
 		// Serialize module
 		serializer & mFirstFunctionID;
 		serializer & mFirstVariableID;
+		if (version >= 0x0d)
+			serializer & mFirstConstantArrayID;
 
 		// Serialize source file info
 		{
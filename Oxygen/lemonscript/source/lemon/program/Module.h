@@ -14,6 +14,7 @@
 #include "lemon/program/Function.h"
 #include "lemon/program/SourceFileInfo.h"
 #include "lemon/program/StringRef.h"
+#include <mutex>
 #include <unordered_map>
 
 
@@ -41,6 +42,7 @@ namespace lemon
 
 		void dumpDefinitionsToScriptFile(const std::wstring& filename);
 
+		inline const std::vector<SourceFileInfo*>& getSourceFileInfos() const  { return mAllSourceFiles; }
 		const SourceFileInfo& addSourceFileInfo(const std::wstring& basepath, const std::wstring& filename);
 
 		// Preprocessor definitions
@@ -77,6 +79,7 @@ namespace lemon
 
 		// Serialization
 		uint32 buildDependencyHash() const;
+		uint64 buildDefinitionsHash();
 		bool serialize(VectorBinarySerializer& serializer, uint32 dependencyHash, uint32 appVersion);
 
 		inline uint64 getCompiledCodeHash() const     { return mCompiledCodeHash; }
@@ -106,6 +109,7 @@ namespace lemon
 		uint32 mFirstVariableID = 0;
 		std::vector<Variable*> mGlobalVariables;
 		ObjectPool<LocalVariable, 16> mLocalVariablesPool;
+		std::mutex mLocalVariablesPoolMutex;		// Functions of a module can get compiled in parallel
 
 		// Constants
 		std::vector<Constant*> mConstants;
@@ -45,7 +45,7 @@ namespace lemon
 			RMX_CHECK(str1.isValid(), "Unable to resolve string", return StringRef());
 			RMX_CHECK(str2.isValid(), "Unable to resolve string", return StringRef());
 
-			static detail::FastStringStream result;
+			static thread_local detail::FastStringStream result;
 			result.clear();
 			result.addString(str1.getStringRef());
 			result.addString(str2.getStringRef());
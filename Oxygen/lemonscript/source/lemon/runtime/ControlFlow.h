@@ -24,6 +24,8 @@ namespace lemon
 	friend class Runtime;
 	friend class OpcodeExec;
 	friend class OptimizedOpcodeExec;
+	friend class RegisterOpcodeExec;
+	friend class JitOpcodeExec;
 	friend struct RuntimeOpcodeContext;
 
 	public:
@@ -10,6 +10,7 @@
 #include "lemon/runtime/Runtime.h"
 #include "lemon/runtime/RuntimeFunction.h"
 #include "lemon/runtime/RuntimeOpcodeContext.h"
+#include "lemon/runtime/provider/JitOpcodeProvider.h"
 #include "lemon/program/Program.h"
 #include "lemon/program/StringRef.h"
 
@@ -118,6 +119,7 @@ namespace lemon
 		{
 			delete controlFlow;
 		}
+		delete mJitOpcodeProvider;
 	}
 
 	void Runtime::reset()
@@ -132,6 +134,8 @@ namespace lemon
 		mRuntimeFunctionsMapped.clear();
 		mRuntimeFunctionsBySignature.clear();
 		mRuntimeOpcodesPool.clear();
+		if (nullptr != mJitOpcodeProvider)
+			mJitOpcodeProvider->clear();
 		mStrings.clear();
 
 		if (nullptr != mProgram)
@@ -164,6 +168,18 @@ namespace lemon
 			controlFlow->mProgram = &program;
 		}
 
+		// JIT compilation of hot functions is only used with the highest optimization level
+		if (program.getOptimizationLevel() >= 5 && JitOpcodeProvider::isSupported())
+		{
+			if (nullptr == mJitOpcodeProvider)
+				mJitOpcodeProvider = new JitOpcodeProvider();
+		}
+		else
+		{
+			delete mJitOpcodeProvider;
+			mJitOpcodeProvider = nullptr;
+		}
+
 		reset();
 
 		// Assign initial values to global variables
@@ -183,6 +199,50 @@ namespace lemon
 		}
 	}
 
+	void Runtime::reloadProgram(const Program& program)
+	{
+		// Keep the previously built runtime functions and their memory until the new ones are set up
+		std::vector<RuntimeFunction> previousRuntimeFunctions;
+		previousRuntimeFunctions.swap(mRuntimeFunctions);
+		rmx::OneTimeAllocPool previousRuntimeOpcodesPool;
+		previousRuntimeOpcodesPool.swap(mRuntimeOpcodesPool);
+		mRuntimeOpcodesPool.setPageSize(0x40000);
+		JitOpcodeProvider previousJitCode;
+		if (nullptr != mJitOpcodeProvider)
+			previousJitCode.takeCodeFrom(*mJitOpcodeProvider);
+		const int64* previousGlobalVariables = mGlobalVariables.data();
+
+		setProgram(program);
+
+		// Runtime opcodes can contain direct pointers to global variable values, so reuse is only possible if these stayed the same
+		if (mGlobalVariables.data() != previousGlobalVariables)
+			return;
+
+		std::unordered_map<uint64, const RuntimeFunction*> previousByHash;
+		for (const RuntimeFunction& runtimeFunction : previousRuntimeFunctions)
+		{
+			if (!runtimeFunction.mRuntimeOpcodeBuffer.empty())
+				previousByHash[runtimeFunction.mCompiledHash] = &runtimeFunction;
+		}
+
+		for (RuntimeFunction& runtimeFunction : mRuntimeFunctions)
+		{
+			if (runtimeFunction.mFunction->mOpcodes.empty())
+				continue;
+
+			const uint64 compiledHash = runtimeFunction.mFunction->addToCompiledHash(rmx::startFNV1a_64() + program.getOptimizationLevel());
+			const auto it = previousByHash.find(compiledHash);
+			if (it != previousByHash.end() && it->second->mProgramCounterByOpcodeIndex.size() == runtimeFunction.mFunction->mOpcodes.size())
+			{
+				runtimeFunction.buildFrom(*it->second, *this);
+			}
+		}
+
+		// Reused runtime functions may point to JIT compiled code, so keep it alive
+		if (nullptr != mJitOpcodeProvider)
+			mJitOpcodeProvider->takeCodeFrom(previousJitCode);
+	}
+
     void Runtime::setMemoryAccessHandler(MemoryAccessHandler* handler)
 	{
 		mMemoryAccessHandler = handler;
@@ -208,6 +268,25 @@ namespace lemon
 		}
 	}
 
+	void Runtime::getCalledRuntimeFunctions(std::vector<uint64>& outNameAndSignatureHashes) const
+	{
+		// Collect all functions that actually got called, not the ones that were only built in advance, most called ones first
+		std::vector<const RuntimeFunction*> calledFunctions;
+		for (const RuntimeFunction& runtimeFunction : mRuntimeFunctions)
+		{
+			if (runtimeFunction.mCallCount > 0)
+				calledFunctions.push_back(&runtimeFunction);
+		}
+		std::stable_sort(calledFunctions.begin(), calledFunctions.end(), [](const RuntimeFunction* a, const RuntimeFunction* b) { return a->mCallCount > b->mCallCount; });
+
+		outNameAndSignatureHashes.clear();
+		outNameAndSignatureHashes.reserve(calledFunctions.size());
+		for (const RuntimeFunction* runtimeFunction : calledFunctions)
+		{
+			outNameAndSignatureHashes.push_back(runtimeFunction->mFunction->getNameAndSignatureHash());
+		}
+	}
+
 	RuntimeFunction* Runtime::getRuntimeFunction(const ScriptFunction& scriptFunction)
 	{
 		const auto it = mRuntimeFunctionsMapped.find(&scriptFunction);
@@ -272,6 +351,33 @@ namespace lemon
 
 	void Runtime::callFunction(const RuntimeFunction& runtimeFunction, size_t baseCallIndex)
 	{
+		// Call counts are only needed for JIT compilation and the hot functions profile, so don't write to the runtime function otherwise
+		if (nullptr != mJitOpcodeProvider || mRecordCallCounts)
+		{
+			RuntimeFunction& hotFunction = const_cast<RuntimeFunction&>(runtimeFunction);
+			if (hotFunction.mCallCount < 0xffffffff)	// Saturate instead of wrapping around in long sessions
+				++hotFunction.mCallCount;
+
+			if (hotFunction.mCallCount >= hotFunction.mNextJitCheckCallCount && nullptr != mJitOpcodeProvider && !runtimeFunction.mJitCompiled)
+			{
+				// Rebuilding is only possible if no call stack is still executing the current runtime opcodes, otherwise try again later
+				//  -> Call stacks only get checked at these thresholds, not on each call
+				bool isExecuting = false;
+				for (const ControlFlow* controlFlow : mControlFlows)
+				{
+					for (size_t k = 0; k < controlFlow->mCallStack.count; ++k)
+					{
+						isExecuting |= (controlFlow->mCallStack[k].mRuntimeFunction == &runtimeFunction);
+					}
+				}
+
+				if (isExecuting)
+					hotFunction.mNextJitCheckCallCount = std::min(hotFunction.mCallCount, 0xffffffff - RuntimeFunction::JIT_CALL_COUNT_THRESHOLD) + RuntimeFunction::JIT_CALL_COUNT_THRESHOLD;
+				else
+					hotFunction.rebuildWithJit(*this);
+			}
+		}
+
 		// Push new state to call stack
 		ControlFlow::State& state = *mSelectedControlFlow->mCallStack.add();
 		state.mRuntimeFunction = &runtimeFunction;
@@ -18,6 +18,7 @@ namespace lemon
 	class Program;
 	class NativeFunction;
 	class Variable;
+	class JitOpcodeProvider;
 	struct RuntimeOpcode;
 
 
@@ -35,6 +36,7 @@ namespace lemon
 
 			Result mResult = Result::NO_SPECIALIZATION;
 			uint8* mDirectAccessPointer = nullptr;
+			uint8* mDirtyFlagPointer = nullptr;		// Only for write access: If set, this byte has to be set to 1 on each write, for dirty page tracking
 			bool mSwapBytes = false;
 		};
 
@@ -117,6 +119,7 @@ namespace lemon
 
 		inline const Program& getProgram() const  { return *mProgram; }
 		void setProgram(const Program& program);
+		void reloadProgram(const Program& program);		// Like "setProgram", but keeps the runtime functions of all script functions that did not change
 
 		inline MemoryAccessHandler* getMemoryAccessHandler() const  { return mMemoryAccessHandler; }
 		void setMemoryAccessHandler(MemoryAccessHandler* handler);
@@ -125,6 +128,10 @@ namespace lemon
 		void setRuntimeDetailHandler(RuntimeDetailHandler* handler);
 
 		void buildAllRuntimeFunctions();
+		void getCalledRuntimeFunctions(std::vector<uint64>& outNameAndSignatureHashes) const;
+
+		inline bool getRecordCallCounts() const  { return mRecordCallCounts; }
+		inline void setRecordCallCounts(bool enable)  { mRecordCallCounts = enable; }
 
 		RuntimeFunction* getRuntimeFunction(const ScriptFunction& scriptFunction);
 		RuntimeFunction* getRuntimeFunctionBySignature(uint64 signatureHash, size_t index = 0);
@@ -154,8 +161,8 @@ namespace lemon
 		bool serializeState(VectorBinarySerializer& serializer, std::string* outError = nullptr);
 
 	private:
-		inline static ControlFlow* mActiveControlFlow = nullptr;
-		inline static const Environment* mActiveEnvironment = nullptr;
+		inline static thread_local ControlFlow* mActiveControlFlow = nullptr;
+		inline static thread_local const Environment* mActiveEnvironment = nullptr;
 
 	private:
 		const Program* mProgram = nullptr;
@@ -166,6 +173,8 @@ namespace lemon
 		std::unordered_map<const ScriptFunction*, RuntimeFunction*> mRuntimeFunctionsMapped;
 		std::unordered_map<uint64, std::vector<RuntimeFunction*>> mRuntimeFunctionsBySignature;   // Key is the hashed function name + signature hash
 		rmx::OneTimeAllocPool mRuntimeOpcodesPool;
+		JitOpcodeProvider* mJitOpcodeProvider = nullptr;	// Only created for optimization level 5 on supported platforms
+		bool mRecordCallCounts = false;						// Count calls of all runtime functions, for "getCalledRuntimeFunctions"; this is done anyways if JIT compilation is active
 
 		std::vector<int64> mGlobalVariables;
 
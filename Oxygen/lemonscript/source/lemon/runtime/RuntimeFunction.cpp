@@ -13,7 +13,9 @@
 #include "lemon/runtime/OpcodeProcessor.h"
 #include "lemon/runtime/provider/DefaultOpcodeProvider.h"
 #include "lemon/runtime/provider/OptimizedOpcodeProvider.h"
+#include "lemon/runtime/provider/RegisterOpcodeProvider.h"
 #include "lemon/runtime/provider/NativizedOpcodeProvider.h"
+#include "lemon/runtime/provider/JitOpcodeProvider.h"
 #include "lemon/program/Program.h"
 
 
@@ -69,13 +71,17 @@ namespace lemon
 
 	void RuntimeOpcodeBuffer::copyFrom(const RuntimeOpcodeBuffer& other, rmx::OneTimeAllocPool& memoryPool)
 	{
-		if (mSelfManagedBuffer)
-			delete[] mBuffer;
+		// When rebuilding, reuse the memory already taken from the pool if it is large enough, as the pool never frees single allocations
+		if (mSelfManagedBuffer || nullptr == mBuffer || mReserved < other.mSize)
+		{
+			if (mSelfManagedBuffer)
+				delete[] mBuffer;
 
-		mBuffer = memoryPool.allocateMemory(other.mSize);
-		mSelfManagedBuffer = false;
+			mBuffer = memoryPool.allocateMemory(other.mSize);
+			mSelfManagedBuffer = false;
+			mReserved = other.mSize;
+		}
 		mSize = other.mSize;
-		mReserved = other.mSize;
 		memcpy(mBuffer, other.mBuffer, mSize);
 
 		mOpcodePointers.resize(other.mOpcodePointers.size());
@@ -101,11 +107,11 @@ namespace lemon
 		const size_t numOpcodes = opcodes.size();
 
 		// Preparation: Build some useful information about opcodes
-		static std::vector<OpcodeProcessor::OpcodeData> opcodeData;
+		static thread_local std::vector<OpcodeProcessor::OpcodeData> opcodeData;
 		OpcodeProcessor::buildOpcodeData(opcodeData, *mFunction);
 
 		// Using a static buffer as temporary buffer before knowing the final size
-		static RuntimeOpcodeBuffer tempBuffer;
+		static thread_local RuntimeOpcodeBuffer tempBuffer;
 		tempBuffer.clear();
 		tempBuffer.reserveForOpcodes(numOpcodes);
 
@@ -184,6 +190,50 @@ namespace lemon
 
 		// Copy the results over, using memory from the shared memory pool
 		mRuntimeOpcodeBuffer.copyFrom(tempBuffer, runtime.mRuntimeOpcodesPool);
+		mCompiledHash = mFunction->addToCompiledHash(rmx::startFNV1a_64() + runtime.getProgram().getOptimizationLevel());
+	}
+
+	void RuntimeFunction::buildFrom(const RuntimeFunction& other, Runtime& runtime)
+	{
+		// This assumes that the other runtime function was built from exactly the same opcodes
+		mRuntimeOpcodeBuffer.copyFrom(other.mRuntimeOpcodeBuffer, runtime.mRuntimeOpcodesPool);
+		mProgramCounterByOpcodeIndex = other.mProgramCounterByOpcodeIndex;
+		mCompiledHash = other.mCompiledHash;
+		mJitCompiled = other.mJitCompiled;
+
+		// Call targets may have been resolved to functions of the previous program, so reset them to get resolved again
+		const std::vector<Opcode>& opcodes = mFunction->mOpcodes;
+		for (size_t i = 0; i < opcodes.size(); ++i)
+		{
+			if (opcodes[i].mType == Opcode::Type::CALL)
+			{
+				RuntimeOpcode& runtimeOpcode = *(RuntimeOpcode*)(mRuntimeOpcodeBuffer.getStart() + mProgramCounterByOpcodeIndex[i]);
+				if (runtimeOpcode.mOpcodeType == Opcode::Type::CALL)
+				{
+					runtimeOpcode.setParameter(opcodes[i].mParameter);
+					runtimeOpcode.mFlags &= ~(RuntimeOpcode::FLAG_CALL_INLINE_RESOLVED | RuntimeOpcode::FLAG_CALL_TARGET_RESOLVED | RuntimeOpcode::FLAG_CALL_TARGET_RUNTIME_FUNC);
+				}
+			}
+		}
+	}
+
+	void RuntimeFunction::rebuildWithJit(Runtime& runtime)
+	{
+		// Caller has to make sure that no call stack is referencing the current runtime opcodes any more
+		//  -> The rebuilt runtime opcodes get written into the same pool memory if they fit, see "RuntimeOpcodeBuffer::copyFrom"
+		mJitCompiled = true;
+		mNextJitCheckCallCount = 0xffffffff;
+		mRuntimeOpcodeBuffer.clear();
+		build(runtime);
+
+		if (!runtime.mJitOpcodeProvider->makeCodeExecutable())
+		{
+			// Fall back to the interpreter for this function
+			RMX_ERROR("Failed to make JIT compiled code executable", );
+			mJitCompiled = false;
+			mRuntimeOpcodeBuffer.clear();
+			build(runtime);
+		}
 	}
 
 	size_t RuntimeFunction::translateFromRuntimeProgramCounter(const uint8* runtimeProgramCounter) const
@@ -231,6 +281,23 @@ namespace lemon
 				return;
 		}
 
+		// Native machine code for hot functions
+		if (mJitCompiled && nullptr != runtime.mJitOpcodeProvider)
+		{
+			const bool success = runtime.mJitOpcodeProvider->buildRuntimeOpcode(buffer, opcodes, numOpcodesAvailable, outNumOpcodesConsumed, runtime);
+			if (success)
+				return;
+		}
+
+		// Register-form runtime opcodes operating directly on local variables instead of the value stack
+		//  -> This is opt-in with its own optimization level, so that it can be compared against the regular full optimization
+		if (program.getOptimizationLevel() >= 4)
+		{
+			const bool success = RegisterOpcodeProvider::buildRuntimeOpcodeStatic(buffer, opcodes, numOpcodesAvailable, outNumOpcodesConsumed, runtime);
+			if (success)
+				return;
+		}
+
 		// Runtime opcode generation by merging multiple opcodes where possible
 		if (program.getOptimizationLevel() >= 1)
 		{
@@ -49,8 +49,13 @@ namespace lemon
 
 	class API_EXPORT RuntimeFunction
 	{
+	public:
+		static const constexpr uint32 JIT_CALL_COUNT_THRESHOLD = 100;	// Number of calls after which a runtime function counts as hot and gets JIT compiled
+
 	public:
 		void build(Runtime& runtime);
+		void buildFrom(const RuntimeFunction& other, Runtime& runtime);
+		void rebuildWithJit(Runtime& runtime);
 
 		const uint8* getFirstRuntimeOpcode() const	{ return mRuntimeOpcodeBuffer.getStart(); }
 
@@ -64,6 +69,10 @@ namespace lemon
 		const ScriptFunction* mFunction = nullptr;
 		RuntimeOpcodeBuffer mRuntimeOpcodeBuffer;
 		std::vector<size_t> mProgramCounterByOpcodeIndex;	// Program counter (= byte index inside "mRuntimeOpcodeData") where runtime opcode for given original opcode index starts
+		uint64 mCompiledHash = 0;							// Hash of the opcodes and optimization level this was built from, used to identify unchanged functions after a script reload
+		uint32 mCallCount = 0;								// Number of calls so far, used to find hot functions for JIT compilation and the hot functions profile
+		uint32 mNextJitCheckCallCount = JIT_CALL_COUNT_THRESHOLD;	// Call count at which to check again whether the function can get JIT compiled
+		bool mJitCompiled = false;							// Set if the runtime opcodes include JIT compiled code
 	};
 
 }
@@ -79,7 +79,7 @@ namespace lemon
 			const char* fmtPtr = formatString.data();
 			const char* fmtEnd = fmtPtr + length;
 
-			static detail::FastStringStream result;
+			static thread_local detail::FastStringStream result;
 			result.clear();
 
 			for (; fmtPtr < fmtEnd; ++fmtPtr)
@@ -0,0 +1,1043 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "lemon/pch.h"
+#include "lemon/runtime/provider/JitOpcodeProvider.h"
+#include "lemon/runtime/RuntimeFunction.h"
+#include "lemon/runtime/RuntimeOpcodeContext.h"
+#include "lemon/runtime/OpcodeExecUtils.h"
+#include "lemon/program/OpcodeHelper.h"
+#include "lemon/program/Program.h"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(PLATFORM_WINDOWS) || defined(PLATFORM_LINUX) || defined(PLATFORM_MAC))
+	#define LEMON_JIT_X64
+#endif
+
+#if defined(LEMON_JIT_X64)
+	#if defined(PLATFORM_WINDOWS)
+		#define WIN32_LEAN_AND_MEAN
+		#include <CleanWindowsInclude.h>
+	#else
+		#include <sys/mman.h>
+	#endif
+#endif
+
+
+namespace lemon
+{
+	namespace
+	{
+		static const constexpr size_t CODE_PAGE_SIZE = 0x10000;
+		static const constexpr size_t MAX_TOTAL_CODE_SIZE = 0x2000000;
+		static const constexpr int MIN_OPCODES_PER_BLOCK = 3;
+
+		// Signature of the generated code blocks
+		typedef void(*JitBlockFunc)(ControlFlow* controlFlow, uint64** valueStackPtr, int64* localVariables, const uint8* exceptionFlag);
+	}
+
+
+	class JitOpcodeExec
+	{
+	public:
+		static void exec_JIT_BLOCK(const RuntimeOpcodeContext context)
+		{
+			ControlFlow& controlFlow = *context.mControlFlow;
+			context.getParameter<JitBlockFunc>()(&controlFlow, &controlFlow.mValueStackPtr, controlFlow.mCurrentLocalVariables, &mExceptionFlag);
+
+			// Rethrow an exception caught inside a helper function, now that the generated code was left
+			if (mExceptionFlag != 0)
+			{
+				mExceptionFlag = 0;
+				std::exception_ptr exception = mPendingException;
+				mPendingException = nullptr;
+				std::rethrow_exception(exception);
+			}
+		}
+
+		// The memory access helpers must not let exceptions pass, as there's no unwind info for the generated code calling them
+		//  -> Instead they set the exception flag, which makes the generated code return early
+		template<typename T>
+		static uint64 readMemory(ControlFlow* controlFlow, uint64 address)
+		{
+			try
+			{
+				return OpcodeExecUtils::readMemory<T>(*controlFlow, address);
+			}
+			catch (...)
+			{
+				setPendingException();
+				return 0;
+			}
+		}
+
+		template<typename T>
+		static void writeMemory(ControlFlow* controlFlow, uint64 address, uint64 value)
+		{
+			try
+			{
+				OpcodeExecUtils::writeMemory<T>(*controlFlow, address, (T)value);
+			}
+			catch (...)
+			{
+				setPendingException();
+			}
+		}
+
+	private:
+		static void setPendingException()
+		{
+			mPendingException = std::current_exception();
+			mExceptionFlag = 1;
+		}
+
+	private:
+		inline static thread_local uint8 mExceptionFlag = 0;
+		inline static thread_local std::exception_ptr mPendingException;
+	};
+
+
+#if defined(LEMON_JIT_X64)
+	namespace
+	{
+		enum Register : uint8
+		{
+			RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+			R8  = 8, R9  = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+		};
+
+		// Fixed register assignment inside generated code, using only callee-saved registers so that they survive calls into helper functions
+		static const constexpr Register REG_STACK		= RBX;	// Value stack pointer at block start
+		static const constexpr Register REG_LOCALS		= RBP;	// Local variables of the current function
+		static const constexpr Register REG_CONTROLFLOW	= R12;
+		static const constexpr Register REG_STACK_FIELD	= R13;	// Address of the control flow's value stack pointer
+		static const constexpr Register REG_EXCEPTION	= R14;	// Address of the flag set by helper functions that caught an exception
+
+	#if defined(PLATFORM_WINDOWS)
+		static const constexpr Register ARG0 = RCX;
+		static const constexpr Register ARG1 = RDX;
+		static const constexpr Register ARG2 = R8;
+		static const constexpr Register ARG3 = R9;
+	#else
+		static const constexpr Register ARG0 = RDI;
+		static const constexpr Register ARG1 = RSI;
+		static const constexpr Register ARG2 = RDX;
+		static const constexpr Register ARG3 = RCX;
+	#endif
+
+		// Condition codes for setcc
+		enum Condition : uint8
+		{
+			COND_B  = 0x2, COND_AE = 0x3, COND_E  = 0x4, COND_NE = 0x5, COND_BE = 0x6, COND_A  = 0x7,
+			COND_L  = 0xc, COND_GE = 0xd, COND_LE = 0xe, COND_G  = 0xf
+		};
+
+		BaseType normalizeType(BaseType type)
+		{
+			// Constants are treated as unsigned 64-bit values by the interpreter as well
+			return (type == BaseType::INT_CONST) ? BaseType::UINT_64 : type;
+		}
+
+		bool isSignedType(BaseType type)
+		{
+			return ((uint8)type & 0x08) != 0;
+		}
+
+		BaseType getUnsignedTypeOfSize(size_t bytes)
+		{
+			switch (bytes)
+			{
+				case 1:  return BaseType::UINT_8;
+				case 2:  return BaseType::UINT_16;
+				case 4:  return BaseType::UINT_32;
+				default: return BaseType::UINT_64;
+			}
+		}
+
+
+		class X64Emitter
+		{
+		public:
+			std::vector<uint8> mCode;
+
+		public:
+			void byte(uint8 value)  { mCode.push_back(value); }
+
+			void dword(int32 value)
+			{
+				for (int i = 0; i < 4; ++i)
+					byte((uint8)(value >> (i * 8)));
+			}
+
+			void qword(uint64 value)
+			{
+				for (int i = 0; i < 8; ++i)
+					byte((uint8)(value >> (i * 8)));
+			}
+
+			void rex(bool wide, int reg, int base)
+			{
+				const uint8 value = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((base & 8) ? 0x01 : 0);
+				if (value != 0x40)
+					byte(value);
+			}
+
+			void modrmRegister(int reg, int rm)
+			{
+				byte(0xc0 | ((reg & 7) << 3) | (rm & 7));
+			}
+
+			void modrmMemory(int reg, int base, int32 displacement)
+			{
+				// Base RBP / R13 can't be encoded without displacement, base RSP / R12 requires a SIB byte
+				const int mod = (displacement == 0 && (base & 7) != RBP) ? 0 : (displacement >= -128 && displacement <= 127) ? 1 : 2;
+				byte((uint8)((mod << 6) | ((reg & 7) << 3) | (base & 7)));
+				if ((base & 7) == RSP)
+					byte(0x24);
+				if (mod == 1)
+					byte((uint8)(int8)displacement);
+				else if (mod == 2)
+					dword(displacement);
+			}
+
+			void load64(Register dst, Register base, int32 displacement)
+			{
+				rex(true, dst, base);
+				byte(0x8b);
+				modrmMemory(dst, base, displacement);
+			}
+
+			void store64(Register base, int32 displacement, Register src)
+			{
+				rex(true, src, base);
+				byte(0x89);
+				modrmMemory(src, base, displacement);
+			}
+
+			// Load value of the given type, with zero or sign extension to 64 bits
+			void loadExtended(Register dst, Register base, int32 displacement, BaseType type)
+			{
+				switch (type)
+				{
+					case BaseType::UINT_8:	rex(false, dst, base);  byte(0x0f);  byte(0xb6);  break;
+					case BaseType::INT_8:	rex(true,  dst, base);  byte(0x0f);  byte(0xbe);  break;
+					case BaseType::UINT_16:	rex(false, dst, base);  byte(0x0f);  byte(0xb7);  break;
+					case BaseType::INT_16:	rex(true,  dst, base);  byte(0x0f);  byte(0xbf);  break;
+					case BaseType::UINT_32:	rex(false, dst, base);  byte(0x8b);  break;
+					case BaseType::INT_32:	rex(true,  dst, base);  byte(0x63);  break;
+					default:				rex(true,  dst, base);  byte(0x8b);  break;
+				}
+				modrmMemory(dst, base, displacement);
+			}
+
+			void storeSized(Register base, int32 displacement, Register src, size_t bytes)
+			{
+				if (bytes == 2)
+					byte(0x66);
+				rex(bytes == 8, src, base);
+				byte((bytes == 1) ? 0x88 : 0x89);
+				modrmMemory(src, base, displacement);
+			}
+
+			// Zero or sign extension of the lower bits of RAX or RCX, according to the given type
+			void extend(Register reg, BaseType type)
+			{
+				switch (type)
+				{
+					case BaseType::UINT_8:	byte(0x0f);  byte(0xb6);  break;
+					case BaseType::INT_8:	rex(true, reg, reg);  byte(0x0f);  byte(0xbe);  break;
+					case BaseType::UINT_16:	byte(0x0f);  byte(0xb7);  break;
+					case BaseType::INT_16:	rex(true, reg, reg);  byte(0x0f);  byte(0xbf);  break;
+					case BaseType::UINT_32:	byte(0x89);  break;
+					case BaseType::INT_32:	rex(true, reg, reg);  byte(0x63);  break;
+					default:				return;
+				}
+				modrmRegister(reg, reg);
+			}
+
+			void storeByteImmediate(Register base, int32 displacement, uint8 value)
+			{
+				rex(false, 0, base);
+				byte(0xc6);
+				modrmMemory(0, base, displacement);
+				byte(value);
+			}
+
+			void movRegister(Register dst, Register src)
+			{
+				rex(true, src, dst);
+				byte(0x89);
+				modrmRegister(src, dst);
+			}
+
+			void movImmediate(Register dst, uint64 value)
+			{
+				if ((int64)value >= -0x80000000LL && (int64)value <= 0x7fffffffLL)
+				{
+					// Sign-extended 32-bit immediate
+					rex(true, 0, dst);
+					byte(0xc7);
+					modrmRegister(0, dst);
+					dword((int32)value);
+				}
+				else
+				{
+					rex(true, 0, dst);
+					byte(0xb8 | (dst & 7));
+					qword(value);
+				}
+			}
+
+			// Binary ALU operation "dst = dst <op> src", for the "op r/m, r" encodings (add, sub, and, or, xor, cmp, test)
+			void alu(uint8 opcode, bool wide, Register dst, Register src)
+			{
+				rex(wide, src, dst);
+				byte(opcode);
+				modrmRegister(src, dst);
+			}
+
+			void imul(bool wide, Register dst, Register src)
+			{
+				rex(wide, dst, src);
+				byte(0x0f);
+				byte(0xaf);
+				modrmRegister(dst, src);
+			}
+
+			// Shift by CL: extension 4 = shl, 5 = shr, 7 = sar
+			void shiftByCL(uint8 extension, bool wide, Register dst)
+			{
+				rex(wide, 0, dst);
+				byte(0xd3);
+				modrmRegister(extension, dst);
+			}
+
+			void andImmediate8(bool wide, Register dst, int8 value)
+			{
+				rex(wide, 0, dst);
+				byte(0x83);
+				modrmRegister(4, dst);
+				byte((uint8)value);
+			}
+
+			void addImmediate(Register dst, int32 value)
+			{
+				rex(true, 0, dst);
+				if (value >= -128 && value <= 127)
+				{
+					byte(0x83);
+					modrmRegister(0, dst);
+					byte((uint8)(int8)value);
+				}
+				else
+				{
+					byte(0x81);
+					modrmRegister(0, dst);
+					dword(value);
+				}
+			}
+
+			// Unary operation: extension 2 = not, 3 = neg
+			void unary(uint8 extension, Register reg)
+			{
+				rex(true, 0, reg);
+				byte(0xf7);
+				modrmRegister(extension, reg);
+			}
+
+			// Set RAX to 1 if condition is met, 0 otherwise
+			void setConditionRAX(Condition condition)
+			{
+				byte(0x0f);  byte(0x90 | condition);  byte(0xc0);		// setcc al
+				byte(0x0f);  byte(0xb6);  byte(0xc0);					// movzx eax, al
+			}
+
+			void swapBytesRAX(size_t bytes)
+			{
+				switch (bytes)
+				{
+					case 2:  byte(0x66);  byte(0xc1);  byte(0xc0);  byte(0x08);  break;		// rol ax, 8
+					case 4:  byte(0x0f);  byte(0xc8);  break;								// bswap eax
+					case 8:  byte(0x48);  byte(0x0f);  byte(0xc8);  break;					// bswap rax
+				}
+			}
+
+			void push(Register reg)
+			{
+				if (reg & 8)
+					byte(0x41);
+				byte(0x50 | (reg & 7));
+			}
+
+			void pop(Register reg)
+			{
+				if (reg & 8)
+					byte(0x41);
+				byte(0x58 | (reg & 7));
+			}
+
+			void callAbsolute(const void* function)
+			{
+				movImmediate(RAX, (uint64)function);
+				byte(0xff);
+				byte(0xd0);		// call rax
+			}
+
+			void compareByteZero(Register base)
+			{
+				// Only used with registers that don't need a SIB byte or displacement as base
+				rex(false, 0, base);
+				byte(0x80);
+				byte(0x38 | (base & 7));		// cmp byte [base], 0
+				byte(0x00);
+			}
+
+			// Emit a jump with a 32-bit displacement, and return the position of the displacement for patching it later
+			size_t jumpNotEqual()
+			{
+				byte(0x0f);  byte(0x85);
+				dword(0);
+				return mCode.size() - 4;
+			}
+
+			size_t jump()
+			{
+				byte(0xe9);
+				dword(0);
+				return mCode.size() - 4;
+			}
+
+			void patchJumpTarget(size_t displacementPosition, size_t targetPosition)
+			{
+				const int32 displacement = (int32)((int64)targetPosition - (int64)(displacementPosition + 4));
+				memcpy(&mCode[displacementPosition], &displacement, 4);
+			}
+		};
+
+
+		class X64BlockCompiler
+		{
+		public:
+			X64BlockCompiler(const Runtime& runtime) : mRuntime(runtime) {}
+
+			int compile(const Opcode* opcodes, int numOpcodesAvailable)
+			{
+				emitPrologue();
+
+				int numOpcodesConsumed = 0;
+				while (numOpcodesConsumed < numOpcodesAvailable)
+				{
+					const int consumed = emitOpcodes(&opcodes[numOpcodesConsumed], numOpcodesAvailable - numOpcodesConsumed);
+					if (consumed == 0)
+						break;
+					numOpcodesConsumed += consumed;
+				}
+
+				emitEpilogue();
+				emitExceptionExits();
+				return numOpcodesConsumed;
+			}
+
+			inline const std::vector<uint8>& getCode() const  { return mEmitter.mCode; }
+
+		private:
+			// Displacement of a value stack element relative to the value stack pointer at block start; 0 is the top-most element
+			inline int32 stackElement(int indexFromTop) const  { return (mStackOffset - 1 - indexFromTop) * 8; }
+
+			void emitPrologue()
+			{
+				mEmitter.push(RBX);
+				mEmitter.push(RBP);
+				mEmitter.push(R12);
+				mEmitter.push(R13);
+				mEmitter.push(R14);
+				mEmitter.byte(0x48);  mEmitter.byte(0x83);  mEmitter.byte(0xec);  mEmitter.byte(0x20);		// sub rsp, 32 (shadow space, keeping the stack aligned)
+				mEmitter.movRegister(REG_CONTROLFLOW, ARG0);
+				mEmitter.movRegister(REG_STACK_FIELD, ARG1);
+				mEmitter.movRegister(REG_LOCALS, ARG2);
+				mEmitter.movRegister(REG_EXCEPTION, ARG3);
+				mEmitter.load64(REG_STACK, REG_STACK_FIELD, 0);
+			}
+
+			void emitEpilogue()
+			{
+				// The value stack pointer only gets updated once at the end
+				if (mStackOffset != 0)
+					mEmitter.addImmediate(REG_STACK, mStackOffset * 8);
+				mExitPosition = mEmitter.mCode.size();
+				mEmitter.store64(REG_STACK_FIELD, 0, REG_STACK);
+				mEmitter.byte(0x48);  mEmitter.byte(0x83);  mEmitter.byte(0xc4);  mEmitter.byte(0x20);		// add rsp, 32
+				mEmitter.pop(R14);
+				mEmitter.pop(R13);
+				mEmitter.pop(R12);
+				mEmitter.pop(RBP);
+				mEmitter.pop(RBX);
+				mEmitter.byte(0xc3);		// ret
+			}
+
+			void emitExceptionExits()
+			{
+				// Early exits for helper calls that caught an exception, each one with the value stack pointer as it was at that point
+				for (const ExceptionExit& exit : mExceptionExits)
+				{
+					mEmitter.patchJumpTarget(exit.mJumpPosition, mEmitter.mCode.size());
+					if (exit.mStackOffset != 0)
+						mEmitter.addImmediate(REG_STACK, exit.mStackOffset * 8);
+					mEmitter.patchJumpTarget(mEmitter.jump(), mExitPosition);
+				}
+			}
+
+			void emitHelperCall(const void* helper)
+			{
+				mEmitter.callAbsolute(helper);
+				mEmitter.compareByteZero(REG_EXCEPTION);
+				ExceptionExit& exit = vectorAdd(mExceptionExits);
+				exit.mJumpPosition = mEmitter.jumpNotEqual();
+				exit.mStackOffset = mStackOffset;
+			}
+
+			void pushRAX()
+			{
+				++mStackOffset;
+				mEmitter.store64(REG_STACK, stackElement(0), RAX);
+			}
+
+			bool getVariablePointer(uint32 variableId, BaseType dataType, void*& outPointer, size_t& outBytes)
+			{
+				switch ((Variable::Type)(variableId >> 28))
+				{
+					case Variable::Type::GLOBAL:
+						outPointer = const_cast<Runtime&>(mRuntime).accessGlobalVariableValue(mRuntime.getProgram().getGlobalVariableByID(variableId));
+						outBytes = DataTypeHelper::getSizeOfBaseType(dataType);
+						return (nullptr != outPointer);
+
+					case Variable::Type::EXTERNAL:
+					{
+						const ExternalVariable& variable = static_cast<ExternalVariable&>(mRuntime.getProgram().getGlobalVariableByID(variableId));
+						outPointer = variable.mPointer;
+						outBytes = variable.getDataType()->getBytes();
+						return true;
+					}
+
+					default:
+						return false;
+				}
+			}
+
+			template<typename T> static const void* getReadMemoryHelper()   { return (const void*)&JitOpcodeExec::readMemory<T>; }
+			template<typename T> static const void* getWriteMemoryHelper()  { return (const void*)&JitOpcodeExec::writeMemory<T>; }
+
+			const void* getMemoryHelper(BaseType type, bool writeAccess)
+			{
+				switch (type)
+				{
+					case BaseType::INT_8:	return writeAccess ? getWriteMemoryHelper<int8>()   : getReadMemoryHelper<int8>();
+					case BaseType::INT_16:	return writeAccess ? getWriteMemoryHelper<int16>()  : getReadMemoryHelper<int16>();
+					case BaseType::INT_32:	return writeAccess ? getWriteMemoryHelper<int32>()  : getReadMemoryHelper<int32>();
+					case BaseType::INT_64:	return writeAccess ? getWriteMemoryHelper<int64>()  : getReadMemoryHelper<int64>();
+					case BaseType::UINT_8:	return writeAccess ? getWriteMemoryHelper<uint8>()  : getReadMemoryHelper<uint8>();
+					case BaseType::UINT_16:	return writeAccess ? getWriteMemoryHelper<uint16>() : getReadMemoryHelper<uint16>();
+					case BaseType::UINT_32:	return writeAccess ? getWriteMemoryHelper<uint32>() : getReadMemoryHelper<uint32>();
+					case BaseType::UINT_64:	return writeAccess ? getWriteMemoryHelper<uint64>() : getReadMemoryHelper<uint64>();
+					default:				return nullptr;
+				}
+			}
+
+			bool emitFixedAddressMemoryAccess(const Opcode& addressOpcode, const Opcode& accessOpcode)
+			{
+				const uint64 address = (uint64)addressOpcode.mParameter;
+				const BaseType type = normalizeType(accessOpcode.mDataType);
+				const size_t bytes = DataTypeHelper::getSizeOfBaseType(type);
+				const bool writeAccess = (accessOpcode.mType == Opcode::Type::WRITE_MEMORY);
+				const void* helper = getMemoryHelper(type, writeAccess);
+				if (nullptr == helper)
+					return false;
+
+				// Use the same direct memory access as the optimized opcode provider where possible
+				MemoryAccessHandler::SpecializationResult result;
+				if (nullptr != mRuntime.getMemoryAccessHandler())
+					mRuntime.getMemoryAccessHandler()->getDirectAccessSpecialization(result, address, bytes, writeAccess);
+
+				if (result.mResult == MemoryAccessHandler::SpecializationResult::HAS_SPECIALIZATION)
+				{
+					mEmitter.movImmediate(RCX, (uint64)result.mDirectAccessPointer);
+					if (writeAccess)
+					{
+						mEmitter.load64(RAX, REG_STACK, stackElement(0));
+						if (result.mSwapBytes)
+							mEmitter.swapBytesRAX(bytes);
+						mEmitter.storeSized(RCX, 0, RAX, bytes);
+						if (nullptr != result.mDirtyFlagPointer)
+						{
+							mEmitter.movImmediate(RCX, (uint64)result.mDirtyFlagPointer);
+							mEmitter.storeByteImmediate(RCX, 0, 1);
+						}
+					}
+					else
+					{
+						if (result.mSwapBytes)
+						{
+							mEmitter.loadExtended(RAX, RCX, 0, getUnsignedTypeOfSize(bytes));
+							mEmitter.swapBytesRAX(bytes);
+							mEmitter.extend(RAX, type);
+						}
+						else
+						{
+							mEmitter.loadExtended(RAX, RCX, 0, type);
+						}
+						pushRAX();
+					}
+				}
+				else
+				{
+					mEmitter.movRegister(ARG0, REG_CONTROLFLOW);
+					mEmitter.movImmediate(ARG1, address);
+					if (writeAccess)
+					{
+						mEmitter.load64(ARG2, REG_STACK, stackElement(0));
+						emitHelperCall(helper);
+					}
+					else
+					{
+						emitHelperCall(helper);
+						pushRAX();
+					}
+				}
+				return true;
+			}
+
+			bool emitBinaryOperation(const Opcode& opcode)
+			{
+				const BaseType type = normalizeType(opcode.mDataType);
+				const size_t bytes = DataTypeHelper::getSizeOfBaseType(type);
+				const bool isSigned = isSignedType(type);
+				if (bytes == 0)
+					return false;
+
+				mEmitter.load64(RAX, REG_STACK, stackElement(1));
+				mEmitter.load64(RCX, REG_STACK, stackElement(0));
+				--mStackOffset;
+
+				if (opcode.mType >= Opcode::Type::COMPARE_EQ && opcode.mType <= Opcode::Type::COMPARE_GE)
+				{
+					mEmitter.extend(RAX, type);
+					mEmitter.extend(RCX, type);
+					mEmitter.alu(0x39, true, RAX, RCX);		// cmp rax, rcx
+					switch (opcode.mType)
+					{
+						case Opcode::Type::COMPARE_EQ:	mEmitter.setConditionRAX(COND_E);  break;
+						case Opcode::Type::COMPARE_NEQ:	mEmitter.setConditionRAX(COND_NE);  break;
+						case Opcode::Type::COMPARE_LT:	mEmitter.setConditionRAX(isSigned ? COND_L  : COND_B);  break;
+						case Opcode::Type::COMPARE_LE:	mEmitter.setConditionRAX(isSigned ? COND_LE : COND_BE);  break;
+						case Opcode::Type::COMPARE_GT:	mEmitter.setConditionRAX(isSigned ? COND_G  : COND_A);  break;
+						case Opcode::Type::COMPARE_GE:	mEmitter.setConditionRAX(isSigned ? COND_GE : COND_AE);  break;
+						default:  break;
+					}
+				}
+				else
+				{
+					// Types smaller than 32 bits get promoted to int by the interpreter, so the result is a sign-extended 32-bit value then
+					const bool wide = (bytes == 8);
+					if (bytes < 4)
+					{
+						mEmitter.extend(RAX, type);
+						mEmitter.extend(RCX, type);
+					}
+
+					switch (opcode.mType)
+					{
+						case Opcode::Type::ARITHM_ADD:	mEmitter.alu(0x01, wide, RAX, RCX);  break;
+						case Opcode::Type::ARITHM_SUB:	mEmitter.alu(0x29, wide, RAX, RCX);  break;
+						case Opcode::Type::ARITHM_AND:	mEmitter.alu(0x21, wide, RAX, RCX);  break;
+						case Opcode::Type::ARITHM_OR:	mEmitter.alu(0x09, wide, RAX, RCX);  break;
+						case Opcode::Type::ARITHM_XOR:	mEmitter.alu(0x31, wide, RAX, RCX);  break;
+						case Opcode::Type::ARITHM_MUL:	mEmitter.imul(wide, RAX, RCX);  break;
+
+						case Opcode::Type::ARITHM_SHL:
+						case Opcode::Type::ARITHM_SHR:
+						{
+							// Shift counts get masked to the type's bit count; the CPU does this already for 32 and 64 bits
+							if (bytes < 4)
+								mEmitter.andImmediate8(false, RCX, (int8)(bytes * 8 - 1));
+							const uint8 extension = (opcode.mType == Opcode::Type::ARITHM_SHL) ? 4 : isSigned ? 7 : 5;
+							mEmitter.shiftByCL(extension, wide, RAX);
+							break;
+						}
+
+						default:
+							return false;
+					}
+
+					if (bytes < 4)
+						mEmitter.extend(RAX, BaseType::INT_32);
+					else if (bytes == 4)
+						mEmitter.extend(RAX, type);
+				}
+
+				mEmitter.store64(REG_STACK, stackElement(0), RAX);
+				return true;
+			}
+
+			// Emits code for one or more opcodes, returns the number of opcodes consumed, or 0 if the first one is not supported
+			int emitOpcodes(const Opcode* opcodes, int numOpcodesAvailable)
+			{
+				const Opcode& opcode = opcodes[0];
+				switch (opcode.mType)
+				{
+					case Opcode::Type::NOP:
+						return 1;
+
+					case Opcode::Type::MOVE_STACK:
+					{
+						const int change = (int)opcode.mParameter;
+						if (change > 0)
+						{
+							mEmitter.alu(0x31, false, RAX, RAX);		// xor eax, eax
+							for (int i = 0; i < change; ++i)
+								pushRAX();
+						}
+						else
+						{
+							mStackOffset += change;
+						}
+						return 1;
+					}
+
+					case Opcode::Type::PUSH_CONSTANT:
+					{
+						if (numOpcodesAvailable >= 2 && opcodes[1].mParameter == 0 && (opcodes[1].mType == Opcode::Type::READ_MEMORY || opcodes[1].mType == Opcode::Type::WRITE_MEMORY))
+						{
+							if (emitFixedAddressMemoryAccess(opcodes[0], opcodes[1]))
+								return 2;
+						}
+
+						mEmitter.movImmediate(RAX, (uint64)opcode.mParameter);
+						pushRAX();
+						return 1;
+					}
+
+					case Opcode::Type::GET_VARIABLE_VALUE:
+					case Opcode::Type::SET_VARIABLE_VALUE:
+					{
+						const uint32 variableId = (uint32)opcode.mParameter;
+						const bool isGet = (opcode.mType == Opcode::Type::GET_VARIABLE_VALUE);
+						if ((Variable::Type)(variableId >> 28) == Variable::Type::LOCAL)
+						{
+							if (isGet)
+							{
+								mEmitter.load64(RAX, REG_LOCALS, (int32)variableId * 8);
+								pushRAX();
+							}
+							else
+							{
+								mEmitter.load64(RAX, REG_STACK, stackElement(0));
+								mEmitter.store64(REG_LOCALS, (int32)variableId * 8, RAX);
+							}
+							return 1;
+						}
+
+						void* pointer = nullptr;
+						size_t bytes = 0;
+						if (!getVariablePointer(variableId, opcode.mDataType, pointer, bytes) || bytes == 0)
+							return 0;
+
+						mEmitter.movImmediate(RCX, (uint64)pointer);
+						if (isGet)
+						{
+							mEmitter.loadExtended(RAX, RCX, 0, getUnsignedTypeOfSize(bytes));
+							pushRAX();
+						}
+						else
+						{
+							mEmitter.load64(RAX, REG_STACK, stackElement(0));
+							mEmitter.storeSized(RCX, 0, RAX, bytes);
+						}
+						return 1;
+					}
+
+					case Opcode::Type::READ_MEMORY:
+					{
+						const void* helper = getMemoryHelper(normalizeType(opcode.mDataType), false);
+						if (nullptr == helper)
+							return 0;
+
+						mEmitter.movRegister(ARG0, REG_CONTROLFLOW);
+						mEmitter.load64(ARG1, REG_STACK, stackElement(0));
+						emitHelperCall(helper);
+						if (opcode.mParameter == 0)
+						{
+							mEmitter.store64(REG_STACK, stackElement(0), RAX);
+						}
+						else
+						{
+							pushRAX();
+						}
+						return 1;
+					}
+
+					case Opcode::Type::WRITE_MEMORY:
+					{
+						const BaseType type = normalizeType(opcode.mDataType);
+						const void* helper = getMemoryHelper(type, true);
+						if (nullptr == helper)
+							return 0;
+
+						// Stack contains value and address, or the other way round for the exchanged variant
+						const bool exchanged = (opcode.mParameter != 0);
+						mEmitter.movRegister(ARG0, REG_CONTROLFLOW);
+						mEmitter.load64(ARG1, REG_STACK, stackElement(exchanged ? 1 : 0));
+						mEmitter.load64(ARG2, REG_STACK, stackElement(exchanged ? 0 : 1));
+						emitHelperCall(helper);
+						if (exchanged)
+						{
+							mEmitter.load64(RAX, REG_STACK, stackElement(0));
+							mEmitter.extend(RAX, type);
+							mEmitter.store64(REG_STACK, stackElement(1), RAX);
+						}
+						--mStackOffset;
+						return 1;
+					}
+
+					case Opcode::Type::CAST_VALUE:
+					{
+						const BaseType execType = OpcodeHelper::getCastExecType(opcode);
+						if (DataTypeHelper::getSizeOfBaseType(execType) == 0 || DataTypeHelper::getSizeOfBaseType(execType) > 4)
+							return 0;
+
+						mEmitter.load64(RAX, REG_STACK, stackElement(0));
+						mEmitter.extend(RAX, execType);
+						mEmitter.store64(REG_STACK, stackElement(0), RAX);
+						return 1;
+					}
+
+					case Opcode::Type::MAKE_BOOL:
+					case Opcode::Type::ARITHM_NOT:
+					{
+						mEmitter.load64(RAX, REG_STACK, stackElement(0));
+						if (opcode.mType == Opcode::Type::ARITHM_NOT)
+							mEmitter.extend(RAX, normalizeType(opcode.mDataType));
+						mEmitter.alu(0x85, true, RAX, RAX);		// test rax, rax
+						mEmitter.setConditionRAX((opcode.mType == Opcode::Type::MAKE_BOOL) ? COND_NE : COND_E);
+						mEmitter.store64(REG_STACK, stackElement(0), RAX);
+						return 1;
+					}
+
+					case Opcode::Type::ARITHM_NEG:
+					{
+						// Interpreter uses the signed variant of the type
+						const BaseType type = (opcode.mDataType == BaseType::INT_CONST) ? BaseType::INT_64 : (BaseType)((uint8)opcode.mDataType | 0x08);
+						mEmitter.load64(RAX, REG_STACK, stackElement(0));
+						mEmitter.extend(RAX, type);
+						mEmitter.unary(3, RAX);
+						if (DataTypeHelper::getSizeOfBaseType(type) <= 4)
+							mEmitter.extend(RAX, BaseType::INT_32);
+						mEmitter.store64(REG_STACK, stackElement(0), RAX);
+						return 1;
+					}
+
+					case Opcode::Type::ARITHM_BITNOT:
+					{
+						const BaseType type = normalizeType(opcode.mDataType);
+						mEmitter.load64(RAX, REG_STACK, stackElement(0));
+						mEmitter.extend(RAX, type);
+						mEmitter.unary(2, RAX);
+						mEmitter.extend(RAX, type);
+						mEmitter.store64(REG_STACK, stackElement(0), RAX);
+						return 1;
+					}
+
+					case Opcode::Type::ARITHM_ADD:
+					case Opcode::Type::ARITHM_SUB:
+					case Opcode::Type::ARITHM_MUL:
+					case Opcode::Type::ARITHM_AND:
+					case Opcode::Type::ARITHM_OR:
+					case Opcode::Type::ARITHM_XOR:
+					case Opcode::Type::ARITHM_SHL:
+					case Opcode::Type::ARITHM_SHR:
+					case Opcode::Type::COMPARE_EQ:
+					case Opcode::Type::COMPARE_NEQ:
+					case Opcode::Type::COMPARE_LT:
+					case Opcode::Type::COMPARE_LE:
+					case Opcode::Type::COMPARE_GT:
+					case Opcode::Type::COMPARE_GE:
+						return emitBinaryOperation(opcode) ? 1 : 0;
+
+					default:
+						// Division and modulo, and everything that touches the control flow is left to the interpreter
+						return 0;
+				}
+			}
+
+		private:
+			struct ExceptionExit
+			{
+				size_t mJumpPosition = 0;
+				int mStackOffset = 0;
+			};
+
+		private:
+			const Runtime& mRuntime;
+			X64Emitter mEmitter;
+			int mStackOffset = 0;
+			size_t mExitPosition = 0;
+			std::vector<ExceptionExit> mExceptionExits;
+		};
+	}
+#endif
+
+
+	bool JitOpcodeProvider::isSupported()
+	{
+	#if defined(LEMON_JIT_X64)
+		return true;
+	#else
+		return false;
+	#endif
+	}
+
+	JitOpcodeProvider::JitOpcodeProvider()
+	{
+	}
+
+	JitOpcodeProvider::~JitOpcodeProvider()
+	{
+		clear();
+	}
+
+	void JitOpcodeProvider::clear()
+	{
+	#if defined(LEMON_JIT_X64)
+		for (const CodePage& page : mCodePages)
+		{
+		#if defined(PLATFORM_WINDOWS)
+			VirtualFree(page.mMemory, 0, MEM_RELEASE);
+		#else
+			munmap(page.mMemory, page.mSize);
+		#endif
+		}
+	#endif
+		mCodePages.clear();
+		mTotalCodeSize = 0;
+	}
+
+	void JitOpcodeProvider::takeCodeFrom(JitOpcodeProvider& other)
+	{
+		// Insert in front, so that new code continues to go into the current last page
+		mCodePages.insert(mCodePages.begin(), other.mCodePages.begin(), other.mCodePages.end());
+		mTotalCodeSize += other.mTotalCodeSize;
+		other.mCodePages.clear();
+		other.mTotalCodeSize = 0;
+	}
+
+	bool JitOpcodeProvider::makeCodeExecutable()
+	{
+		// Switch all pages that got new code written to from read-write to read-execute
+		bool success = true;
+		for (CodePage& page : mCodePages)
+		{
+			if (page.mWritable)
+				success &= setPageWritable(page, false);
+		}
+		return success;
+	}
+
+	bool JitOpcodeProvider::buildRuntimeOpcode(RuntimeOpcodeBuffer& buffer, const Opcode* opcodes, int numOpcodesAvailable, int& outNumOpcodesConsumed, const Runtime& runtime)
+	{
+	#if defined(LEMON_JIT_X64)
+		if (numOpcodesAvailable < MIN_OPCODES_PER_BLOCK)
+			return false;
+
+		X64BlockCompiler compiler(runtime);
+		const int numOpcodesConsumed = compiler.compile(opcodes, numOpcodesAvailable);
+		if (numOpcodesConsumed < MIN_OPCODES_PER_BLOCK)
+			return false;
+
+		const std::vector<uint8>& code = compiler.getCode();
+		uint8* memory = allocateCode(code.size());
+		if (nullptr == memory)
+			return false;
+		memcpy(memory, &code[0], code.size());
+
+		RuntimeOpcode& runtimeOpcode = buffer.addOpcode(8);
+		runtimeOpcode.mExecFunc = &JitOpcodeExec::exec_JIT_BLOCK;
+		runtimeOpcode.setParameter((JitBlockFunc)memory);
+		outNumOpcodesConsumed = numOpcodesConsumed;
+		return true;
+	#else
+		return false;
+	#endif
+	}
+
+	uint8* JitOpcodeProvider::allocateCode(size_t size)
+	{
+	#if defined(LEMON_JIT_X64)
+		size = (size + 15) & ~(size_t)15;
+		if (size > CODE_PAGE_SIZE)
+			return nullptr;
+
+		if (mCodePages.empty() || mCodePages.back().mUsed + size > mCodePages.back().mSize)
+		{
+			if (mTotalCodeSize + CODE_PAGE_SIZE > MAX_TOTAL_CODE_SIZE)
+				return nullptr;
+
+			// Pages start out as read-write only, "makeCodeExecutable" switches them to read-execute afterwards
+		#if defined(PLATFORM_WINDOWS)
+			uint8* memory = (uint8*)VirtualAlloc(nullptr, CODE_PAGE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		#else
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+			#if defined(PLATFORM_MAC) && defined(MAP_JIT)
+				flags |= MAP_JIT;
+			#endif
+			void* mapped = mmap(nullptr, CODE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+			uint8* memory = (mapped == MAP_FAILED) ? nullptr : (uint8*)mapped;
+		#endif
+			if (nullptr == memory)
+				return nullptr;
+
+			CodePage& page = mCodePages.emplace_back();
+			page.mMemory = memory;
+			page.mSize = CODE_PAGE_SIZE;
+			page.mWritable = true;
+			mTotalCodeSize += CODE_PAGE_SIZE;
+		}
+
+		CodePage& page = mCodePages.back();
+		if (!page.mWritable)
+		{
+			// Page was already made executable, switch it back for writing more code into it
+			if (!setPageWritable(page, true))
+				return nullptr;
+		}
+		uint8* result = page.mMemory + page.mUsed;
+		page.mUsed += size;
+		return result;
+	#else
+		return nullptr;
+	#endif
+	}
+
+	bool JitOpcodeProvider::setPageWritable(CodePage& page, bool writable)
+	{
+	#if defined(LEMON_JIT_X64)
+	#if defined(PLATFORM_WINDOWS)
+		DWORD oldProtection = 0;
+		if (!VirtualProtect(page.mMemory, page.mSize, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &oldProtection))
+			return false;
+		if (!writable)
+			FlushInstructionCache(GetCurrentProcess(), page.mMemory, page.mSize);
+	#else
+		if (0 != mprotect(page.mMemory, page.mSize, writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC)))
+			return false;
+	#endif
+		page.mWritable = writable;
+		return true;
+	#else
+		return false;
+	#endif
+	}
+
+}
@@ -0,0 +1,51 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include "lemon/runtime/RuntimeOpcode.h"
+
+
+namespace lemon
+{
+	// Compiles sequences of opcodes into native machine code at runtime (currently x86-64 only)
+	//  -> This is used for hot runtime functions, see "Runtime::callFunction"
+	//  -> Unsupported opcodes are left to the other runtime opcode providers
+	class JitOpcodeProvider final : public RuntimeOpcodeProvider
+	{
+	public:
+		static bool isSupported();
+
+	public:
+		JitOpcodeProvider();
+		~JitOpcodeProvider();
+
+		void clear();
+		void takeCodeFrom(JitOpcodeProvider& other);
+		bool makeCodeExecutable();
+
+		bool buildRuntimeOpcode(RuntimeOpcodeBuffer& buffer, const Opcode* opcodes, int numOpcodesAvailable, int& outNumOpcodesConsumed, const Runtime& runtime) override;
+
+	private:
+		struct CodePage
+		{
+			uint8* mMemory = nullptr;
+			size_t mSize = 0;
+			size_t mUsed = 0;
+			bool mWritable = false;		// Code pages are never writable and executable at the same time
+		};
+
+	private:
+		uint8* allocateCode(size_t size);
+		bool setPageWritable(CodePage& page, bool writable);
+
+	private:
+		std::vector<CodePage> mCodePages;	// Memory for generated code, never moved as runtime opcodes point into it
+		size_t mTotalCodeSize = 0;
+	};
+}
@@ -136,6 +136,22 @@ namespace lemon
 			*(T*)pointer = swapBytes((T)(*(context.mControlFlow->mValueStackPtr-1)));
 		}
 
+		template<typename T>
+		static void exec_OPT_WRITE_MEMORY_FIXED_ADDR_DIRECT_DIRTY(const RuntimeOpcodeContext context)
+		{
+			uint8* pointer = context.getParameter<uint8*>();
+			*(T*)pointer = (T)(*(context.mControlFlow->mValueStackPtr-1));
+			*context.getParameter<uint8*>(8) = 1;
+		}
+
+		template<typename T>
+		static void exec_OPT_WRITE_MEMORY_FIXED_ADDR_DIRECT_SWAP_DIRTY(const RuntimeOpcodeContext context)
+		{
+			uint8* pointer = context.getParameter<uint8*>();
+			*(T*)pointer = swapBytes((T)(*(context.mControlFlow->mValueStackPtr-1)));
+			*context.getParameter<uint8*>(8) = 1;
+		}
+
 		template<typename T>
 		static void exec_OPT_ADD_CONSTANT(const RuntimeOpcodeContext context)
 		{
@@ -416,7 +432,21 @@ namespace lemon
 					uint64 address = opcodes[0].mParameter;
 					MemoryAccessHandler::SpecializationResult result;
 					runtime.getMemoryAccessHandler()->getDirectAccessSpecialization(result, address, DataTypeHelper::getSizeOfBaseType(opcodes[1].mDataType), true);
-					if (result.mResult == MemoryAccessHandler::SpecializationResult::HAS_SPECIALIZATION)
+					if (result.mResult == MemoryAccessHandler::SpecializationResult::HAS_SPECIALIZATION && nullptr != result.mDirtyFlagPointer)
+					{
+						RuntimeOpcode& runtimeOpcode = buffer.addOpcode(16);
+						if (result.mSwapBytes)
+						{
+							SELECT_EXEC_FUNC_BY_DATATYPE(OptimizedOpcodeExec::exec_OPT_WRITE_MEMORY_FIXED_ADDR_DIRECT_SWAP_DIRTY, opcodes[1].mDataType);
+						}
+						else
+						{
+							SELECT_EXEC_FUNC_BY_DATATYPE(OptimizedOpcodeExec::exec_OPT_WRITE_MEMORY_FIXED_ADDR_DIRECT_DIRTY, opcodes[1].mDataType);
+						}
+						runtimeOpcode.setParameter(result.mDirectAccessPointer);
+						runtimeOpcode.setParameter(result.mDirtyFlagPointer, 8);
+					}
+					else if (result.mResult == MemoryAccessHandler::SpecializationResult::HAS_SPECIALIZATION)
 					{
 						RuntimeOpcode& runtimeOpcode = buffer.addOpcode(8);
 						if (result.mSwapBytes)
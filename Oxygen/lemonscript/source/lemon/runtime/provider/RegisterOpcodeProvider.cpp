@@ -0,0 +1,302 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "lemon/pch.h"
+#include "lemon/runtime/provider/RegisterOpcodeProvider.h"
+#include "lemon/runtime/RuntimeFunction.h"
+#include "lemon/runtime/RuntimeOpcodeContext.h"
+#include "lemon/program/Program.h"
+
+
+namespace lemon
+{
+	namespace
+	{
+		enum class RegisterKind : uint8
+		{
+			LOCAL,		// Local variable, accessed directly
+			CONSTANT,	// Constant value, embedded in the runtime opcode
+			STACK		// Temporary on the value stack
+		};
+
+		struct RegisterOperand
+		{
+			RegisterKind mKind = RegisterKind::STACK;
+			int64 mValue = 0;	// Local variable ID or constant value
+		};
+
+		// Single instruction in register form, i.e. "destination = source0 <operation> source1"
+		struct RegisterInstruction
+		{
+			Opcode::Type mOperation = Opcode::Type::NOP;
+			BaseType mDataType = BaseType::VOID;
+			RegisterOperand mSource[2];
+			RegisterOperand mDestination;
+			int mNumOpcodesConsumed = 0;
+		};
+
+		bool isLocalVariableAccess(const Opcode& opcode, Opcode::Type type)
+		{
+			return (opcode.mType == type && (Variable::Type)((uint32)(opcode.mParameter) >> 28) == Variable::Type::LOCAL);
+		}
+
+		bool readRegisterOperand(RegisterOperand& outOperand, const Opcode& opcode)
+		{
+			if (isLocalVariableAccess(opcode, Opcode::Type::GET_VARIABLE_VALUE))
+			{
+				outOperand.mKind = RegisterKind::LOCAL;
+				outOperand.mValue = (uint32)opcode.mParameter;
+				return true;
+			}
+			if (opcode.mType == Opcode::Type::PUSH_CONSTANT)
+			{
+				outOperand.mKind = RegisterKind::CONSTANT;
+				outOperand.mValue = opcode.mParameter;
+				return true;
+			}
+			return false;
+		}
+
+		bool isLocalVariableAssignment(const Opcode* opcodes, int numOpcodesAvailable)
+		{
+			// Assignment to a local variable, with its result getting discarded right away
+			return (numOpcodesAvailable >= 2 && isLocalVariableAccess(opcodes[0], Opcode::Type::SET_VARIABLE_VALUE) && opcodes[1].mType == Opcode::Type::MOVE_STACK && opcodes[1].mParameter == -1);
+		}
+
+		bool translateToRegisterInstruction(RegisterInstruction& outInstruction, const Opcode* opcodes, int numOpcodesAvailable)
+		{
+			// Copy of a local variable or constant into a local variable
+			if (numOpcodesAvailable >= 3 && readRegisterOperand(outInstruction.mSource[0], opcodes[0]) && isLocalVariableAssignment(&opcodes[1], numOpcodesAvailable - 1))
+			{
+				outInstruction.mOperation = Opcode::Type::SET_VARIABLE_VALUE;
+				outInstruction.mDestination.mKind = RegisterKind::LOCAL;
+				outInstruction.mDestination.mValue = (uint32)opcodes[1].mParameter;
+				outInstruction.mNumOpcodesConsumed = 3;
+				return true;
+			}
+
+			// Read up to two operands that don't need to go through the value stack
+			int numOperands = 0;
+			RegisterOperand operands[2];
+			while (numOperands < 2 && numOperands < numOpcodesAvailable && readRegisterOperand(operands[numOperands], opcodes[numOperands]))
+			{
+				++numOperands;
+			}
+
+			// Binary operation
+			int position = numOperands;
+			if (position >= numOpcodesAvailable)
+				return false;
+			const Opcode& operation = opcodes[position];
+			if (!(operation.mType >= Opcode::Type::ARITHM_ADD && operation.mType <= Opcode::Type::ARITHM_SHR) &&
+				!(operation.mType >= Opcode::Type::COMPARE_EQ && operation.mType <= Opcode::Type::COMPARE_GE))
+				return false;
+			++position;
+
+			// Missing operands are temporaries on the value stack
+			outInstruction.mOperation = operation.mType;
+			outInstruction.mDataType = operation.mDataType;
+			outInstruction.mSource[0] = (numOperands >= 2) ? operands[0] : RegisterOperand();
+			outInstruction.mSource[1] = (numOperands >= 2) ? operands[1] : (numOperands == 1) ? operands[0] : RegisterOperand();
+
+			// Write the result directly into a local variable if it gets assigned to one anyways
+			if (isLocalVariableAssignment(&opcodes[position], numOpcodesAvailable - position))
+			{
+				outInstruction.mDestination.mKind = RegisterKind::LOCAL;
+				outInstruction.mDestination.mValue = (uint32)opcodes[position].mParameter;
+				position += 2;
+			}
+			else
+			{
+				outInstruction.mDestination.mKind = RegisterKind::STACK;
+			}
+			outInstruction.mNumOpcodesConsumed = position;
+			return true;
+		}
+	}
+
+
+	class RegisterOpcodeExec
+	{
+	public:
+		struct OperationADD    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a + b; } };
+		struct OperationSUB    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a - b; } };
+		struct OperationMUL    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a * b; } };
+		struct OperationDIV    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (b == 0) ? 0 : (a / b); } };
+		struct OperationMOD    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (b == 0) ? 0 : (a % b); } };
+		struct OperationAND    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a & b; } };
+		struct OperationOR     { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a | b; } };
+		struct OperationXOR    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a ^ b; } };
+		struct OperationSHL    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a << (b & (sizeof(T) * 8 - 1)); } };
+		struct OperationSHR    { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return a >> (b & (sizeof(T) * 8 - 1)); } };
+		struct OperationCMP_EQ  { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (a == b) ? 1 : 0; } };
+		struct OperationCMP_NEQ { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (a != b) ? 1 : 0; } };
+		struct OperationCMP_LT  { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (a < b) ? 1 : 0; } };
+		struct OperationCMP_LE  { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (a <= b) ? 1 : 0; } };
+		struct OperationCMP_GT  { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (a > b) ? 1 : 0; } };
+		struct OperationCMP_GE  { template<typename T> FORCE_INLINE static int64 apply(T a, T b)  { return (a >= b) ? 1 : 0; } };
+
+		// Parameter layout: Destination local variable ID at offset 0, first source at offset 4, second source at offset 8
+		template<typename T, typename OPERATION, RegisterKind SOURCE0, RegisterKind SOURCE1, RegisterKind DESTINATION>
+		static void exec_REGISTER_BINARY(const RuntimeOpcodeContext context)
+		{
+			ControlFlow& controlFlow = *context.mControlFlow;
+			T b;
+			if constexpr (SOURCE1 == RegisterKind::STACK)
+			{
+				--controlFlow.mValueStackPtr;
+				b = (T)*controlFlow.mValueStackPtr;
+			}
+			else if constexpr (SOURCE1 == RegisterKind::LOCAL)
+			{
+				b = context.readLocalVariable<T>(context.getParameter<uint32>(8));
+			}
+			else
+			{
+				b = (T)context.getParameter<int64>(8);
+			}
+
+			T a;
+			if constexpr (SOURCE0 == RegisterKind::STACK)
+			{
+				--controlFlow.mValueStackPtr;
+				a = (T)*controlFlow.mValueStackPtr;
+			}
+			else
+			{
+				a = context.readLocalVariable<T>(context.getParameter<uint32>(4));
+			}
+
+			const int64 result = OPERATION::apply(a, b);
+			if constexpr (DESTINATION == RegisterKind::LOCAL)
+			{
+				context.writeLocalVariable<int64>(context.getParameter<uint32>(), result);
+			}
+			else
+			{
+				*controlFlow.mValueStackPtr = result;
+				++controlFlow.mValueStackPtr;
+			}
+		}
+
+		static void exec_REGISTER_COPY_LOCAL(const RuntimeOpcodeContext context)
+		{
+			context.writeLocalVariable<int64>(context.getParameter<uint32>(), context.readLocalVariable<int64>(context.getParameter<uint32>(4)));
+		}
+
+		static void exec_REGISTER_COPY_CONSTANT(const RuntimeOpcodeContext context)
+		{
+			context.writeLocalVariable<int64>(context.getParameter<uint32>(), context.getParameter<int64>(8));
+		}
+
+		template<typename OPERATION, RegisterKind SOURCE0, RegisterKind SOURCE1, RegisterKind DESTINATION>
+		static ExecFunc selectByDataType(BaseType dataType)
+		{
+			switch (dataType)
+			{
+				case BaseType::INT_8:		return &exec_REGISTER_BINARY<int8,   OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::INT_16:		return &exec_REGISTER_BINARY<int16,  OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::INT_32:		return &exec_REGISTER_BINARY<int32,  OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::INT_64:		return &exec_REGISTER_BINARY<int64,  OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::UINT_8:		return &exec_REGISTER_BINARY<uint8,  OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::UINT_16:		return &exec_REGISTER_BINARY<uint16, OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::UINT_32:		return &exec_REGISTER_BINARY<uint32, OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::UINT_64:		return &exec_REGISTER_BINARY<uint64, OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				case BaseType::INT_CONST:	return &exec_REGISTER_BINARY<uint64, OPERATION, SOURCE0, SOURCE1, DESTINATION>;
+				default:					return nullptr;
+			}
+		}
+
+		template<RegisterKind SOURCE0, RegisterKind SOURCE1, RegisterKind DESTINATION>
+		static ExecFunc selectByOperation(Opcode::Type operation, BaseType dataType)
+		{
+			switch (operation)
+			{
+				case Opcode::Type::ARITHM_ADD:	return selectByDataType<OperationADD,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_SUB:	return selectByDataType<OperationSUB,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_MUL:	return selectByDataType<OperationMUL,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_DIV:	return selectByDataType<OperationDIV,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_MOD:	return selectByDataType<OperationMOD,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_AND:	return selectByDataType<OperationAND,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_OR:	return selectByDataType<OperationOR,      SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_XOR:	return selectByDataType<OperationXOR,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_SHL:	return selectByDataType<OperationSHL,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::ARITHM_SHR:	return selectByDataType<OperationSHR,     SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::COMPARE_EQ:	return selectByDataType<OperationCMP_EQ,  SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::COMPARE_NEQ:	return selectByDataType<OperationCMP_NEQ, SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::COMPARE_LT:	return selectByDataType<OperationCMP_LT,  SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::COMPARE_LE:	return selectByDataType<OperationCMP_LE,  SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::COMPARE_GT:	return selectByDataType<OperationCMP_GT,  SOURCE0, SOURCE1, DESTINATION>(dataType);
+				case Opcode::Type::COMPARE_GE:	return selectByDataType<OperationCMP_GE,  SOURCE0, SOURCE1, DESTINATION>(dataType);
+				default:						return nullptr;
+			}
+		}
+
+		static ExecFunc selectExecFunc(const RegisterInstruction& instruction)
+		{
+			constexpr RegisterKind L = RegisterKind::LOCAL;
+			constexpr RegisterKind C = RegisterKind::CONSTANT;
+			constexpr RegisterKind S = RegisterKind::STACK;
+
+			// Only combinations that actually save value stack accesses are supported here
+			//  -> Constants as first source are rare and not worth the additional code
+			//  -> Stack and constant sources with a stack destination are covered by the optimized opcode provider already
+			const RegisterKind source0 = instruction.mSource[0].mKind;
+			const RegisterKind source1 = instruction.mSource[1].mKind;
+			if (instruction.mDestination.mKind == RegisterKind::LOCAL)
+			{
+				if (source0 == L && source1 == L)  return selectByOperation<L, L, L>(instruction.mOperation, instruction.mDataType);
+				if (source0 == L && source1 == C)  return selectByOperation<L, C, L>(instruction.mOperation, instruction.mDataType);
+				if (source0 == S && source1 == L)  return selectByOperation<S, L, L>(instruction.mOperation, instruction.mDataType);
+				if (source0 == S && source1 == C)  return selectByOperation<S, C, L>(instruction.mOperation, instruction.mDataType);
+				if (source0 == S && source1 == S)  return selectByOperation<S, S, L>(instruction.mOperation, instruction.mDataType);
+			}
+			else
+			{
+				if (source0 == L && source1 == L)  return selectByOperation<L, L, S>(instruction.mOperation, instruction.mDataType);
+				if (source0 == L && source1 == C)  return selectByOperation<L, C, S>(instruction.mOperation, instruction.mDataType);
+				if (source0 == S && source1 == L)  return selectByOperation<S, L, S>(instruction.mOperation, instruction.mDataType);
+			}
+			return nullptr;
+		}
+	};
+
+
+	bool RegisterOpcodeProvider::buildRuntimeOpcodeStatic(RuntimeOpcodeBuffer& buffer, const Opcode* opcodes, int numOpcodesAvailable, int& outNumOpcodesConsumed, const Runtime& runtime)
+	{
+		RegisterInstruction instruction;
+		if (!translateToRegisterInstruction(instruction, opcodes, numOpcodesAvailable))
+			return false;
+
+		ExecFunc execFunc = nullptr;
+		if (instruction.mOperation == Opcode::Type::SET_VARIABLE_VALUE)
+		{
+			execFunc = (instruction.mSource[0].mKind == RegisterKind::LOCAL) ? &RegisterOpcodeExec::exec_REGISTER_COPY_LOCAL : &RegisterOpcodeExec::exec_REGISTER_COPY_CONSTANT;
+		}
+		else
+		{
+			execFunc = RegisterOpcodeExec::selectExecFunc(instruction);
+			if (nullptr == execFunc)
+				return false;
+		}
+
+		RuntimeOpcode& runtimeOpcode = buffer.addOpcode(16);
+		runtimeOpcode.mExecFunc = execFunc;
+		runtimeOpcode.setParameter((uint32)instruction.mDestination.mValue);
+		runtimeOpcode.setParameter((instruction.mSource[0].mKind == RegisterKind::LOCAL) ? (uint32)instruction.mSource[0].mValue : 0, 4);
+		runtimeOpcode.setParameter((instruction.mSource[0].mKind == RegisterKind::CONSTANT) ? instruction.mSource[0].mValue : instruction.mSource[1].mValue, 8);
+		outNumOpcodesConsumed = instruction.mNumOpcodesConsumed;
+		return true;
+	}
+
+	bool RegisterOpcodeProvider::buildRuntimeOpcode(RuntimeOpcodeBuffer& buffer, const Opcode* opcodes, int numOpcodesAvailable, int& outNumOpcodesConsumed, const Runtime& runtime)
+	{
+		return buildRuntimeOpcodeStatic(buffer, opcodes, numOpcodesAvailable, outNumOpcodesConsumed, runtime);
+	}
+
+}
@@ -0,0 +1,27 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include "lemon/runtime/RuntimeOpcode.h"
+
+
+namespace lemon
+{
+	// Translates value stack opcode sequences into register-form instructions
+	//  -> Local variables serve as registers and get accessed directly, constants are embedded, only temporaries remain on the value stack
+	//  -> Assignments of a result to a local variable get coalesced into the instruction producing that result
+	class RegisterOpcodeProvider final : public RuntimeOpcodeProvider
+	{
+	public:
+		static bool buildRuntimeOpcodeStatic(RuntimeOpcodeBuffer& buffer, const Opcode* opcodes, int numOpcodesAvailable, int& outNumOpcodesConsumed, const Runtime& runtime);
+
+	public:
+		bool buildRuntimeOpcode(RuntimeOpcodeBuffer& buffer, const Opcode* opcodes, int numOpcodesAvailable, int& outNumOpcodesConsumed, const Runtime& runtime) override;
+	};
+}
@@ -16,41 +16,130 @@ namespace lemon
 	{
 		FlyweightStringManager::FlyweightStringManager()
 		{
-			mAllocPool.setPageSize(0x20000);
+			for (Shard& shard : mShards)
+			{
+				shard.mAllocPool.setPageSize(0x20000);
+			}
 		}
-	}
-
 
-	void FlyweightString::set(uint64 hash)
-	{
-		const auto it = mManager.mEntryMap.find(hash);
-		mEntry = (it == mManager.mEntryMap.end()) ? nullptr : it->second;
-	}
+		FlyweightStringManager::~FlyweightStringManager()
+		{
+			for (Shard& shard : mShards)
+			{
+				Table* table = shard.mTable.load();
+				while (nullptr != table)
+				{
+					Table* previousTable = table->mPreviousTable;
+					delete[] table->mSlots;
+					delete table;
+					table = previousTable;
+				}
+			}
+		}
 
-	void FlyweightString::set(uint64 hash, std::string_view name)
-	{
-		using Entry = detail::FlyweightStringManager::Entry;
+		FlyweightStringManager::Entry* FlyweightStringManager::findEntry(uint64 hash) const
+		{
+			const Table* table = mShards[getShardIndex(hash)].mTable.load(std::memory_order_acquire);
+			return (nullptr == table) ? nullptr : findEntryInTable(*table, hash);
+		}
 
-		Entry*& entry = mManager.mEntryMap[hash];
-		if (nullptr == entry)
+		FlyweightStringManager::Entry* FlyweightStringManager::getOrCreateEntry(uint64 hash, std::string_view name)
 		{
+			// Most strings already exist, so first try without locking
+			Entry* entry = findEntry(hash);
+			if (nullptr != entry)
+				return entry;
+
+			Shard& shard = mShards[getShardIndex(hash)];
+			std::lock_guard<std::mutex> lock(shard.mInsertionMutex);
+
+			// Check again, another thread could have added the same string in the meantime
+			Table* table = shard.mTable.load(std::memory_order_relaxed);
+			if (nullptr != table)
+			{
+				entry = findEntryInTable(*table, hash);
+				if (nullptr != entry)
+					return entry;
+			}
+
+			// Keep the load factor below 50%, so that probing sequences stay short
+			if (nullptr == table || (shard.mNumEntries + 1) * 2 > table->mMask + 1)
+			{
+				Table* newTable = createTable((nullptr == table) ? INITIAL_TABLE_SIZE : (table->mMask + 1) * 2);
+				if (nullptr != table)
+				{
+					for (size_t index = 0; index <= table->mMask; ++index)
+					{
+						Entry* existingEntry = table->mSlots[index].load(std::memory_order_relaxed);
+						if (nullptr != existingEntry)
+							insertEntryIntoTable(*newTable, *existingEntry);
+					}
+				}
+				newTable->mPreviousTable = table;
+				shard.mTable.store(newTable, std::memory_order_release);
+				table = newTable;
+			}
+
 			// Allocate enough memory to hold both the Entry struct and the string content
 			const size_t requiredSize = sizeof(Entry) + name.length();
-			uint8* entryPointer = mManager.mAllocPool.allocateMemory(requiredSize);
+			uint8* entryPointer = shard.mAllocPool.allocateMemory(requiredSize);
 
 			// Initialize the entry and data
-			mEntry = new (static_cast<void*>(entryPointer)) Entry();
+			entry = new (static_cast<void*>(entryPointer)) Entry();
 			uint8* contentPointer = entryPointer + sizeof(Entry);
 			memcpy(contentPointer, name.data(), name.length());
 
-			mEntry->mHash = hash;
-			mEntry->mString = std::string_view((const char*)contentPointer, name.length());
-			entry = mEntry;
+			entry->mHash = hash;
+			entry->mString = std::string_view((const char*)contentPointer, name.length());
+
+			// Publish the fully initialized entry
+			insertEntryIntoTable(*table, *entry);
+			++shard.mNumEntries;
+			return entry;
 		}
-		else
+
+		FlyweightStringManager::Entry* FlyweightStringManager::findEntryInTable(const Table& table, uint64 hash)
+		{
+			for (size_t index = (size_t)hash & table.mMask; ; index = (index + 1) & table.mMask)
+			{
+				Entry* entry = table.mSlots[index].load(std::memory_order_acquire);
+				if (nullptr == entry || entry->mHash == hash)
+					return entry;
+			}
+		}
+
+		void FlyweightStringManager::insertEntryIntoTable(Table& table, Entry& entry)
 		{
-			mEntry = entry;
+			size_t index = (size_t)entry.mHash & table.mMask;
+			while (nullptr != table.mSlots[index].load(std::memory_order_relaxed))
+			{
+				index = (index + 1) & table.mMask;
+			}
+			table.mSlots[index].store(&entry, std::memory_order_release);
 		}
+
+		FlyweightStringManager::Table* FlyweightStringManager::createTable(size_t size)
+		{
+			Table* table = new Table();
+			table->mMask = size - 1;
+			table->mSlots = new std::atomic<Entry*>[size];
+			for (size_t index = 0; index < size; ++index)
+			{
+				table->mSlots[index].store(nullptr, std::memory_order_relaxed);
+			}
+			return table;
+		}
+	}
+
+
+	void FlyweightString::set(uint64 hash)
+	{
+		mEntry = mManager.findEntry(hash);
+	}
+
+	void FlyweightString::set(uint64 hash, std::string_view name)
+	{
+		mEntry = mManager.getOrCreateEntry(hash, name);
 	}
 
 	void FlyweightString::set(std::string_view name)
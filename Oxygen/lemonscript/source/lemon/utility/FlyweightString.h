@@ -10,11 +10,16 @@
 
 #include <rmxbase.h>
 
+#include <atomic>
+#include <mutex>
+
 
 namespace lemon
 {
 	namespace detail
 	{
+		// Thread-safe interning of flyweight strings
+		//  -> Lookups don't lock and don't wait for other threads, only insertions of new strings lock a single shard
 		class FlyweightStringManager
 		{
 		public:
@@ -26,10 +31,41 @@ namespace lemon
 
 		public:
 			FlyweightStringManager();
+			~FlyweightStringManager();
 
-		public:
-			rmx::OneTimeAllocPool mAllocPool;
-			std::unordered_map<uint64, Entry*> mEntryMap;
+			Entry* findEntry(uint64 hash) const;
+			Entry* getOrCreateEntry(uint64 hash, std::string_view name);
+
+		private:
+			// Open addressing hash table with linear probing, that gets replaced by a larger one when needed
+			//  -> Replaced tables are kept alive, as there might still be concurrent lookups reading them
+			struct Table
+			{
+				size_t mMask = 0;
+				std::atomic<Entry*>* mSlots = nullptr;
+				Table* mPreviousTable = nullptr;
+			};
+
+			struct Shard
+			{
+				std::atomic<Table*> mTable { nullptr };
+				size_t mNumEntries = 0;
+				std::mutex mInsertionMutex;
+				rmx::OneTimeAllocPool mAllocPool;
+			};
+
+			static const constexpr size_t NUM_SHARDS = 32;		// Must be a power of two
+			static const constexpr size_t INITIAL_TABLE_SIZE = 256;
+
+		private:
+			inline static size_t getShardIndex(uint64 hash)  { return (size_t)(hash >> 32) & (NUM_SHARDS - 1); }
+
+			static Entry* findEntryInTable(const Table& table, uint64 hash);
+			static void insertEntryIntoTable(Table& table, Entry& entry);
+			static Table* createTable(size_t size);
+
+		private:
+			Shard mShards[NUM_SHARDS];
 		};
 	}
 
@@ -58,10 +58,11 @@ public:
 	bool hasKeyboard() const;
 	bool hasVirtualGamepad() const;
 
+	bool updateLoading();
+
 private:
 	int updateWindowDisplayIndex();
 	void setUnscaledWindow();
-	bool updateLoading();
 	void setPausedByFocusLoss(bool enable);
 
 private:
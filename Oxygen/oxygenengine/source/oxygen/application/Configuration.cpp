@@ -226,6 +226,7 @@ Configuration::Configuration()
 #if defined(PLATFORM_WEB)
 	// Threading in general is not (afaik) supported by emscripten
 	mUseAudioThreading = false;
+	mSoftwareRenderingThreads = 1;
 #endif
 
 }
@@ -312,7 +313,10 @@ bool Configuration::loadSettings(const std::wstring& filename, SettingsType sett
 		if (rootHelper.tryReadBool("FailSafeMode", mFailSafeMode))
 		{
 			if (mFailSafeMode)
+			{
 				mUseAudioThreading = false;
+				mSoftwareRenderingThreads = 1;
+			}
 		}
 
 		// Graphics
@@ -357,9 +361,11 @@ bool Configuration::loadSettings(const std::wstring& filename, SettingsType sett
 
 		// Game recorder
 		rootHelper.tryReadInt("GameRecordingMode", mGameRecorder.mRecordingMode);
+		rootHelper.tryReadInt("RewindMemoryBudget", mRewindMemoryBudget);
 
 		// Script
 		rootHelper.tryReadInt("ScriptOptimizationLevel", mScriptOptimizationLevel);
+		rootHelper.tryReadBool("LazyScriptFunctionBuilding", mLazyScriptFunctionBuilding);
 
 		// Mod settings
 		loadModSettings(root, mModSettings);
@@ -474,9 +480,11 @@ void Configuration::saveSettings()
 
 		// Game recorder
 		root["GameRecordingMode"] = mGameRecorder.mRecordingMode;
+		root["RewindMemoryBudget"] = mRewindMemoryBudget;
 
 		// Script
 		root["ScriptOptimizationLevel"] = mScriptOptimizationLevel;
+		root["LazyScriptFunctionBuilding"] = mLazyScriptFunctionBuilding;
 
 		// Mod settings
 		saveModSettings(root, mModSettings);
@@ -616,6 +624,10 @@ void Configuration::loadConfigurationProperties(JsonHelper& rootHelper)
 	rootHelper.tryReadInt("Scanlines", mScanlines);
 	rootHelper.tryReadInt("BackgroundBlur", mBackgroundBlur);
 	rootHelper.tryReadInt("PerformanceDisplay", mPerformanceDisplay);
+#if !defined(PLATFORM_WEB)
+	if (!mFailSafeMode)
+		rootHelper.tryReadInt("SoftwareRenderingThreads", mSoftwareRenderingThreads);
+#endif
 	tryReadRenderMethod(rootHelper, mFailSafeMode, mRenderMethod, mAutoDetectRenderMethod);
 
 	// Audio
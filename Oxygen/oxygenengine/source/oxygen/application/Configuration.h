@@ -53,6 +53,7 @@ public:
 		bool mIsPlayback = false;
 		int mPlaybackStartFrame = 0;
 		bool mPlaybackIgnoreKeys = false;
+		std::wstring mPlaybackFilename;	// If empty, "gamerecording.bin" or "gamerec.bin" gets used
 	};
 
 	struct VirtualGamepad
@@ -141,6 +142,7 @@ public:
 	int  mStartPhase = 0;
 	int  mSimulationFrequency = 60;
 	GameRecorder mGameRecorder;
+	int  mRewindMemoryBudget = 0;		// In MB, 0 disables the rewind buffer
 
 	// Dev mode
 	DevModeSettings mDevMode;
@@ -160,6 +162,7 @@ public:
 	int   mBackgroundBlur = 0;
 	bool  mFullEmulationRendering = true;
 	int   mPerformanceDisplay = 0;
+	int   mSoftwareRenderingThreads = 0;	// 0: Auto-detect, 1: Single-threaded, higher values: Number of threads rendering the game screen in horizontal bands
 
 	// Audio
 	int   mAudioSampleRate = 48000;
@@ -182,7 +185,8 @@ public:
 
 	// Internal
 	bool mForceCompileScripts = false;
-	int mScriptOptimizationLevel = -1;		// -1: Auto, 0: No optimization at all, up to 3: Full optimization
+	int mScriptOptimizationLevel = -1;		// -1: Auto, 0: No optimization at all, up to 3: Full optimization, 4: Like 3 + register-form opcodes, 5: Like 4 + JIT compilation of hot functions (x86-64 only)
+	bool mLazyScriptFunctionBuilding = true;	// If set, runtime functions are only built when they're needed for the first time
 	std::wstring mCompiledScriptSavePath;
 	bool mEnableROMDataAnalyser = false;
 	bool mExitAfterScriptLoading = false;
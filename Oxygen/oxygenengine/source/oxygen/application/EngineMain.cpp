@@ -11,6 +11,7 @@
 #include "oxygen/application/Application.h"
 #include "oxygen/application/Configuration.h"
 #include "oxygen/application/GameProfile.h"
+#include "oxygen/application/HeadlessRunner.h"
 #include "oxygen/application/audio/AudioOutBase.h"
 #include "oxygen/application/input/ControlsIn.h"
 #include "oxygen/application/input/InputManager.h"
@@ -107,6 +108,21 @@ void EngineMain::execute(int argc, char** argv)
 	shutdown();
 }
 
+bool EngineMain::executeHeadless(int argc, char** argv, HeadlessRunner& headlessRunner)
+{
+	// Same as "execute", except that there's no window, no audio device and no rendering
+	mHeadlessRunner = &headlessRunner;
+
+	// Use SDL's dummy drivers, so that this works on machines without any display or audio device as well
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", true);
+	SDL_setenv("SDL_AUDIODRIVER", "dummy", true);
+
+	execute(argc, argv);
+
+	mHeadlessRunner = nullptr;
+	return (headlessRunner.getResult().mFramesSimulated > 0 && headlessRunner.getResult().mFailedSegments == 0);
+}
+
 void EngineMain::onActiveModsChanged()
 {
 	// Update sprites
@@ -295,6 +311,11 @@ bool EngineMain::startupEngine()
 	if (!initConfigAndSettings(argumentProjectPath))
 		return false;
 
+	if (isHeadless())
+	{
+		mHeadlessRunner->applyConfiguration(config);
+	}
+
 	// Setup file system
 	RMX_LOG_INFO("File system setup");
 	if (!initFileSystem())
@@ -309,11 +330,21 @@ bool EngineMain::startupEngine()
 	}
 
 	// Video
-	RMX_LOG_INFO("Video initialization...");
-	if (!createWindow())
+	if (isHeadless())
 	{
-		RMX_ERROR("Unable to create window" << (config.mFailSafeMode ? " in fail-safe mode" : "") << " with error: " << SDL_GetError(), );
-		return false;
+		// No window, the software drawer is only needed for the game screen texture
+		RMX_LOG_INFO("Video initialization (headless)...");
+		config.mRenderMethod = Configuration::RenderMethod::SOFTWARE;
+		mDrawer.createDrawer<SoftwareDrawer>();
+	}
+	else
+	{
+		RMX_LOG_INFO("Video initialization...");
+		if (!createWindow())
+		{
+			RMX_ERROR("Unable to create window" << (config.mFailSafeMode ? " in fail-safe mode" : "") << " with error: " << SDL_GetError(), );
+			return false;
+		}
 	}
 
 	RMX_LOG_INFO("Startup of VideoOut");
@@ -327,8 +358,11 @@ bool EngineMain::startupEngine()
 	mInternal.mControlsIn.startup();
 
 	// Audio
-	RMX_LOG_INFO("Audio initialization...");
-	FTX::Audio->initialize(config.mAudioSampleRate, 2, 1024);
+	if (!isHeadless())
+	{
+		RMX_LOG_INFO("Audio initialization...");
+		FTX::Audio->initialize(config.mAudioSampleRate, 2, 1024);
+	}
 
 	RMX_LOG_INFO("Startup of AudioOut");
 	mAudioOut = &EngineMain::getDelegate().createAudioOut();
@@ -347,7 +381,15 @@ void EngineMain::run()
 	RMX_LOG_INFO("Starting main application loop");
 
 	Application application;
-	FTX::System->run(application);
+	if (isHeadless())
+	{
+		mHeadlessRunner->run(application);
+		application.deinitialize();
+	}
+	else
+	{
+		FTX::System->run(application);
+	}
 }
 
 void EngineMain::shutdown()
@@ -14,6 +14,7 @@
 class AudioOutBase;
 class CodeExec;
 class Configuration;
+class HeadlessRunner;
 class LogDisplay;
 
 namespace lemon
@@ -82,6 +83,9 @@ public:
 	~EngineMain();
 
 	void execute(int argc, char** argv);
+	bool executeHeadless(int argc, char** argv, HeadlessRunner& headlessRunner);
+
+	inline bool isHeadless() const  { return (nullptr != mHeadlessRunner); }
 
 	void onActiveModsChanged();
 
@@ -108,6 +112,7 @@ private:
 private:
 	EngineDelegateInterface& mDelegate;
 	std::vector<std::string> mArguments;
+	HeadlessRunner* mHeadlessRunner = nullptr;
 
 	struct Internal;
 	Internal& mInternal;
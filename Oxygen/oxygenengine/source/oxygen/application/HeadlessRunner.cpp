@@ -0,0 +1,275 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "oxygen/pch.h"
+#include "oxygen/application/HeadlessRunner.h"
+#include "oxygen/application/Application.h"
+#include "oxygen/application/Configuration.h"
+#include "oxygen/application/EngineMain.h"
+#include "oxygen/application/GameLoader.h"
+#include "oxygen/application/audio/AudioOutBase.h"
+#include "oxygen/application/input/ControlsIn.h"
+#include "oxygen/helper/HighResolutionTimer.h"
+#include "oxygen/helper/Logging.h"
+#include "oxygen/simulation/CodeExec.h"
+#include "oxygen/simulation/GameRecorder.h"
+#include "oxygen/simulation/EmulatorInterface.h"
+#include "oxygen/simulation/ReplayVerifier.h"
+
+
+bool HeadlessRunner::readArguments(int argc, char** argv, Options& outOptions)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string parameter(argv[i]);
+		const bool hasValue = (i + 1 < argc);
+		if (parameter == "-rom" && hasValue)
+		{
+			outOptions.mRomPath = String(argv[++i]).toStdWString();
+		}
+		else if (parameter == "-scripts" && hasValue)
+		{
+			outOptions.mScriptsPath = String(argv[++i]).toStdWString();
+		}
+		else if (parameter == "-frames" && hasValue)
+		{
+			outOptions.mMaxFrames = (uint32)std::max(String(argv[++i]).parseInt(), 0);
+		}
+		else if (parameter == "-verify")
+		{
+			outOptions.mVerify = true;
+		}
+		else if (parameter == "-threads" && hasValue)
+		{
+			outOptions.mNumThreads = (uint32)std::max(String(argv[++i]).parseInt(), 0);
+		}
+		else if (parameter == "-rollback" && hasValue)
+		{
+			outOptions.mRollbackFrames = (uint32)std::max(String(argv[++i]).parseInt(), 0);
+		}
+		else if (parameter[0] != '-')
+		{
+			outOptions.mRecordingPath = String(parameter).toStdWString();
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return !outOptions.mRecordingPath.empty();
+}
+
+void HeadlessRunner::makePathsAbsolute(Options& options)
+{
+	// Paths given as arguments are relative to the working directory at the time of the call, which may change afterwards
+	std::wstring currentDirectory = rmx::FileSystem::getCurrentDirectory();
+	if (currentDirectory.empty())
+		return;
+	rmx::FileSystem::normalizePath(currentDirectory, true);
+
+	for (std::wstring* path : { &options.mRomPath, &options.mScriptsPath, &options.mRecordingPath })
+	{
+		if (path->empty())
+			continue;
+
+		const bool isAbsolute = ((*path)[0] == L'/' || (*path)[0] == L'\\' || (path->length() >= 2 && (*path)[1] == L':'));
+		if (!isAbsolute)
+		{
+			*path = currentDirectory + *path;
+		}
+	}
+}
+
+void HeadlessRunner::printUsage()
+{
+	std::cout << "Usage: <executable> [-rom <rom file>] [-scripts <main script file>] [-frames <max frames>] [-verify [-threads <number>]] [-rollback <frames>] <game recording file>" << std::endl;
+}
+
+HeadlessRunner::HeadlessRunner(const Options& options) :
+	mOptions(options)
+{
+}
+
+void HeadlessRunner::applyConfiguration(Configuration& config) const
+{
+	// Never write back any settings changes, as multiple headless instances may run at the same time
+	config.setSettingsReadOnly(true);
+
+	if (!mOptions.mRomPath.empty())
+	{
+		// Last known ROM location gets checked early on in "ResourcesCache::loadRom"
+		config.mLastRomPath = mOptions.mRomPath;
+	}
+
+	if (!mOptions.mScriptsPath.empty())
+	{
+		std::wstring path = mOptions.mScriptsPath;
+		FTX::FileSystem->normalizePath(path, false);
+		const size_t slashPosition = path.find_last_of(L'/');
+		config.mScriptsDir = (slashPosition == std::wstring::npos) ? L"./" : path.substr(0, slashPosition + 1);
+		config.mMainScriptName = (slashPosition == std::wstring::npos) ? path : path.substr(slashPosition + 1);
+	}
+
+	config.mGameRecorder.mIsPlayback = true;
+	config.mGameRecorder.mPlaybackFilename = mOptions.mRecordingPath;
+	config.mGameRecorder.mPlaybackStartFrame = 0;
+	config.mGameRecorder.mPlaybackIgnoreKeys = (mOptions.mRollbackFrames > 0);	// Loading keyframes would get in the way of re-simulating frames
+	config.mStartPhase = 3;
+	config.evaluateGameRecording();
+}
+
+bool HeadlessRunner::run(Application& application)
+{
+	// The GUI hierarchy gets built, as the game may call into it, but it never gets rendered
+	application.initialize();
+
+	// Load the game synchronously
+	while (GameLoader::instance().isLoading())
+	{
+		if (!application.updateLoading() || GameLoader::instance().getState() == GameLoader::State::WAITING_FOR_ROM)
+		{
+			RMX_LOG_INFO("Headless: Game loading failed");
+			return false;
+		}
+	}
+
+	Simulation& simulation = application.getSimulation();
+	if (!simulation.getGameRecorder().isPlaying())
+	{
+		RMX_LOG_INFO("Headless: Could not load game recording '" << WString(mOptions.mRecordingPath).toStdString() << "'");
+		return false;
+	}
+
+	if (mOptions.mVerify)
+	{
+		return runVerification(simulation);
+	}
+
+	simulation.setRunning(true);
+
+	RMX_LOG_INFO("Headless: Starting playback of " << simulation.getGameRecorder().getCurrentNumberOfFrames() << " frames");
+
+	AudioOutBase& audioOut = EngineMain::instance().getAudioOut();
+	HighResolutionTimer timer;
+	timer.start();
+
+	std::deque<RollbackFrame> rollbackFrames;
+
+	mResult.mFramesSimulated = 0;
+	while (simulation.getGameRecorder().isPlaying())
+	{
+		if (mOptions.mMaxFrames != 0 && mResult.mFramesSimulated >= mOptions.mMaxFrames)
+			break;
+
+		if (mOptions.mRollbackFrames > 0)
+		{
+			if (!simulation.saveSnapshot(rollbackFrames.emplace_back().mSnapshot))
+				rollbackFrames.clear();
+		}
+
+		if (!simulation.generateFrame())
+			break;
+		++mResult.mFramesSimulated;
+
+		if (!rollbackFrames.empty())
+		{
+			rollbackFrames.back().mInputs[0] = ControlsIn::instance().getInputPad(0);
+			rollbackFrames.back().mInputs[1] = ControlsIn::instance().getInputPad(1);
+			if (rollbackFrames.size() > mOptions.mRollbackFrames)
+				rollbackFrames.pop_front();
+			if (rollbackFrames.size() == mOptions.mRollbackFrames)
+				runRollback(simulation, rollbackFrames);
+		}
+
+		// Sounds started by scripts are never played back, so get rid of them regularly
+		if ((mResult.mFramesSimulated % 60) == 0)
+		{
+			audioOut.getAudioPlayer().clearPlayback();
+		}
+	}
+
+	mResult.mSecondsElapsed = timer.getSecondsSinceStart();
+	const double framesPerSecond = (mResult.mSecondsElapsed > 0.0) ? (double)mResult.mFramesSimulated / mResult.mSecondsElapsed : 0.0;
+	RMX_LOG_INFO("Headless: Simulated " << mResult.mFramesSimulated << " frames in " << mResult.mSecondsElapsed << " seconds (" << framesPerSecond << " frames per second)");
+	if (mResult.mRollbacks > 0)
+	{
+		RMX_LOG_INFO("Headless: Rollbacks by " << mOptions.mRollbackFrames << " frames took " << (mResult.mRollbackSecondsTotal * 1000.0 / mResult.mRollbacks) << " ms on average, " << (mResult.mRollbackSecondsMax * 1000.0) << " ms at most, " << mResult.mRollbackMismatches << " mismatches");
+	}
+	return true;
+}
+
+bool HeadlessRunner::runVerification(Simulation& simulation)
+{
+	RMX_LOG_INFO("Headless: Starting verification of " << simulation.getGameRecorder().getCurrentNumberOfFrames() << " frames");
+
+	HighResolutionTimer timer;
+	timer.start();
+
+	ReplayVerifier replayVerifier;
+	replayVerifier.verify(simulation.getGameRecorder(), simulation.getCodeExec().getLemonScriptProgram(), (size_t)mOptions.mNumThreads);
+	const ReplayVerifier::Result& result = replayVerifier.getResult();
+
+	mResult.mFramesSimulated = result.mFramesSimulated;
+	mResult.mFailedSegments = result.mFailedSegments;
+	mResult.mSecondsElapsed = timer.getSecondsSinceStart();
+
+	for (const ReplayVerifier::Segment& segment : result.mSegments)
+	{
+		if (!segment.mSuccess)
+		{
+			RMX_LOG_INFO("Headless: Verification failed for frames " << segment.mStartFrame << " to " << segment.mEndFrame);
+		}
+	}
+	RMX_LOG_INFO("Headless: Verified " << result.mSegments.size() << " segments with " << mResult.mFramesSimulated << " frames in " << mResult.mSecondsElapsed << " seconds, " << mResult.mFailedSegments << " segments failed");
+	return !result.mSegments.empty();
+}
+
+void HeadlessRunner::runRollback(Simulation& simulation, const std::deque<RollbackFrame>& rollbackFrames)
+{
+	// Go back to the oldest snapshot and simulate all frames since then again, which is expected to arrive at the very same state
+	const uint64 ramHash = rmx::getMurmur2_64(simulation.getCodeExec().getEmulatorInterface().getRam(), 0x10000);
+
+	static std::vector<uint16> inputPads;
+	inputPads.clear();
+	for (const RollbackFrame& rollbackFrame : rollbackFrames)
+	{
+		inputPads.push_back(rollbackFrame.mInputs[0]);
+		inputPads.push_back(rollbackFrame.mInputs[1]);
+	}
+
+	HighResolutionTimer timer;
+	timer.start();
+	const bool success = simulation.restoreSnapshot(rollbackFrames.front().mSnapshot) && simulation.resimulateFrames(&inputPads[0], (uint32)rollbackFrames.size());
+	const double seconds = timer.getSecondsSinceStart();
+
+	++mResult.mRollbacks;
+	mResult.mRollbackSecondsTotal += seconds;
+	mResult.mRollbackSecondsMax = std::max(mResult.mRollbackSecondsMax, seconds);
+	if (!success || rmx::getMurmur2_64(simulation.getCodeExec().getEmulatorInterface().getRam(), 0x10000) != ramHash)
+		++mResult.mRollbackMismatches;
+}
+
+void HeadlessRunner::printResult() const
+{
+	// Written to the standard output as well, so that scripts calling the headless runner don't have to parse the log
+	const double framesPerSecond = (mResult.mSecondsElapsed > 0.0) ? (double)mResult.mFramesSimulated / mResult.mSecondsElapsed : 0.0;
+	std::cout << "Frames simulated: " << mResult.mFramesSimulated << std::endl;
+	std::cout << "Seconds elapsed: " << mResult.mSecondsElapsed << std::endl;
+	std::cout << "Frames per second: " << framesPerSecond << std::endl;
+	if (mOptions.mVerify)
+	{
+		std::cout << "Failed segments: " << mResult.mFailedSegments << std::endl;
+	}
+	if (mResult.mRollbacks > 0)
+	{
+		std::cout << "Rollbacks: " << mResult.mRollbacks << std::endl;
+		std::cout << "Rollback milliseconds average: " << (mResult.mRollbackSecondsTotal * 1000.0 / mResult.mRollbacks) << std::endl;
+		std::cout << "Rollback milliseconds max: " << (mResult.mRollbackSecondsMax * 1000.0) << std::endl;
+		std::cout << "Rollback mismatches: " << mResult.mRollbackMismatches << std::endl;
+	}
+}
@@ -0,0 +1,72 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include "oxygen/simulation/Simulation.h"
+
+class Application;
+class Configuration;
+
+
+// Runs the simulation without window, audio device or frame pacing, e.g. for batch playback of game recordings
+class HeadlessRunner
+{
+public:
+	struct Options
+	{
+		std::wstring mRomPath;			// Optional, otherwise the usual ROM search is used
+		std::wstring mScriptsPath;		// Optional path of the main script file, otherwise the configuration's scripts are used
+		std::wstring mRecordingPath;	// Game recording to play back
+		uint32 mMaxFrames = 0;			// Maximum number of frames to simulate, or 0 to play back the whole recording
+		bool mVerify = false;			// Instead of playing back the recording, verify it by re-simulating the segments between its keyframes in parallel
+		uint32 mNumThreads = 0;			// Number of threads for verification, or 0 to use all hardware threads
+		uint32 mRollbackFrames = 0;		// If set, roll back by this many frames after each frame during playback, to measure the time needed for re-simulation
+	};
+
+	struct Result
+	{
+		uint32 mFramesSimulated = 0;
+		uint32 mFailedSegments = 0;		// Only used for verification
+		double mSecondsElapsed = 0.0;
+		uint32 mRollbacks = 0;			// Only used for rollback measurement
+		uint32 mRollbackMismatches = 0;	// Number of rollbacks that did not end up in the same RAM contents
+		double mRollbackSecondsTotal = 0.0;
+		double mRollbackSecondsMax = 0.0;
+	};
+
+public:
+	static bool readArguments(int argc, char** argv, Options& outOptions);
+	static void makePathsAbsolute(Options& options);
+	static void printUsage();
+
+public:
+	explicit HeadlessRunner(const Options& options);
+
+	inline const Options& getOptions() const  { return mOptions; }
+	inline const Result& getResult() const	  { return mResult; }
+
+	void applyConfiguration(Configuration& config) const;
+	bool run(Application& application);
+	void printResult() const;
+
+private:
+	struct RollbackFrame
+	{
+		Simulation::Snapshot mSnapshot;		// State at the start of the frame
+		uint16 mInputs[2] = { 0, 0 };
+	};
+
+private:
+	bool runVerification(Simulation& simulation);
+	void runRollback(Simulation& simulation, const std::deque<RollbackFrame>& rollbackFrames);
+
+private:
+	Options mOptions;
+	Result mResult;
+};
@@ -83,11 +83,15 @@ bool AudioOutBase::isPlayingSfxId(uint64 sfxId) const
 
 bool AudioOutBase::playAudioBase(uint64 sfxId, uint8 contextId)
 {
+	if (mMuted)
+		return true;	// Count as handled, there's no need for the caller to try again
 	return mAudioPlayer.playAudio(sfxId, contextId);
 }
 
 void AudioOutBase::playOverride(uint64 sfxId, uint8 contextId, uint8 channelId, uint8 overriddenChannelId)
 {
+	if (mMuted)
+		return;
 	mAudioPlayer.playOverride(sfxId, contextId, channelId, overriddenChannelId);
 }
 
@@ -60,6 +60,10 @@ public:
 	inline float getGlobalVolume() const   { return mGlobalVolume; }
 	void setGlobalVolume(float volume);
 
+	// While muted, starting new audio via "playAudioBase" and "playOverride" does nothing (e.g. for frames that get simulated again after a rollback)
+	inline bool isMuted() const			   { return mMuted; }
+	inline void setMuted(bool muted)	   { mMuted = muted; }
+
 	AudioKeyType getAudioKeyType(uint64 sfxId) const;
 	bool isPlayingSfxId(uint64 sfxId) const;
 
@@ -82,4 +86,5 @@ protected:
 	AudioCollection mAudioCollection;
 	AudioPlayer mAudioPlayer;
 	float mGlobalVolume = 1.0f;
+	bool mMuted = false;
 };
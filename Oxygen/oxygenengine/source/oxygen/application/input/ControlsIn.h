@@ -11,7 +11,7 @@
 #include <rmxbase.h>
 
 
-class ControlsIn : public SingleInstance<ControlsIn>
+class ControlsIn : public ThreadLocalInstance<ControlsIn>
 {
 public:
 	enum class Button
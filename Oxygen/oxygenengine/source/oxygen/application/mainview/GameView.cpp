@@ -425,6 +425,16 @@ void GameView::keyboard(const rmx::KeyboardEvent& ev)
 						mSimulation.setNextSingleStep(true, FTX::keyState(SDLK_LSHIFT) || FTX::keyState(SDLK_LCTRL));
 						break;
 					}
+
+					case SDLK_KP_8:
+					{
+						// Step back one frame, or one second with Shift
+						if (mSimulation.rewindFrames(FTX::keyState(SDLK_LSHIFT) ? 60 : 1))
+						{
+							mSimulation.setNextSingleStep(false);
+						}
+						break;
+					}
 				}
 			}
 		}
@@ -11,19 +11,19 @@
 #include "oxygen/helper/Utils.h"
 
 
-bool FilePackage::loadPackage(const std::wstring& packageFilename, std::map<std::wstring, PackedFile>& outPackedFiles, InputStream*& inputStream, bool forceLoadAll)
+bool FilePackage::loadPackage(const std::wstring& packageFilename, std::map<std::wstring, PackedFile>& outPackedFiles)
 {
 	// Try to load the package
-	RMX_ASSERT(nullptr == inputStream, "Input stream was already opened");
-	inputStream = FTX::FileSystem->createInputStream(packageFilename);
-	if (nullptr == inputStream)
+	//  -> This is usually a memory-mapped file, so entry contents get read from disk only when accessed
+	rmx::FileView packageView;
+	if (!FTX::FileSystem->mapFile(packageFilename, packageView))
 		return false;
 
-	std::vector<uint8> content;
-	content.resize(PackageHeader::HEADER_SIZE);
-	if (inputStream->read(&content[0], PackageHeader::HEADER_SIZE) != PackageHeader::HEADER_SIZE)
+	if (packageView.getSize() < PackageHeader::HEADER_SIZE)
 		return false;
 
+	std::vector<uint8> content(packageView.getData(), packageView.getData() + PackageHeader::HEADER_SIZE);
+
 	VectorBinarySerializer serializer(true, content);
 	PackageHeader header;
 	if (!readPackageHeader(header, serializer))
@@ -34,11 +34,11 @@ bool FilePackage::loadPackage(const std::wstring& packageFilename, std::map<std:
 	}
 
 	// Load table of contents
-	content.resize(PackageHeader::HEADER_SIZE + header.mEntryHeaderSize);
-	if (inputStream->read(&content[PackageHeader::HEADER_SIZE], header.mEntryHeaderSize) != header.mEntryHeaderSize)
+	if (packageView.getSize() < PackageHeader::HEADER_SIZE + (size_t)header.mEntryHeaderSize)
 		return false;
+	content.insert(content.end(), packageView.getData() + PackageHeader::HEADER_SIZE, packageView.getData() + PackageHeader::HEADER_SIZE + header.mEntryHeaderSize);
 
-	// Read entry headers
+	// Read entry headers, and refer to the entry contents inside the package
 	for (size_t i = 0; i < header.mNumEntries; ++i)
 	{
 		const std::wstring key = serializer.read<std::wstring>();
@@ -46,26 +46,15 @@ bool FilePackage::loadPackage(const std::wstring& packageFilename, std::map<std:
 		packedFile.mPath = key;
 		packedFile.mPositionInFile = serializer.read<uint32>();
 		packedFile.mSizeInFile = serializer.read<uint32>();
-	}
-
-	if (forceLoadAll)
-	{
-		// Read entry contents
-		for (auto& pair : outPackedFiles)
-		{
-			pair.second.mContent.resize((size_t)pair.second.mSizeInFile);
-			inputStream->setPosition(pair.second.mPositionInFile);
-			const size_t bytesRead = inputStream->read(&pair.second.mContent[0], (size_t)pair.second.mSizeInFile);
-			RMX_CHECK(pair.second.mSizeInFile == bytesRead, "Failed to load entry '" << WString(pair.first).toStdString() << "' from package", continue);
-			pair.second.mLoadedContent = true;
-		}
+		packedFile.mContent = packageView.getSubView(packedFile.mPositionInFile, packedFile.mSizeInFile);
+		RMX_CHECK(packedFile.mContent.getSize() == packedFile.mSizeInFile, "Failed to load entry '" << WString(key).toStdString() << "' from package", outPackedFiles.erase(key); continue);
 	}
 	return true;
 }
 
 void FilePackage::createFilePackage(const std::wstring& packageFilename, const std::vector<std::wstring>& includedPaths, const std::vector<std::wstring>& excludedPaths, const std::wstring& comparisonPath, uint32 contentVersion, bool forceReplace)
 {
-	// Collect file contents
+	// Collect the files to include, their contents get read one at a time later on
 	std::map<std::wstring, PackedFile> packedFiles;
 	{
 		FileCrawler fc;
@@ -92,12 +81,9 @@ void FilePackage::createFilePackage(const std::wstring& packageFilename, const s
 
 			if (add)
 			{
-				std::vector<uint8> content;
-				if (FTX::FileSystem->readFile(path, content))
-				{
-					PackedFile& packedFile = packedFiles[path];
-					packedFile.mContent.swap(content);
-				}
+				PackedFile& packedFile = packedFiles[path];
+				packedFile.mPath = path;
+				packedFile.mSizeInFile = (uint32)entry.mSize;
 			}
 		}
 	}
@@ -106,19 +92,18 @@ void FilePackage::createFilePackage(const std::wstring& packageFilename, const s
 	if (!forceReplace && !comparisonPath.empty())
 	{
 		std::map<std::wstring, PackedFile> existingPackedFiles;
-		InputStream* inputStream = nullptr;
-		if (loadPackage(comparisonPath + packageFilename, existingPackedFiles, inputStream, true))
+		if (loadPackage(comparisonPath + packageFilename, existingPackedFiles))
 		{
-			delete inputStream;
-
 			// Compare
 			bool isEqual = (existingPackedFiles.size() == packedFiles.size());
 			if (isEqual)
 			{
+				std::vector<uint8> content;
 				for (const auto& pair : packedFiles)
 				{
 					PackedFile* packedFile = mapFind(existingPackedFiles, pair.first);
-					if (nullptr == packedFile || packedFile->mContent != pair.second.mContent)
+					if (nullptr == packedFile || packedFile->mContent.getSize() != pair.second.mSizeInFile || !FTX::FileSystem->readFile(pair.first, content) ||
+						content.size() != packedFile->mContent.getSize() || (!content.empty() && memcmp(packedFile->mContent.getData(), content.data(), content.size()) != 0))
 					{
 						isEqual = false;
 						break;
@@ -154,17 +139,33 @@ void FilePackage::createFilePackage(const std::wstring& packageFilename, const s
 			serializer.write(pair.first);
 			pair.second.mPositionInFile = (uint32)output.size();	// Temporarily misusing this variable to store the position where to write the content's position in file when it got determined
 			serializer.writeAs<uint32>(0);							// Will get overwritten
-			serializer.writeAs<uint32>(pair.second.mContent.size());
+			serializer.writeAs<uint32>(pair.second.mSizeInFile);
 		}
 
 		// Write entry header size
 		entryHeaderSize = output.size() - PackageHeader::HEADER_SIZE;
 		*(uint32*)&output[headerSizePosition] = (uint32)entryHeaderSize;
 
+		std::vector<uint8> content;
 		for (auto& pair : packedFiles)
 		{
+			if (!FTX::FileSystem->readFile(pair.first, content) || content.size() != pair.second.mSizeInFile)
+			{
+				RMX_ERROR("Failed to read file '" << WString(pair.first).toStdString() << "' for package '" << WString(packageFilename).toStdString() << "'", );
+				return;
+			}
+
+			if (content.size() >= PackageHeader::CONTENT_ALIGNMENT)
+			{
+				// Add padding so that the content starts at a memory page boundary, which makes memory-mapping more efficient
+				output.resize((output.size() + PackageHeader::CONTENT_ALIGNMENT - 1) / PackageHeader::CONTENT_ALIGNMENT * PackageHeader::CONTENT_ALIGNMENT, 0);
+			}
+
 			const uint32 position = (uint32)output.size();
-			serializer.write(&pair.second.mContent[0], pair.second.mContent.size());
+			if (!content.empty())
+			{
+				serializer.write(content.data(), content.size());
+			}
 			*(uint32*)&output[pair.second.mPositionInFile] = position;
 			pair.second.mPositionInFile = position;
 		}
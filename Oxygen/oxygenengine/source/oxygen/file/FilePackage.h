@@ -19,8 +19,7 @@ public:
 		std::wstring mPath;
 		uint32 mPositionInFile = 0;
 		uint32 mSizeInFile = 0;
-		bool mLoadedContent = false;
-		std::vector<uint8> mContent;
+		rmx::FileView mContent;		// View on the content in the package file, which is usually memory-mapped
 	};
 
 	struct PackageHeader
@@ -28,6 +27,7 @@ public:
 		static const constexpr char SIGNATURE[] = "OPCK";
 		static const constexpr uint32 CURRENT_FORMAT_VERSION = 2;
 		static const constexpr size_t HEADER_SIZE = 20;
+		static const constexpr size_t CONTENT_ALIGNMENT = 0x1000;	// Larger contents start at a multiple of this, i.e. at a memory page boundary
 
 		uint32 mFormatVersion = CURRENT_FORMAT_VERSION;
 		uint32 mContentVersion = 0;
@@ -36,7 +36,7 @@ public:
 	};
 
 public:
-	static bool loadPackage(const std::wstring& packageFilename, std::map<std::wstring, PackedFile>& outPackedFiles, InputStream*& inputStream, bool forceLoadAll);
+	static bool loadPackage(const std::wstring& packageFilename, std::map<std::wstring, PackedFile>& outPackedFiles);
 	static void createFilePackage(const std::wstring& packageFilename, const std::vector<std::wstring>& includedPaths, const std::vector<std::wstring>& excludedPaths, const std::wstring& comparisonPath, uint32 contentVersion, bool forceReplace = false);
 
 private:
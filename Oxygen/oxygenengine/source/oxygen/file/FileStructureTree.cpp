@@ -14,7 +14,7 @@ uint64 FileStructureTree::getLowercaseStringHash(const wchar_t* string, size_t l
 {
 	// Get hash of the lowercase version of the input string, to allow for case insensitive comparisons
 	// Note: This can produce different hashes on different platforms
-	static std::vector<wchar_t> lowercaseString;
+	static thread_local std::vector<wchar_t> lowercaseString;
 	lowercaseString.resize(std::max<size_t>(1, length));
 	for (size_t k = 0; k < length; ++k)
 	{
@@ -29,7 +29,7 @@ struct PackedFileProvDetail
 					const size_t slashPosition = packedFile.mPath.find_last_of(L"/\\");
 					fileEntry.mFilename = (slashPosition == std::wstring::npos) ? packedFile.mPath : packedFile.mPath.substr(slashPosition + 1);
 					fileEntry.mPath = (slashPosition == std::wstring::npos) ? L"" : packedFile.mPath.substr(0, slashPosition + 1);
-					fileEntry.mSize = packedFile.mContent.size();
+					fileEntry.mSize = packedFile.mContent.getSize();
 				}
 			}
 		}
@@ -37,38 +37,11 @@ struct PackedFileProvDetail
 };
 
 
-// At the moment, this class is not really necessary, as the provider never invalidates its created input streams.
-// But maybe it will get more useful when implementing actual file streaming.
-class PackedFileInputStream : public MemInputStream
-{
-public:
-	inline PackedFileInputStream(PackedFileProvider& provider, const void* data, size_t size) : MemInputStream(data, size), mProvider(provider) {}
-	inline ~PackedFileInputStream() { mProvider.unregisterPackedFileInputStream(*this); }
-
-	inline bool valid() const override				{ return mIsValid && MemInputStream::valid(); }
-	inline const char* getType() const override		{ return "packed"; }
-
-	inline void setPosition(size_t pos) override	{ if (mIsValid) MemInputStream::setPosition(pos); }
-	inline size_t getSize() const override			{ return mIsValid ? MemInputStream::getSize() : getPosition(); }
-	inline size_t getRemaining() const override		{ return mIsValid ? MemInputStream::getRemaining() : 0; }
-
-	using InputStream::read;
-	inline size_t read(void* dst, size_t len) override			{ return mIsValid ? MemInputStream::read(dst, len) : 0; }
-	inline void skip(size_t len) override						{ if (mIsValid) MemInputStream::skip(len); }
-	inline bool tryRead(const void* data, size_t len) override	{ return mIsValid ? MemInputStream::tryRead(data, len) : false; }
-	inline StreamingState getStreamingState() override			{ return mIsValid ? MemInputStream::getStreamingState() : StreamingState::COMPLETED; }
-
-public:
-	PackedFileProvider& mProvider;
-	bool mIsValid = true;
-};
-
-
-
 struct PackedFileProvider::Internal
 {
 	FileStructureTree mFileStructureTree;
 	std::vector<const FileStructureTree::Entry*> mEntriesBuffer;
+	std::mutex mMutex;		// For thread-safe use of the entries buffer
 };
 
 
@@ -77,7 +50,7 @@ PackedFileProvider::PackedFileProvider(const std::wstring& packageFilename) :
 	mInternal(*new Internal())
 {
 	// Load the package if there is one
-	mLoaded = FilePackage::loadPackage(packageFilename, mPackedFiles, mInputStream, true);	// TODO: Use streaming instead of loading all content right away
+	mLoaded = FilePackage::loadPackage(packageFilename, mPackedFiles);
 	if (mLoaded)
 	{
 		RMX_LOG_INFO("Loaded file package '" << WString(packageFilename).toStdString() << "' with " << mPackedFiles.size() << " entries");
@@ -99,12 +72,6 @@ PackedFileProvider::PackedFileProvider(const std::wstring& packageFilename) :
 PackedFileProvider::~PackedFileProvider()
 {
 	delete &mInternal;
-	delete mInputStream;
-}
-
-void PackedFileProvider::unregisterPackedFileInputStream(PackedFileInputStream& packedFileInputStream)
-{
-	mPackedFileInputStreams.erase(&packedFileInputStream);
 }
 
 bool PackedFileProvider::exists(const std::wstring& path)
@@ -116,14 +83,35 @@ bool PackedFileProvider::exists(const std::wstring& path)
 	return mInternal.mFileStructureTree.pathExists(path);
 }
 
+bool PackedFileProvider::getFileSize(const std::wstring& filename, uint64& outFileSize)
+{
+	const PackedFile* packedFile = findPackedFile(filename);
+	if (nullptr != packedFile)
+	{
+		outFileSize = packedFile->mContent.getSize();
+		return true;
+	}
+	return false;
+}
+
 bool PackedFileProvider::readFile(const std::wstring& filename, std::vector<uint8>& outData)
 {
-	PackedFile* packedFile = findPackedFile(filename);
+	const PackedFile* packedFile = findPackedFile(filename);
 	if (nullptr != packedFile)
 	{
-		loadPackedFile(*packedFile);
-		outData.resize(packedFile->mContent.size());
-		memcpy(&outData[0], &packedFile->mContent[0], packedFile->mContent.size());
+		const rmx::FileView& content = packedFile->mContent;
+		outData.assign(content.getData(), content.getData() + content.getSize());
+		return true;
+	}
+	return false;
+}
+
+bool PackedFileProvider::readFileView(const std::wstring& filename, rmx::FileView& outFileView)
+{
+	const PackedFile* packedFile = findPackedFile(filename);
+	if (nullptr != packedFile)
+	{
+		outFileView = packedFile->mContent;
 		return true;
 	}
 	return false;
@@ -134,6 +122,7 @@ bool PackedFileProvider::listFiles(const std::wstring& path, bool recursive, std
 	if (mPackedFiles.empty())
 		return false;
 
+	std::lock_guard<std::mutex> lock(mInternal.mMutex);
 	mInternal.mEntriesBuffer.clear();
 	if (!mInternal.mFileStructureTree.listFiles(mInternal.mEntriesBuffer, path))
 		return false;
@@ -147,6 +136,7 @@ bool PackedFileProvider::listFilesByMask(const std::wstring& filemask, bool recu
 	if (mPackedFiles.empty())
 		return false;
 
+	std::lock_guard<std::mutex> lock(mInternal.mMutex);
 	mInternal.mEntriesBuffer.clear();
 	if (!mInternal.mFileStructureTree.listFilesByMask(mInternal.mEntriesBuffer, filemask, recursive))
 		return false;
@@ -165,20 +155,26 @@ bool PackedFileProvider::listDirectories(const std::wstring& path, std::vector<s
 
 InputStream* PackedFileProvider::createInputStream(const std::wstring& filename)
 {
-	// Try to first read from package
-	PackedFile* packedFile = findPackedFile(filename);
+	// The input stream keeps the content alive, even if it outlives this provider
+	const PackedFile* packedFile = findPackedFile(filename);
 	if (nullptr != packedFile)
 	{
-		loadPackedFile(*packedFile);
-		PackedFileInputStream* inputStream = new PackedFileInputStream(*this, &packedFile->mContent[0], packedFile->mContent.size());
-		mPackedFileInputStreams.insert(inputStream);
-		return inputStream;
+		return new FileViewInputStream(packedFile->mContent);
 	}
-
 	return nullptr;
 }
 
-PackedFileProvider::PackedFile* PackedFileProvider::findPackedFile(const std::wstring& filename)
+bool PackedFileProvider::getIndexedFilePaths(std::vector<std::wstring>& outPaths)
+{
+	outPaths.reserve(outPaths.size() + mPackedFiles.size());
+	for (const auto& pair : mPackedFiles)
+	{
+		outPaths.push_back(pair.first);
+	}
+	return true;
+}
+
+const PackedFileProvider::PackedFile* PackedFileProvider::findPackedFile(const std::wstring& filename) const
 {
 	if (!mPackedFiles.empty())
 	{
@@ -190,25 +186,3 @@ PackedFileProvider::PackedFile* PackedFileProvider::findPackedFile(const std::ws
 	}
 	return nullptr;
 }
-
-void PackedFileProvider::loadPackedFile(PackedFile& packedFile)
-{
-	if (!packedFile.mLoadedContent)
-	{
-		RMX_ASSERT(nullptr != mInputStream, "Input stream is not opened");
-		packedFile.mContent.resize((size_t)packedFile.mSizeInFile);
-		mInputStream->setPosition(packedFile.mPositionInFile);
-		const size_t bytesRead = mInputStream->read(&packedFile.mContent[0], (size_t)packedFile.mSizeInFile);
-		RMX_CHECK(packedFile.mSizeInFile == bytesRead, "Failed to load entry '" << WString(packedFile.mPath).toStdString() << "' from package", return);
-		packedFile.mLoadedContent = true;
-	}
-}
-
-void PackedFileProvider::invalidateAllPackedFileInputStreams()
-{
-	for (PackedFileInputStream* packedFileInputStream : mPackedFileInputStreams)
-	{
-		packedFileInputStream->mIsValid = false;
-	}
-	mPackedFileInputStreams.clear();
-}
@@ -10,8 +10,6 @@
 
 #include "oxygen/file/FilePackage.h"
 
-class PackedFileInputStream;
-
 
 class PackedFileProvider : public rmx::FileProvider
 {
@@ -25,19 +23,19 @@ public:
 	~PackedFileProvider();
 
 	const bool isLoaded() const  { return mLoaded; }
-	void unregisterPackedFileInputStream(PackedFileInputStream& inputStream);
 
 	bool exists(const std::wstring& path) override;
+	bool getFileSize(const std::wstring& filename, uint64& outFileSize) override;
 	bool readFile(const std::wstring& filename, std::vector<uint8>& outData) override;
+	bool readFileView(const std::wstring& filename, rmx::FileView& outFileView) override;
 	bool listFiles(const std::wstring& path, bool recursive, std::vector<rmx::FileIO::FileEntry>& outFileEntries) override;
 	bool listFilesByMask(const std::wstring& filemask, bool recursive, std::vector<rmx::FileIO::FileEntry>& outFileEntries) override;
 	bool listDirectories(const std::wstring& path, std::vector<std::wstring>& outDirectories) override;
 	InputStream* createInputStream(const std::wstring& filename) override;
+	bool getIndexedFilePaths(std::vector<std::wstring>& outPaths) override;
 
 private:
-	PackedFile* findPackedFile(const std::wstring& filename);
-	void loadPackedFile(PackedFile& packedFile);
-	void invalidateAllPackedFileInputStreams();
+	const PackedFile* findPackedFile(const std::wstring& filename) const;
 
 private:
 	struct Internal;
@@ -45,6 +43,4 @@ private:
 
 	std::map<std::wstring, PackedFile> mPackedFiles;
 	bool mLoaded = false;
-	InputStream* mInputStream = nullptr;
-	std::set<PackedFileInputStream*> mPackedFileInputStreams;	// Managed input streams created in "createInputStream" calls
 };
@@ -102,8 +102,10 @@ struct ZipFileProvider::Internal
 {
 	unzFile mZipFile;
 	unz_global_info64 mGlobalInfo;
+	rmx::FileView mZipFileView;		// Memory-mapped zip file, used for direct access to uncompressed entries
 	FileStructureTree mFileStructureTree;
 	std::vector<const FileStructureTree::Entry*> mEntriesBuffer;
+	std::mutex mMutex;		// For thread-safe access to the zip file and the cached contents
 };
 
 
@@ -129,6 +131,9 @@ ZipFileProvider::ZipFileProvider(const std::wstring& zipFilename) :
 
 	if (mLoaded)
 	{
+		// Zip files are usually real files, so they can be memory-mapped; if that fails, all entries get read via minizip
+		rmx::FileIO::mapFile(zipFilename, mInternal.mZipFileView);
+
 		RMX_LOG_INFO("Loaded ZIP file '" << WString(zipFilename).toStdString() << "' with " << (uint32)mContainedFiles.size() << " entries");
 	}
 	else
@@ -153,19 +158,25 @@ bool ZipFileProvider::exists(const std::wstring& path)
 
 bool ZipFileProvider::readFile(const std::wstring& filename, std::vector<uint8>& outData)
 {
-	const ContainedFile* containedFile = readFile(filename);
-	if (nullptr == containedFile)
+	rmx::FileView fileView;
+	if (!readContainedFile(filename, fileView))
 		return false;
 
-	outData = containedFile->mContent;
+	outData.assign(fileView.getData(), fileView.getData() + fileView.getSize());
 	return true;
 }
 
+bool ZipFileProvider::readFileView(const std::wstring& filename, rmx::FileView& outFileView)
+{
+	return readContainedFile(filename, outFileView);
+}
+
 bool ZipFileProvider::listFiles(const std::wstring& path, bool recursive, std::vector<rmx::FileIO::FileEntry>& outFileEntries)
 {
 	if (mContainedFiles.empty())
 		return false;
 
+	std::lock_guard<std::mutex> lock(mInternal.mMutex);
 	mInternal.mEntriesBuffer.clear();
 	if (!mInternal.mFileStructureTree.listFiles(mInternal.mEntriesBuffer, path))
 		return false;
@@ -179,6 +190,7 @@ bool ZipFileProvider::listFilesByMask(const std::wstring& filemask, bool recursi
 	if (mContainedFiles.empty())
 		return false;
 
+	std::lock_guard<std::mutex> lock(mInternal.mMutex);
 	mInternal.mEntriesBuffer.clear();
 	if (!mInternal.mFileStructureTree.listFilesByMask(mInternal.mEntriesBuffer, filemask, recursive))
 		return false;
@@ -197,11 +209,22 @@ bool ZipFileProvider::listDirectories(const std::wstring& path, std::vector<std:
 
 InputStream* ZipFileProvider::createInputStream(const std::wstring& filename)
 {
-	const ContainedFile* containedFile = readFile(filename);
-	if (nullptr == containedFile)
+	rmx::FileView fileView;
+	if (!readContainedFile(filename, fileView))
 		return nullptr;
 
-	return new MemInputStream(&containedFile->mContent[0], containedFile->mContent.size());
+	return new FileViewInputStream(fileView);
+}
+
+bool ZipFileProvider::getIndexedFilePaths(std::vector<std::wstring>& outPaths)
+{
+	outPaths.reserve(outPaths.size() + mContainedFiles.size());
+	for (const auto& pair : mContainedFiles)
+	{
+		const rmx::FileIO::FileEntry& fileEntry = pair.second.mFileEntry;
+		outPaths.push_back(fileEntry.mPath + fileEntry.mFilename);
+	}
+	return true;
 }
 
 bool ZipFileProvider::scanZipFile(const std::wstring& zipFilename)
@@ -268,43 +291,65 @@ bool ZipFileProvider::scanZipFile(const std::wstring& zipFilename)
 	return true;
 }
 
-const ZipFileProvider::ContainedFile* ZipFileProvider::readFile(const std::wstring& filename)
+bool ZipFileProvider::readContainedFile(const std::wstring& filename, rmx::FileView& outFileView)
 {
 	ContainedFile* containedFile = findContainedFile(filename);
 	if (nullptr == containedFile)
-		return nullptr;
+		return false;
 
+	std::lock_guard<std::mutex> lock(mInternal.mMutex);
 	const rmx::FileIO::FileEntry& fileEntry = containedFile->mFileEntry;
-	if (!containedFile->mContent.empty() || fileEntry.mSize == 0)
+	if (!containedFile->mStoredContent.empty() || fileEntry.mSize == 0)
 	{
-		// Cached file is loaded already (or empty)
-		return containedFile;
+		// Uncompressed entry that was accessed before (or empty)
+		outFileView = containedFile->mStoredContent;
+		return true;
 	}
 
 	int result = unzLocateFile(mInternal.mZipFile, *WString(fileEntry.mPath + fileEntry.mFilename).toString(), 1);
 	if (result != UNZ_OK)
-		return nullptr;
-
-	containedFile->mContent.resize(fileEntry.mSize);
+		return false;
 
 	result = unzOpenCurrentFile(mInternal.mZipFile);
 	if (result != UNZ_OK)
-		return nullptr;
+		return false;
+
+	// Uncompressed entries can be used directly from the memory-mapped zip file
+	unz_file_info64 fileInfo;
+	if (!mInternal.mZipFileView.empty() && unzGetCurrentFileInfo64(mInternal.mZipFile, &fileInfo, nullptr, 0, nullptr, 0, nullptr, 0) == UNZ_OK)
+	{
+		const bool isEncrypted = (fileInfo.flag & 1) != 0;
+		if (fileInfo.compression_method == 0 && !isEncrypted && fileInfo.uncompressed_size == fileEntry.mSize)
+		{
+			const rmx::FileView storedContent = mInternal.mZipFileView.getSubView((size_t)unzGetCurrentFileZStreamPos64(mInternal.mZipFile), fileEntry.mSize);
+			if (storedContent.getSize() == fileEntry.mSize)
+			{
+				unzCloseCurrentFile(mInternal.mZipFile);
+				containedFile->mStoredContent = storedContent;
+				outFileView = storedContent;
+				return true;
+			}
+		}
+	}
 
-	const int readResult = unzReadCurrentFile(mInternal.mZipFile, &containedFile->mContent[0], (int)containedFile->mContent.capacity());
-	if (readResult == (int)containedFile->mContent.capacity())
+	// Decompress into a buffer owned by the returned view, without caching it
+	std::vector<uint8> buffer;
+	buffer.resize(fileEntry.mSize);
+	const int readResult = unzReadCurrentFile(mInternal.mZipFile, &buffer[0], (unsigned)buffer.size());
+	if (readResult == (int)buffer.size())
 	{
 		if (unzCloseCurrentFile(mInternal.mZipFile) == UNZ_OK)
 		{
 			// Success
-			return containedFile;
+			outFileView = rmx::FileView::fromBuffer(std::move(buffer));
+			return true;
 		}
 	}
 	else
 	{
 		unzCloseCurrentFile(mInternal.mZipFile);
 	}
-	return nullptr;
+	return false;
 }
 
 ZipFileProvider::ContainedFile* ZipFileProvider::findContainedFile(const std::wstring& filePath)
@@ -23,21 +23,23 @@ public:
 
 	bool exists(const std::wstring& path) override;
 	bool readFile(const std::wstring& filename, std::vector<uint8>& outData) override;
+	bool readFileView(const std::wstring& filename, rmx::FileView& outFileView) override;
 	bool listFiles(const std::wstring& path, bool recursive, std::vector<rmx::FileIO::FileEntry>& outFileEntries) override;
 	bool listFilesByMask(const std::wstring& filemask, bool recursive, std::vector<rmx::FileIO::FileEntry>& outFileEntries) override;
 	bool listDirectories(const std::wstring& path, std::vector<std::wstring>& outDirectories) override;
 	InputStream* createInputStream(const std::wstring& filename) override;
+	bool getIndexedFilePaths(std::vector<std::wstring>& outPaths) override;
 
 private:
 	struct ContainedFile
 	{
 		rmx::FileIO::FileEntry mFileEntry;
-		std::vector<uint8> mContent;		// Cached content
+		rmx::FileView mStoredContent;		// Only for uncompressed entries: View on the content inside the memory-mapped zip file
 	};
 
 private:
 	bool scanZipFile(const std::wstring& zipFilename);
-	const ContainedFile* readFile(const std::wstring& filename);
+	bool readContainedFile(const std::wstring& filename, rmx::FileView& outFileView);
 
 	ContainedFile* findContainedFile(const std::wstring& filePath);
 	const ContainedFile* findContainedFile(const std::wstring& filePath) const;
@@ -98,7 +98,9 @@ bool FileHelper::loadPaletteBitmap(PaletteBitmap& bitmap, const std::wstring& fi
 		return false;
 	}
 
-	if (!bitmap.loadBMP(content))
+	// Palette PNGs are supported as well, besides BMP files
+	const bool isPNG = (content.size() >= 8 && memcmp(&content[0], "\x89PNG", 4) == 0);
+	if (!(isPNG ? bitmap.loadPNG(content) : bitmap.loadBMP(content)))
 	{
 		RMX_CHECK(!showError, "Failed to load image file '" << *WString(filename).toString() << "': Format not supported", );
 		return false;
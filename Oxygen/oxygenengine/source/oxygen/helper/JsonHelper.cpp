@@ -12,22 +12,36 @@
 
 Json::Value JsonHelper::loadFile(const std::wstring& filename)
 {
+	std::string errors;
+	Json::Value result = loadFile(filename, errors);
+	showLoadErrors(filename, errors);
+	return result;
+}
+
+Json::Value JsonHelper::loadFile(const std::wstring& filename, std::string& outErrors)
+{
+	outErrors.clear();
 	std::vector<uint8> content;
 	if (FTX::FileSystem->readFile(filename, content))
 	{
 		if (!content.empty())	// Silently ignore empty JSON files
 		{
-			std::string errors;
-			Json::Value result = loadFromMemory(content, &errors);
-			if (errors.empty())
+			Json::Value result = loadFromMemory(content, &outErrors);
+			if (outErrors.empty())
 				return result;
-
-			RMX_ERROR("Error parsing JSON file '" << *WString(filename).toString() << "':\n" << errors, );
 		}
 	}
 	return Json::Value();
 }
 
+void JsonHelper::showLoadErrors(const std::wstring& filename, const std::string& errors)
+{
+	if (!errors.empty())
+	{
+		RMX_ERROR("Error parsing JSON file '" << *WString(filename).toString() << "':\n" << errors, );
+	}
+}
+
 bool JsonHelper::saveFile(const std::wstring& filename, const Json::Value& value)
 {
 	const String output(value.toStyledString());
@@ -15,6 +15,8 @@ class JsonHelper : public rmx::JsonHelper
 {
 public:
 	static Json::Value loadFile(const std::wstring& filename);
+	static Json::Value loadFile(const std::wstring& filename, std::string& outErrors);	// Does not show errors, but returns them instead
+	static void showLoadErrors(const std::wstring& filename, const std::string& errors);
 	static bool saveFile(const std::wstring& filename, const Json::Value& value);
 
 public:
@@ -15,6 +15,7 @@
 void PatternManager::refresh()
 {
 	mChangeBits.clearAllBits();
+	++mRefreshCounter;
 
 	// Update pattern cache content
 	const BitArray<0x800>& changeBits = EmulatorInterface::instance().getVRamChangeBits();
@@ -59,6 +60,22 @@ void PatternManager::refresh()
 							memcpy(v3, v1, 8);
 						}
 
+						// Build opaque masks
+						for (int k = 0; k < 4; ++k)
+						{
+							for (int y = 0; y < 8; ++y)
+							{
+								const uint8* pixels = &patterns[k].mPixels[y * 8];
+								uint8 mask = 0;
+								for (int x = 0; x < 8; ++x)
+								{
+									if (pixels[x] & 0x0f)
+										mask |= (1 << x);
+								}
+								patterns[k].mOpaqueMask[y] = mask;
+							}
+						}
+
 						memcpy(cacheItem.mOriginalDataBackup, src, 0x20);
 						mChangeBits.setBit(patternIndex);
 					}
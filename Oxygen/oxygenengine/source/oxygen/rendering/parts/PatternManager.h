@@ -21,6 +21,7 @@ public:
 		struct Pattern
 		{
 			uint8 mPixels[64] = { 0 };
+			uint8 mOpaqueMask[8] = { 0 };	// One byte per line, with one bit per non-transparent pixel (lowest bit is the leftmost pixel)
 		};
 		Pattern mFlipVariation[4];
 		uint8 mOriginalDataBackup[32];
@@ -35,10 +36,12 @@ public:
 
 	inline const CacheItem* getPatternCache() const  { return mPatternCache; }
 	const BitArray<0x800>& getChangeBits() const  { return mChangeBits; }
+	inline uint32 getRefreshCounter() const  { return mRefreshCounter; }
 
 	void dumpAsPaletteBitmap(PaletteBitmap& output) const;
 
 private:
 	CacheItem mPatternCache[0x800];
 	BitArray<0x800> mChangeBits;	// One bit for each pattern, so we know which ones were changed in the last "refresh" call
+	uint32 mRefreshCounter = 0;		// Number of "refresh" calls so far, so users of the change bits can tell if they missed one
 };
@@ -17,7 +17,7 @@
 #include "oxygen/rendering/parts/SpriteManager.h"
 
 
-class RenderParts : public SingleInstance<RenderParts>
+class RenderParts : public ThreadLocalInstance<RenderParts>
 {
 public:
 	struct Viewport
@@ -0,0 +1,457 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "oxygen/pch.h"
+#include "oxygen/rendering/software/PaletteKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define PALETTE_KERNELS_X64
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define TARGET_AVX2
+	#else
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define PALETTE_KERNELS_NEON
+	#include <arm_neon.h>
+#endif
+
+
+namespace
+{
+	// Scalar implementations, also used for the remaining pixels at the end of a line by the SIMD implementations
+
+	void writeOpaque_Scalar(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels)
+	{
+		for (int i = 0; i < numPixels; ++i)
+		{
+			dst[i] = palette[src[i]];
+		}
+	}
+
+	void writeMasked_Scalar(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels)
+	{
+		for (int i = 0; i < numPixels; ++i)
+		{
+			if (src[i] & 0x0f)
+			{
+				dst[i] = palette[src[i]];
+			}
+		}
+	}
+
+	void writeMaskedSetDepth_Scalar(uint32* RESTRICT dst, uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		for (int i = 0; i < numPixels; ++i)
+		{
+			if (src[i] & 0x0f)
+			{
+				dst[i] = palette[src[i]];
+				depth[i] = depthValue;
+			}
+		}
+	}
+
+	void writeMaskedDepthTest_Scalar(uint32* RESTRICT dst, const uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		for (int i = 0; i < numPixels; ++i)
+		{
+			if ((src[i] & 0x0f) && depthValue >= depth[i])
+			{
+				dst[i] = palette[src[i]];
+			}
+		}
+	}
+
+
+#if defined(PALETTE_KERNELS_X64)
+
+	// SSE2 implementations, processing 16 pixels at once, and then 8 pixels for the rest of the line, as lines often consist of 8 pixel wide patterns
+	//  -> There's no gather instruction in SSE2, so only the transparency and depth tests are vectorized
+
+	template<int NUM_PIXELS>
+	FORCE_INLINE void writePixelsByMask_SSE2(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int writeBits)
+	{
+		if (writeBits == (1 << NUM_PIXELS) - 1)
+		{
+			for (int k = 0; k < NUM_PIXELS; ++k)
+			{
+				dst[k] = palette[src[k]];
+			}
+		}
+		else if (writeBits != 0)
+		{
+			for (int k = 0; k < NUM_PIXELS; ++k)
+			{
+				if (writeBits & (1 << k))
+					dst[k] = palette[src[k]];
+			}
+		}
+	}
+
+	void writeMasked_SSE2(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels)
+	{
+		const __m128i lowBits = _mm_set1_epi8(0x0f);
+		const __m128i zero = _mm_setzero_si128();
+		int i = 0;
+		for (; i + 16 <= numPixels; i += 16)
+		{
+			const __m128i indices = _mm_loadu_si128((const __m128i*)&src[i]);
+			const __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(indices, lowBits), zero);
+			writePixelsByMask_SSE2<16>(&dst[i], &src[i], palette, ~_mm_movemask_epi8(transparent) & 0xffff);
+		}
+		if (i + 8 <= numPixels)
+		{
+			const __m128i indices = _mm_loadl_epi64((const __m128i*)&src[i]);
+			const __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(indices, lowBits), zero);
+			writePixelsByMask_SSE2<8>(&dst[i], &src[i], palette, ~_mm_movemask_epi8(transparent) & 0xff);
+			i += 8;
+		}
+		writeMasked_Scalar(&dst[i], &src[i], palette, numPixels - i);
+	}
+
+	void writeMaskedSetDepth_SSE2(uint32* RESTRICT dst, uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		const __m128i lowBits = _mm_set1_epi8(0x0f);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i depthValues = _mm_set1_epi8((char)depthValue);
+		int i = 0;
+		for (; i + 16 <= numPixels; i += 16)
+		{
+			const __m128i indices = _mm_loadu_si128((const __m128i*)&src[i]);
+			const __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(indices, lowBits), zero);
+			const __m128i oldDepth = _mm_loadu_si128((const __m128i*)&depth[i]);
+			_mm_storeu_si128((__m128i*)&depth[i], _mm_or_si128(_mm_and_si128(transparent, oldDepth), _mm_andnot_si128(transparent, depthValues)));
+			writePixelsByMask_SSE2<16>(&dst[i], &src[i], palette, ~_mm_movemask_epi8(transparent) & 0xffff);
+		}
+		if (i + 8 <= numPixels)
+		{
+			const __m128i indices = _mm_loadl_epi64((const __m128i*)&src[i]);
+			const __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(indices, lowBits), zero);
+			const __m128i oldDepth = _mm_loadl_epi64((const __m128i*)&depth[i]);
+			_mm_storel_epi64((__m128i*)&depth[i], _mm_or_si128(_mm_and_si128(transparent, oldDepth), _mm_andnot_si128(transparent, depthValues)));
+			writePixelsByMask_SSE2<8>(&dst[i], &src[i], palette, ~_mm_movemask_epi8(transparent) & 0xff);
+			i += 8;
+		}
+		writeMaskedSetDepth_Scalar(&dst[i], &depth[i], &src[i], palette, numPixels - i, depthValue);
+	}
+
+	void writeMaskedDepthTest_SSE2(uint32* RESTRICT dst, const uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		const __m128i lowBits = _mm_set1_epi8(0x0f);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i depthValues = _mm_set1_epi8((char)depthValue);
+		int i = 0;
+		for (; i + 16 <= numPixels; i += 16)
+		{
+			const __m128i indices = _mm_loadu_si128((const __m128i*)&src[i]);
+			const __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(indices, lowBits), zero);
+			const __m128i oldDepth = _mm_loadu_si128((const __m128i*)&depth[i]);
+			const __m128i depthPassed = _mm_cmpeq_epi8(_mm_max_epu8(oldDepth, depthValues), depthValues);	// Unsigned "depthValue >= depth"
+			writePixelsByMask_SSE2<16>(&dst[i], &src[i], palette, _mm_movemask_epi8(_mm_andnot_si128(transparent, depthPassed)));
+		}
+		if (i + 8 <= numPixels)
+		{
+			const __m128i indices = _mm_loadl_epi64((const __m128i*)&src[i]);
+			const __m128i transparent = _mm_cmpeq_epi8(_mm_and_si128(indices, lowBits), zero);
+			const __m128i oldDepth = _mm_loadl_epi64((const __m128i*)&depth[i]);
+			const __m128i depthPassed = _mm_cmpeq_epi8(_mm_max_epu8(oldDepth, depthValues), depthValues);
+			writePixelsByMask_SSE2<8>(&dst[i], &src[i], palette, _mm_movemask_epi8(_mm_andnot_si128(transparent, depthPassed)) & 0xff);
+			i += 8;
+		}
+		writeMaskedDepthTest_Scalar(&dst[i], &depth[i], &src[i], palette, numPixels - i, depthValue);
+	}
+
+
+	// AVX2 implementations, processing 8 pixels at once
+	//  -> Palette lookup uses gather, and transparent pixels get skipped with a masked store
+
+	TARGET_AVX2 FORCE_INLINE __m256i loadIndices_AVX2(const uint8* src)
+	{
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src));
+	}
+
+	TARGET_AVX2 FORCE_INLINE void writePixelsByMask_AVX2(uint32* dst, __m256i indices, const uint32* palette, __m256i skipMask)
+	{
+		const int skipBits = _mm256_movemask_ps(_mm256_castsi256_ps(skipMask));
+		if (skipBits == 0xff)
+			return;
+
+		const __m256i colors = _mm256_i32gather_epi32((const int*)palette, indices, 4);
+		if (skipBits == 0)
+		{
+			_mm256_storeu_si256((__m256i*)dst, colors);
+		}
+		else
+		{
+			_mm256_maskstore_epi32((int*)dst, _mm256_xor_si256(skipMask, _mm256_set1_epi32(-1)), colors);
+		}
+	}
+
+	TARGET_AVX2 void writeOpaque_AVX2(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels)
+	{
+		int i = 0;
+		for (; i + 8 <= numPixels; i += 8)
+		{
+			const __m256i colors = _mm256_i32gather_epi32((const int*)palette, loadIndices_AVX2(&src[i]), 4);
+			_mm256_storeu_si256((__m256i*)&dst[i], colors);
+		}
+		writeOpaque_Scalar(&dst[i], &src[i], palette, numPixels - i);
+	}
+
+	TARGET_AVX2 void writeMasked_AVX2(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels)
+	{
+		const __m256i lowBits = _mm256_set1_epi32(0x0f);
+		const __m256i zero = _mm256_setzero_si256();
+		int i = 0;
+		for (; i + 8 <= numPixels; i += 8)
+		{
+			const __m256i indices = loadIndices_AVX2(&src[i]);
+			const __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(indices, lowBits), zero);
+			writePixelsByMask_AVX2(&dst[i], indices, palette, transparent);
+		}
+		writeMasked_Scalar(&dst[i], &src[i], palette, numPixels - i);
+	}
+
+	TARGET_AVX2 void writeMaskedSetDepth_AVX2(uint32* RESTRICT dst, uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		const __m256i lowBits = _mm256_set1_epi32(0x0f);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m128i lowBits8 = _mm_set1_epi8(0x0f);
+		const __m128i depthValues8 = _mm_set1_epi8((char)depthValue);
+		int i = 0;
+		for (; i + 8 <= numPixels; i += 8)
+		{
+			// Depth update works on 8 bytes
+			const __m128i indices8 = _mm_loadl_epi64((const __m128i*)&src[i]);
+			const __m128i transparent8 = _mm_cmpeq_epi8(_mm_and_si128(indices8, lowBits8), _mm_setzero_si128());
+			const __m128i oldDepth = _mm_loadl_epi64((const __m128i*)&depth[i]);
+			_mm_storel_epi64((__m128i*)&depth[i], _mm_or_si128(_mm_and_si128(transparent8, oldDepth), _mm_andnot_si128(transparent8, depthValues8)));
+
+			const __m256i indices = _mm256_cvtepu8_epi32(indices8);
+			const __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(indices, lowBits), zero);
+			writePixelsByMask_AVX2(&dst[i], indices, palette, transparent);
+		}
+		writeMaskedSetDepth_Scalar(&dst[i], &depth[i], &src[i], palette, numPixels - i, depthValue);
+	}
+
+	TARGET_AVX2 void writeMaskedDepthTest_AVX2(uint32* RESTRICT dst, const uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		const __m256i lowBits = _mm256_set1_epi32(0x0f);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i depthValues = _mm256_set1_epi32(depthValue);
+		int i = 0;
+		for (; i + 8 <= numPixels; i += 8)
+		{
+			const __m256i indices = loadIndices_AVX2(&src[i]);
+			const __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(indices, lowBits), zero);
+			const __m256i depthFailed = _mm256_cmpgt_epi32(loadIndices_AVX2(&depth[i]), depthValues);
+			writePixelsByMask_AVX2(&dst[i], indices, palette, _mm256_or_si256(transparent, depthFailed));
+		}
+		writeMaskedDepthTest_Scalar(&dst[i], &depth[i], &src[i], palette, numPixels - i, depthValue);
+	}
+
+	bool isAVX2Supported()
+	{
+	#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// Check for AVX support by CPU and OS first
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+			return false;
+		if ((_xgetbv(0) & 0x06) != 0x06)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+	#endif
+	}
+
+#endif
+
+
+#if defined(PALETTE_KERNELS_NEON)
+
+	// NEON implementations, processing 16 pixels at once, and then 8 pixels for the rest of the line
+	//  -> Like with SSE2, only the transparency and depth tests are vectorized
+
+	FORCE_INLINE void writePixelsByMask_NEON(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, uint8x16_t writeMask)
+	{
+		if (vmaxvq_u8(writeMask) == 0)
+			return;
+
+		if (vminvq_u8(writeMask) == 0xff)
+		{
+			for (int k = 0; k < 16; ++k)
+			{
+				dst[k] = palette[src[k]];
+			}
+		}
+		else
+		{
+			uint8 writeFlags[16];
+			vst1q_u8(writeFlags, writeMask);
+			for (int k = 0; k < 16; ++k)
+			{
+				if (writeFlags[k])
+					dst[k] = palette[src[k]];
+			}
+		}
+	}
+
+	FORCE_INLINE void writePixelsByMask_NEON(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, uint8x8_t writeMask)
+	{
+		if (vmaxv_u8(writeMask) == 0)
+			return;
+
+		if (vminv_u8(writeMask) == 0xff)
+		{
+			for (int k = 0; k < 8; ++k)
+			{
+				dst[k] = palette[src[k]];
+			}
+		}
+		else
+		{
+			uint8 writeFlags[8];
+			vst1_u8(writeFlags, writeMask);
+			for (int k = 0; k < 8; ++k)
+			{
+				if (writeFlags[k])
+					dst[k] = palette[src[k]];
+			}
+		}
+	}
+
+	void writeMasked_NEON(uint32* RESTRICT dst, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels)
+	{
+		const uint8x16_t lowBits = vdupq_n_u8(0x0f);
+		int i = 0;
+		for (; i + 16 <= numPixels; i += 16)
+		{
+			const uint8x16_t opaque = vtstq_u8(vld1q_u8(&src[i]), lowBits);
+			writePixelsByMask_NEON(&dst[i], &src[i], palette, opaque);
+		}
+		if (i + 8 <= numPixels)
+		{
+			const uint8x8_t opaque = vtst_u8(vld1_u8(&src[i]), vget_low_u8(lowBits));
+			writePixelsByMask_NEON(&dst[i], &src[i], palette, opaque);
+			i += 8;
+		}
+		writeMasked_Scalar(&dst[i], &src[i], palette, numPixels - i);
+	}
+
+	void writeMaskedSetDepth_NEON(uint32* RESTRICT dst, uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		const uint8x16_t lowBits = vdupq_n_u8(0x0f);
+		const uint8x16_t depthValues = vdupq_n_u8(depthValue);
+		int i = 0;
+		for (; i + 16 <= numPixels; i += 16)
+		{
+			const uint8x16_t opaque = vtstq_u8(vld1q_u8(&src[i]), lowBits);
+			vst1q_u8(&depth[i], vbslq_u8(opaque, depthValues, vld1q_u8(&depth[i])));
+			writePixelsByMask_NEON(&dst[i], &src[i], palette, opaque);
+		}
+		if (i + 8 <= numPixels)
+		{
+			const uint8x8_t opaque = vtst_u8(vld1_u8(&src[i]), vget_low_u8(lowBits));
+			vst1_u8(&depth[i], vbsl_u8(opaque, vget_low_u8(depthValues), vld1_u8(&depth[i])));
+			writePixelsByMask_NEON(&dst[i], &src[i], palette, opaque);
+			i += 8;
+		}
+		writeMaskedSetDepth_Scalar(&dst[i], &depth[i], &src[i], palette, numPixels - i, depthValue);
+	}
+
+	void writeMaskedDepthTest_NEON(uint32* RESTRICT dst, const uint8* RESTRICT depth, const uint8* RESTRICT src, const uint32* RESTRICT palette, int numPixels, uint8 depthValue)
+	{
+		const uint8x16_t lowBits = vdupq_n_u8(0x0f);
+		const uint8x16_t depthValues = vdupq_n_u8(depthValue);
+		int i = 0;
+		for (; i + 16 <= numPixels; i += 16)
+		{
+			const uint8x16_t opaque = vtstq_u8(vld1q_u8(&src[i]), lowBits);
+			const uint8x16_t depthPassed = vcgeq_u8(depthValues, vld1q_u8(&depth[i]));
+			writePixelsByMask_NEON(&dst[i], &src[i], palette, vandq_u8(opaque, depthPassed));
+		}
+		if (i + 8 <= numPixels)
+		{
+			const uint8x8_t opaque = vtst_u8(vld1_u8(&src[i]), vget_low_u8(lowBits));
+			const uint8x8_t depthPassed = vcge_u8(vget_low_u8(depthValues), vld1_u8(&depth[i]));
+			writePixelsByMask_NEON(&dst[i], &src[i], palette, vand_u8(opaque, depthPassed));
+			i += 8;
+		}
+		writeMaskedDepthTest_Scalar(&dst[i], &depth[i], &src[i], palette, numPixels - i, depthValue);
+	}
+
+#endif
+}
+
+
+PaletteKernels::InstructionSet PaletteKernels::mInstructionSet = PaletteKernels::InstructionSet::SCALAR;
+PaletteKernels::Functions PaletteKernels::mFunctions = { &writeOpaque_Scalar, &writeMasked_Scalar, &writeMaskedSetDepth_Scalar, &writeMaskedDepthTest_Scalar };
+
+
+void PaletteKernels::initialize()
+{
+	setInstructionSet(getBestInstructionSet());
+}
+
+PaletteKernels::InstructionSet PaletteKernels::getBestInstructionSet()
+{
+#if defined(PALETTE_KERNELS_X64)
+	static const bool avx2Supported = isAVX2Supported();
+	return avx2Supported ? InstructionSet::AVX2 : InstructionSet::SSE2;
+#elif defined(PALETTE_KERNELS_NEON)
+	return InstructionSet::NEON;
+#else
+	return InstructionSet::SCALAR;
+#endif
+}
+
+void PaletteKernels::setInstructionSet(InstructionSet instructionSet)
+{
+	// Fall back to scalar implementations for instruction sets not available in this build
+	switch (instructionSet)
+	{
+	#if defined(PALETTE_KERNELS_X64)
+		case InstructionSet::SSE2:
+			mFunctions = { &writeOpaque_Scalar, &writeMasked_SSE2, &writeMaskedSetDepth_SSE2, &writeMaskedDepthTest_SSE2 };
+			break;
+
+		case InstructionSet::AVX2:
+			if (getBestInstructionSet() != InstructionSet::AVX2)
+			{
+				setInstructionSet(InstructionSet::SSE2);
+				return;
+			}
+			mFunctions = { &writeOpaque_AVX2, &writeMasked_AVX2, &writeMaskedSetDepth_AVX2, &writeMaskedDepthTest_AVX2 };
+			break;
+	#endif
+
+	#if defined(PALETTE_KERNELS_NEON)
+		case InstructionSet::NEON:
+			mFunctions = { &writeOpaque_Scalar, &writeMasked_NEON, &writeMaskedSetDepth_NEON, &writeMaskedDepthTest_NEON };
+			break;
+	#endif
+
+		default:
+			instructionSet = InstructionSet::SCALAR;
+			mFunctions = { &writeOpaque_Scalar, &writeMasked_Scalar, &writeMaskedSetDepth_Scalar, &writeMaskedDepthTest_Scalar };
+			break;
+	}
+	mInstructionSet = instructionSet;
+}
@@ -0,0 +1,60 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include <rmxbase.h>
+
+
+// Kernels for converting a line of palette indices into colors, as used by the software renderer
+//  -> Source pixels are pattern pixels, i.e. only the lower 4 bits are used, and a value of 0 is transparent
+//  -> Depth buffer pointers refer to the same line as the destination pointer
+//  -> SIMD implementations get selected in "initialize", depending on what the CPU supports; until then, the scalar fallback is used
+class PaletteKernels
+{
+public:
+	enum class InstructionSet
+	{
+		SCALAR,
+		SSE2,
+		AVX2,
+		NEON
+	};
+
+public:
+	static void initialize();
+
+	static InstructionSet getBestInstructionSet();
+	inline static InstructionSet getInstructionSet()  { return mInstructionSet; }
+	static void setInstructionSet(InstructionSet instructionSet);
+
+	// Write all pixels, ignoring transparency
+	inline static void writeOpaque(uint32* dst, const uint8* src, const uint32* palette, int numPixels)  { mFunctions.mWriteOpaque(dst, src, palette, numPixels); }
+
+	// Write all non-transparent pixels
+	inline static void writeMasked(uint32* dst, const uint8* src, const uint32* palette, int numPixels)  { mFunctions.mWriteMasked(dst, src, palette, numPixels); }
+
+	// Write all non-transparent pixels, and set their depth to the given depth value
+	inline static void writeMaskedSetDepth(uint32* dst, uint8* depth, const uint8* src, const uint32* palette, int numPixels, uint8 depthValue)  { mFunctions.mWriteMaskedSetDepth(dst, depth, src, palette, numPixels, depthValue); }
+
+	// Write all non-transparent pixels that pass the depth test, i.e. where the given depth value is not lower than the depth buffer's
+	inline static void writeMaskedDepthTest(uint32* dst, const uint8* depth, const uint8* src, const uint32* palette, int numPixels, uint8 depthValue)  { mFunctions.mWriteMaskedDepthTest(dst, depth, src, palette, numPixels, depthValue); }
+
+private:
+	struct Functions
+	{
+		void(*mWriteOpaque)(uint32*, const uint8*, const uint32*, int);
+		void(*mWriteMasked)(uint32*, const uint8*, const uint32*, int);
+		void(*mWriteMaskedSetDepth)(uint32*, uint8*, const uint8*, const uint32*, int, uint8);
+		void(*mWriteMaskedDepthTest)(uint32*, const uint8*, const uint8*, const uint32*, int, uint8);
+	};
+
+private:
+	static InstructionSet mInstructionSet;
+	static Functions mFunctions;
+};
@@ -8,6 +8,7 @@
 
 #include "oxygen/pch.h"
 #include "oxygen/rendering/software/SoftwareRenderer.h"
+#include "oxygen/rendering/software/PaletteKernels.h"
 #include "oxygen/rendering/Geometry.h"
 #include "oxygen/rendering/parts/RenderParts.h"
 #include "oxygen/application/Configuration.h"
@@ -25,6 +26,7 @@ namespace detail
 		PixelBlockWriter(SoftwareRenderer::BufferedPlaneData& data, const PatternManager::CacheItem* patternCache) :
 			mBufferedPlaneData(&data),
 			mContent(&data.mContent[0]),
+			mUsedVRAMChunks(&data.mUsedVRAMChunks),
 			mPatternCache(patternCache)
 		{}
 
@@ -39,6 +41,7 @@ namespace detail
 		FORCE_INLINE void addPixels(int x, uint16 patternIndex, int pixels)
 		{
 			const PatternManager::CacheItem::Pattern& pattern = mPatternCache[patternIndex & 0x07ff].mFlipVariation[(patternIndex >> 11) & 3];
+			mUsedVRAMChunks->setBit(patternIndex & 0x07ff);
 			uint8* dst = &mContent[mPosition + x];
 			const uint8* srcPatternPixels = &pattern.mPixels[mPatternPixelOffset];
 			memcpy(dst, srcPatternPixels, pixels);
@@ -65,6 +68,7 @@ namespace detail
 		{
 			// Same as above, but with hardcoded "pixels == 8"
 			const PatternManager::CacheItem::Pattern& pattern = mPatternCache[patternIndex & 0x07ff].mFlipVariation[(patternIndex >> 11) & 3];
+			mUsedVRAMChunks->setBit(patternIndex & 0x07ff);
 			uint64* dst = (uint64*)&mContent[mPosition + x];
 			const uint64* srcPatternPixels = (uint64*)&pattern.mPixels[mPatternPixelOffset];
 			*dst = *srcPatternPixels;
@@ -93,6 +97,7 @@ namespace detail
 	private:
 		SoftwareRenderer::BufferedPlaneData* mBufferedPlaneData = nullptr;
 		uint8* mContent = nullptr;
+		BitArray<0x800>* mUsedVRAMChunks = nullptr;
 		const PatternManager::CacheItem* mPatternCache = nullptr;
 
 		int mLineNumber = 0;
@@ -103,6 +108,48 @@ namespace detail
 		SoftwareRenderer::BufferedPlaneData::PixelBlock* mCurrentPixelBlock = nullptr;
 		uint16 mLastPatternBits = 0xffff;
 	};
+
+
+	// Tint and added color of a sprite, converted to fixed-point once for applying them to lots of pixels
+	class FixedPointTint
+	{
+	public:
+		FixedPointTint(const Color& tintColor, const Color& addedColor)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				mTint[k] = roundToInt(tintColor.data[k] * 0x100);
+				mAdded[k] = roundToInt(addedColor.data[k] * 0xff00);
+			}
+		}
+
+		FORCE_INLINE uint32 apply(uint32 src, uint32 dst) const
+		{
+			const uint8* srcPtr = (uint8*)&src;
+			const uint8* dstPtr = (uint8*)&dst;
+			int channels[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				channels[k] = clamp((srcPtr[k] * mTint[k] + mAdded[k]) >> 8, 0, 0xff);
+			}
+
+			// Alpha blending, treating the destination as opaque
+			const int alpha = channels[3];
+			if (alpha < 0xff)
+			{
+				const int oneMinusAlpha = 0x100 - alpha;
+				for (int k = 0; k < 3; ++k)
+				{
+					channels[k] = (channels[k] * alpha + dstPtr[k] * oneMinusAlpha) >> 8;
+				}
+			}
+			return channels[0] + (channels[1] << 8) + (channels[2] << 16) + 0xff000000;
+		}
+
+	private:
+		int mTint[4];		// Factors where 0x100 represents 1.0
+		int mAdded[4];		// Added values where 0x100 represents one step in 8-bit color
+	};
 }
 
 
@@ -111,10 +158,25 @@ SoftwareRenderer::SoftwareRenderer(RenderParts& renderParts, DrawerTexture& outp
 {
 }
 
+SoftwareRenderer::~SoftwareRenderer()
+{
+	delete mWorkerPool;
+}
+
 void SoftwareRenderer::initialize()
 {
 	mGameResolution = Configuration::instance().mGameScreen;
 	mGameScreenTexture.accessBitmap().create(mGameResolution.x, mGameResolution.y);
+
+	PaletteKernels::initialize();
+
+	int numThreads = Configuration::instance().mSoftwareRenderingThreads;
+	if (numThreads <= 0)
+		numThreads = (int)WorkerPool::getDefaultNumWorkerThreads() + 1;
+	if (numThreads > 1 && nullptr == mWorkerPool)
+	{
+		mWorkerPool = new WorkerPool(numThreads - 1);
+	}
 }
 
 void SoftwareRenderer::reset()
@@ -141,34 +203,90 @@ void SoftwareRenderer::renderGameScreen(const std::vector<Geometry*>& geometries
 {
 	Bitmap& gameScreenBitmap = mGameScreenTexture.accessBitmap();
 
-	// Clear depth buffer
-	memset(mDepthBuffer, 0, sizeof(mDepthBuffer));
-	mEmptyDepthBuffer = true;
+	// Do some analysis on what's to render
+	bool usingSpriteMask = false;
+	bool usingVerticalBlur = false;
+	{
+		for (const Geometry* geometry : geometries)
+		{
+			if (geometry->getType() == Geometry::Type::SPRITE)
+			{
+				const SpriteManager::SpriteInfo& spriteInfo = geometry->as<SpriteGeometry>().mSpriteInfo;
+				if (spriteInfo.getType() == SpriteManager::SpriteInfo::Type::MASK)
+				{
+					usingSpriteMask = true;
+				}
+				else if (spriteInfo.getType() == SpriteManager::SpriteInfo::Type::PALETTE)
+				{
+					// Upscaled sprites get created on first use, which must not happen in multiple bands at the same time
+					const SpriteManager::PaletteSpriteInfo& paletteSpriteInfo = static_cast<const SpriteManager::PaletteSpriteInfo&>(spriteInfo);
+					if (paletteSpriteInfo.mUseUpscaledSprite)
+						static_cast<const PaletteSprite*>(paletteSpriteInfo.mCacheItem->mSprite)->getUpscaledBitmap();
+				}
+			}
+			else if (geometry->getType() == Geometry::Type::EFFECT_BLUR && geometry->as<EffectBlurGeometry>().mBlurValue >= 3)
+			{
+				usingVerticalBlur = true;
+			}
+		}
+	}
 
-	if (mRenderParts.getEnforceClearScreen())
+	// Buffered plane data from earlier frames gets checked against this when reused
+	mPatternRefreshCounter = mRenderParts.getPatternManager().getRefreshCounter();
+
+	if (usingSpriteMask && gameScreenBitmap.getSize() != mGameScreenCopy.getSize())
 	{
-		gameScreenBitmap.clear(0);
+		mGameScreenCopy.create(gameScreenBitmap.getWidth(), gameScreenBitmap.getHeight());
 	}
 
-	mCurrentViewport.set(0, 0, mGameResolution.x, mGameResolution.y);
-	mFullViewport = true;
+	// Split the screen into horizontal bands, each one rendering the whole list of geometries clipped to its lines
+	//  -> As geometries are still rendered in the same order, the result is identical to rendering the screen as a whole
+	//  -> Vertical blur reads the lines below, so it requires a single band
+	int numBands = 1;
+	if (nullptr != mWorkerPool && !usingVerticalBlur)
+	{
+		numBands = clamp(gameScreenBitmap.getHeight() / MIN_RENDER_BAND_HEIGHT, 1, (int)mWorkerPool->getNumThreads());
+	}
+	mRenderBands.resize(numBands);
+	for (int index = 0; index < numBands; ++index)
+	{
+		mRenderBands[index].mMinY = gameScreenBitmap.getHeight() * index / numBands;
+		mRenderBands[index].mMaxY = gameScreenBitmap.getHeight() * (index + 1) / numBands;
+	}
 
-	for (int i = 0; i < MAX_BUFFER_PLANE_DATA; ++i)
+	if (numBands > 1)
+	{
+		mWorkerPool->execute(numBands, [&](size_t index) { renderBand(mRenderBands[index], geometries, usingSpriteMask); });
+	}
+	else
 	{
-		mBufferedPlaneData[i].mValid = false;
+		renderBand(mRenderBands[0], geometries, usingSpriteMask);
 	}
 
-	// Do some analysis on what's to render
-	bool usingSpriteMask = false;
+	mGameScreenTexture.bitmapUpdated();
+}
+
+void SoftwareRenderer::renderBand(RenderBand& band, const std::vector<Geometry*>& geometries, bool usingSpriteMask)
+{
+	Bitmap& gameScreenBitmap = mGameScreenTexture.accessBitmap();
+	const int width = gameScreenBitmap.getWidth();
+	const int numLines = band.mMaxY - band.mMinY;
+
+	// Clear depth buffer
+	memset(&mDepthBuffer[band.mMinY * 0x200], 0, numLines * 0x200);
+	band.mEmptyDepthBuffer = true;
+
+	if (mRenderParts.getEnforceClearScreen())
 	{
-		for (const Geometry* geometry : geometries)
-		{
-			if (geometry->getType() == Geometry::Type::SPRITE && geometry->as<SpriteGeometry>().mSpriteInfo.getType() == SpriteManager::SpriteInfo::Type::MASK)
-			{
-				usingSpriteMask = true;
-				break;
-			}
-		}
+		memset(gameScreenBitmap.getPixelPointer(0, band.mMinY), 0, width * numLines * 4);
+	}
+
+	band.mCurrentViewport.set(0, band.mMinY, mGameResolution.x, numLines);
+	band.mFullViewport = (band.mMinY == 0 && numLines == mGameResolution.y);
+
+	for (int i = 0; i < MAX_BUFFER_PLANE_DATA; ++i)
+	{
+		band.mBufferedPlaneData[i].mUsedThisFrame = false;
 	}
 
 	// Render geometries
@@ -180,25 +298,23 @@ void SoftwareRenderer::renderGameScreen(const std::vector<Geometry*>& geometries
 			if (usingSpriteMask && lastRenderQueue < 0x8000 && renderQueue >= 0x8000)
 			{
 				// Copy planes (needed for sprite masking)
-				mGameScreenCopy = gameScreenBitmap;
+				memcpy(mGameScreenCopy.getPixelPointer(0, band.mMinY), gameScreenBitmap.getPixelPointer(0, band.mMinY), width * numLines * 4);
 			}
 
-			renderGeometry(*geometries[i]);
+			renderGeometry(band, *geometries[i]);
 			lastRenderQueue = renderQueue;
 		}
 	}
 
 	// Set alpha channel to 0xff to make sure nothing gets lost due to alpha test
 	{
-		uint64* RESTRICT ptr = (uint64*)gameScreenBitmap.getData();
-		uint64* RESTRICT end = ptr + gameScreenBitmap.getPixelCount() / 2;
+		uint32* RESTRICT ptr = gameScreenBitmap.getPixelPointer(0, band.mMinY);
+		uint32* RESTRICT end = ptr + width * numLines;
 		for (; ptr < end; ++ptr)
 		{
-			*ptr |= 0xff000000ff000000ull;
+			*ptr |= 0xff000000;
 		}
 	}
-
-	mGameScreenTexture.bitmapUpdated();
 }
 
 void SoftwareRenderer::renderDebugDraw(int debugDrawMode, const Recti& rect)
@@ -221,9 +337,6 @@ void SoftwareRenderer::renderDebugDraw(int debugDrawMode, const Recti& rect)
 	mGameScreenTexture.setupAsRenderTarget(bitmapSize.x, bitmapSize.y);
 	gameScreenBitmap.create(bitmapSize.x, bitmapSize.y, 0);
 
-	mCurrentViewport.set(0, 0, bitmapSize.x, bitmapSize.y);
-	mFullViewport = true;
-
 	// Render to bitmap
 	{
 		const PlaneManager& planeManager = mRenderParts.getPlaneManager();
@@ -276,7 +389,7 @@ void SoftwareRenderer::renderDebugDraw(int debugDrawMode, const Recti& rect)
 	gameScreenBitmap.create(oldSize.x, oldSize.y);
 }
 
-void SoftwareRenderer::renderGeometry(const Geometry& geometry)
+void SoftwareRenderer::renderGeometry(RenderBand& band, const Geometry& geometry)
 {
 	switch (geometry.getType())
 	{
@@ -285,13 +398,13 @@ void SoftwareRenderer::renderGeometry(const Geometry& geometry)
 
 		case Geometry::Type::PLANE:
 		{
-			renderPlane(static_cast<const PlaneGeometry&>(geometry));
+			renderPlane(band, static_cast<const PlaneGeometry&>(geometry));
 			break;
 		}
 
 		case Geometry::Type::SPRITE:
 		{
-			renderSprite(static_cast<const SpriteGeometry&>(geometry));
+			renderSprite(band, static_cast<const SpriteGeometry&>(geometry));
 			break;
 		}
 
@@ -303,7 +416,10 @@ void SoftwareRenderer::renderGeometry(const Geometry& geometry)
 			Blitter::Options options;
 			options.mUseAlphaBlending = true;
 
-			Blitter::blitColor(gameScreenWrapper, rg.mRect, rg.mColor, options);
+			Recti rect = rg.mRect;
+			rect.intersect(Recti(0, band.mMinY, mGameResolution.x, band.mMaxY - band.mMinY));
+			if (!rect.empty())
+				Blitter::blitColor(gameScreenWrapper, rect, rg.mColor, options);
 			break;
 		}
 
@@ -318,7 +434,11 @@ void SoftwareRenderer::renderGeometry(const Geometry& geometry)
 			options.mUseAlphaBlending = true;
 			options.mTintColor = tg.mColor;
 
-			Blitter::blitBitmap(gameScreenWrapper, tg.mRect.getPos(), inputWrapper, Recti(0, 0, tg.mRect.width, tg.mRect.height), options);
+			// Only the lines inside the band
+			const int minY = std::max(band.mMinY - tg.mRect.y, 0);
+			const int maxY = std::min(band.mMaxY - tg.mRect.y, tg.mRect.height);
+			if (minY < maxY)
+				Blitter::blitBitmap(gameScreenWrapper, Vec2i(tg.mRect.x, tg.mRect.y + minY), inputWrapper, Recti(0, minY, tg.mRect.width, maxY - minY), options);
 			break;
 		}
 
@@ -330,7 +450,7 @@ void SoftwareRenderer::renderGeometry(const Geometry& geometry)
 			// Blur x-direction
 			if (ebg.mBlurValue >= 1)
 			{
-				for (int y = 0; y < gameScreenBitmap.getHeight(); ++y)
+				for (int y = band.mMinY; y < band.mMaxY; ++y)
 				{
 					uint32* data = gameScreenBitmap.getPixelPointer(0, y);
 					for (int x = gameScreenBitmap.getWidth() - 1; x >= 1; --x)
@@ -341,6 +461,7 @@ void SoftwareRenderer::renderGeometry(const Geometry& geometry)
 			}
 
 			// Blur y-direction
+			//  -> This is only used with a single band covering the whole screen
 			if (ebg.mBlurValue >= 3)
 			{
 				const int stride = gameScreenBitmap.getWidth();
@@ -360,19 +481,19 @@ void SoftwareRenderer::renderGeometry(const Geometry& geometry)
 		{
 			const ViewportGeometry& vg = static_cast<const ViewportGeometry&>(geometry);
 			const Recti fullViewport(0, 0, mGameResolution.x, mGameResolution.y);
-			mCurrentViewport = fullViewport;
-			mCurrentViewport.intersect(vg.mRect);
-			mFullViewport = (mCurrentViewport == fullViewport);
+			band.mCurrentViewport.set(0, band.mMinY, mGameResolution.x, band.mMaxY - band.mMinY);
+			band.mCurrentViewport.intersect(vg.mRect);
+			band.mFullViewport = (band.mCurrentViewport == fullViewport);
 			break;
 		}
 	}
 }
 
-void SoftwareRenderer::renderPlane(const PlaneGeometry& geometry)
+void SoftwareRenderer::renderPlane(RenderBand& band, const PlaneGeometry& geometry)
 {
 	Bitmap& gameScreenBitmap = mGameScreenTexture.accessBitmap();
 
-	Recti rect(0, 0, mGameResolution.x, mGameResolution.y);
+	Recti rect(0, band.mMinY, mGameResolution.x, band.mMaxY - band.mMinY);
 	rect.intersect(geometry.mActiveRect);
 	const int minX = rect.x;
 	const int maxX = rect.x + rect.width;
@@ -383,11 +504,56 @@ void SoftwareRenderer::renderPlane(const PlaneGeometry& geometry)
 	const ScrollOffsetsManager& scrollOffsetsManager = mRenderParts.getScrollOffsetsManager();
 	const PaletteManager& paletteManager = mRenderParts.getPaletteManager();
 
+	const uint16* scrollOffsetsH = nullptr;
+	const uint16* scrollOffsetsV = nullptr;
+	uint16 scrollMaskH = 0xff;
+	uint16 scrollMaskV = 0;
+	bool scrollNoRepeat = false;
+	uint16 wScrollOffsetX = 0;
+
+	if (geometry.mPlaneIndex == PlaneManager::PLANE_W)
+	{
+		wScrollOffsetX = (uint16)scrollOffsetsManager.getPlaneWScrollOffset().x;
+		scrollOffsetsH = &wScrollOffsetX;
+		scrollMaskH = 0;
+	}
+	else
+	{
+		scrollOffsetsH = scrollOffsetsManager.getScrollOffsetsH(geometry.mScrollOffsets);
+		scrollOffsetsV = scrollOffsetsManager.getScrollOffsetsV(geometry.mScrollOffsets);
+		scrollMaskV = scrollOffsetsManager.getVerticalScrolling() ? 0x1f : 0;
+		scrollNoRepeat = scrollOffsetsManager.getHorizontalScrollNoRepeat(geometry.mScrollOffsets);
+	}
+
+	// Collect everything the plane content depends on, except for VRAM contents
+	static thread_local std::vector<int> planeState;
+	planeState.clear();
+	planeState.push_back(gameScreenBitmap.getWidth());
+	planeState.push_back(rect.x);
+	planeState.push_back(rect.y);
+	planeState.push_back(rect.width);
+	planeState.push_back(rect.height);
+	planeState.push_back(planeManager.getPlaneBaseVRAMAddress(geometry.mPlaneIndex));
+	planeState.push_back(planeManager.getPlayfieldSizeInPatterns().x);
+	planeState.push_back(planeManager.getPlayfieldSizeInPatterns().y);
+	planeState.push_back(paletteManager.mSplitPositionY);
+	planeState.push_back(scrollMaskV);
+	planeState.push_back(scrollNoRepeat);
+	planeState.push_back(scrollOffsetsManager.getVerticalScrollOffsetBias());
+	for (int y = minY; y < maxY; ++y)
+	{
+		planeState.push_back(scrollOffsetsH[y & scrollMaskH]);
+	}
+	if (nullptr != scrollOffsetsV)
+	{
+		planeState.insert(planeState.end(), scrollOffsetsV, scrollOffsetsV + scrollMaskV + 1);
+	}
+
 	// Search for already setup buffered plane data fitting this geometry
 	int foundFittingBufferedPlaneDataIndex = -1;
 	for (int i = 0; i < MAX_BUFFER_PLANE_DATA; ++i)
 	{
-		const BufferedPlaneData& bufferedPlaneData = mBufferedPlaneData[i];
+		const BufferedPlaneData& bufferedPlaneData = band.mBufferedPlaneData[i];
 		if (bufferedPlaneData.mValid &&
 			bufferedPlaneData.mPlaneIndex == geometry.mPlaneIndex &&
 			bufferedPlaneData.mScrollOffsets == geometry.mScrollOffsets &&
@@ -398,20 +564,53 @@ void SoftwareRenderer::renderPlane(const PlaneGeometry& geometry)
 		}
 	}
 
-	if (foundFittingBufferedPlaneDataIndex == -1)
+	if (foundFittingBufferedPlaneDataIndex != -1)
 	{
-		// Find a free index
+		// Data from a previous frame can only be reused if nothing changed that it depends on
+		BufferedPlaneData& bufferedPlaneData = band.mBufferedPlaneData[foundFittingBufferedPlaneDataIndex];
+		if (!bufferedPlaneData.mUsedThisFrame)
+		{
+			// Pattern changes are only known for the last refresh, so data that was not up-to-date before that can't be reused at all
+			bool upToDate = (bufferedPlaneData.mPlaneState == planeState);
+			if (upToDate && bufferedPlaneData.mPatternRefreshCounter != mPatternRefreshCounter)
+			{
+				upToDate = (bufferedPlaneData.mPatternRefreshCounter + 1 == mPatternRefreshCounter) && !bufferedPlaneData.mUsedVRAMChunks.anyBitSetInBoth(mRenderParts.getPatternManager().getChangeBits());
+			}
+			if (!upToDate)
+			{
+				bufferedPlaneData.mValid = false;
+			}
+		}
+	}
+	else
+	{
+		// Find a free index, or one not used in this frame so far
 		for (int i = 0; i < MAX_BUFFER_PLANE_DATA; ++i)
 		{
-			if (!mBufferedPlaneData[i].mValid)
+			if (!band.mBufferedPlaneData[i].mValid)
 			{
 				foundFittingBufferedPlaneDataIndex = i;
 				break;
 			}
 		}
+		if (foundFittingBufferedPlaneDataIndex == -1)
+		{
+			for (int i = 0; i < MAX_BUFFER_PLANE_DATA; ++i)
+			{
+				if (!band.mBufferedPlaneData[i].mUsedThisFrame)
+				{
+					band.mBufferedPlaneData[i].mValid = false;
+					foundFittingBufferedPlaneDataIndex = i;
+					break;
+				}
+			}
+		}
 		RMX_CHECK(foundFittingBufferedPlaneDataIndex != -1, "No free buffered plane data structure found", return);
+	}
 
-		BufferedPlaneData& bufferedPlaneData = mBufferedPlaneData[foundFittingBufferedPlaneDataIndex];
+	if (!band.mBufferedPlaneData[foundFittingBufferedPlaneDataIndex].mValid)
+	{
+		BufferedPlaneData& bufferedPlaneData = band.mBufferedPlaneData[foundFittingBufferedPlaneDataIndex];
 		bufferedPlaneData.mPlaneIndex = geometry.mPlaneIndex;
 		bufferedPlaneData.mScrollOffsets = geometry.mScrollOffsets;
 		bufferedPlaneData.mActiveRect = geometry.mActiveRect;
@@ -420,29 +619,20 @@ void SoftwareRenderer::renderPlane(const PlaneGeometry& geometry)
 		bufferedPlaneData.mPrioBlocks.reserve(0x800);
 		bufferedPlaneData.mNonPrioBlocks.clear();
 		bufferedPlaneData.mNonPrioBlocks.reserve(0x800);
+		bufferedPlaneData.mPlaneState = planeState;
 
 		const uint16* planeData = planeManager.getPlaneDataInVRAM(geometry.mPlaneIndex);
 		const uint16 numPatternsPerLine = (geometry.mPlaneIndex <= PlaneManager::PLANE_A) ? planeManager.getPlayfieldSizeInPatterns().x : 64;
-		const uint16* scrollOffsetsH = nullptr;
-		const uint16* scrollOffsetsV = nullptr;
-		uint16 scrollMaskH = 0xff;
-		uint16 scrollMaskV = 0;
-		bool scrollNoRepeat = false;
 
-		if (geometry.mPlaneIndex == PlaneManager::PLANE_W)
-		{
-			static uint16 wScrollOffsetX;
-			wScrollOffsetX = (uint16)scrollOffsetsManager.getPlaneWScrollOffset().x;
-			scrollOffsetsH = &wScrollOffsetX;
-			scrollMaskH = 0;
-		}
-		else
+		// Besides the patterns added while writing the content, the name table is a dependency as well
 		{
-			scrollOffsetsH = scrollOffsetsManager.getScrollOffsetsH(geometry.mScrollOffsets);
-			scrollOffsetsV = scrollOffsetsManager.getScrollOffsetsV(geometry.mScrollOffsets);
-			scrollMaskV = scrollOffsetsManager.getVerticalScrolling() ? 0x1f : 0;
-			scrollNoRepeat = scrollOffsetsManager.getHorizontalScrollNoRepeat(geometry.mScrollOffsets);
+			const size_t nameTableStart = planeManager.getPlaneBaseVRAMAddress(geometry.mPlaneIndex);
+			const size_t nameTableEnd = std::min<size_t>(nameTableStart + numPatternsPerLine * planeManager.getPlayfieldSizeInPatterns().y * 2, 0x10000);
+			bufferedPlaneData.mUsedVRAMChunks.clearAllBits();
+			if (nameTableEnd > nameTableStart)
+				bufferedPlaneData.mUsedVRAMChunks.setBitsInRange(nameTableStart / 0x20, (nameTableEnd - 1) / 0x20);
 		}
+
 		const uint16 positionMaskH = planeManager.getPlayfieldSizeInPixels().x - 1;
 		const uint16 positionMaskV = planeManager.getPlayfieldSizeInPixels().y - 1;
 		const int16 verticalScrollOffsetBias = scrollOffsetsManager.getVerticalScrollOffsetBias();
@@ -560,7 +750,9 @@ void SoftwareRenderer::renderPlane(const PlaneGeometry& geometry)
 
 	// Write plane data to output
 	{
-		BufferedPlaneData& bufferedPlaneData = mBufferedPlaneData[foundFittingBufferedPlaneDataIndex];
+		BufferedPlaneData& bufferedPlaneData = band.mBufferedPlaneData[foundFittingBufferedPlaneDataIndex];
+		bufferedPlaneData.mUsedThisFrame = true;
+		bufferedPlaneData.mPatternRefreshCounter = mPatternRefreshCounter;
 
 		const uint32* palettes[2] = { paletteManager.getPalette(0), paletteManager.getPalette(1) };
 		const bool isBackground = (geometry.mPlaneIndex == PlaneManager::PLANE_B && !geometry.mPriorityFlag);
@@ -574,41 +766,25 @@ void SoftwareRenderer::renderPlane(const PlaneGeometry& geometry)
 
 			if (isBackground)
 			{
-				for (int i = 0; i < block.mNumPixels; ++i)
-				{
-					dstRGBA[i] = paletteWithAtex[src[i]];
-				}
+				PaletteKernels::writeOpaque(dstRGBA, src, paletteWithAtex, block.mNumPixels);
 			}
 			else if (geometry.mPriorityFlag)
 			{
 				uint8* RESTRICT dstDepth = &mDepthBuffer[block.mStartCoords.x + block.mStartCoords.y * 0x200];
-				for (int i = 0; i < block.mNumPixels; ++i)
-				{
-					if (src[i] & 0x0f)
-					{
-						dstRGBA[i] = paletteWithAtex[src[i]];
-						dstDepth[i] = 0x80;
-					}
-				}
+				PaletteKernels::writeMaskedSetDepth(dstRGBA, dstDepth, src, paletteWithAtex, block.mNumPixels, 0x80);
 			}
 			else
 			{
-				for (int i = 0; i < block.mNumPixels; ++i)
-				{
-					if (src[i] & 0x0f)
-					{
-						dstRGBA[i] = paletteWithAtex[src[i]];
-					}
-				}
+				PaletteKernels::writeMasked(dstRGBA, src, paletteWithAtex, block.mNumPixels);
 			}
 		}
 
 		if (!blocks.empty() && geometry.mPriorityFlag)
-			mEmptyDepthBuffer = false;
+			band.mEmptyDepthBuffer = false;
 	}
 }
 
-void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
+void SoftwareRenderer::renderSprite(RenderBand& band, const SpriteGeometry& geometry)
 {
 	Bitmap& gameScreenBitmap = mGameScreenTexture.accessBitmap();
 
@@ -623,10 +799,12 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			const PatternManager::CacheItem* patternCache = mRenderParts.getPatternManager().getPatternCache();
 
 			const uint8 depthValue = (sprite.mPriorityFlag) ? 0x80 : 0;
+			const bool useDepthTest = (depthValue < 0x80 && !band.mEmptyDepthBuffer);	// The highest depth value used is 0x80, so priority sprites always pass
 			const bool useTintColor = (sprite.mTintColor != Color::WHITE || sprite.mAddedColor != Color::TRANSPARENT);
+			const detail::FixedPointTint fixedPointTint(sprite.mTintColor, sprite.mAddedColor);
 
 			Recti rect(sprite.mInterpolatedPosition.x, sprite.mInterpolatedPosition.y, sprite.mSize.x * 8, sprite.mSize.y * 8);
-			rect.intersect(mCurrentViewport);
+			rect.intersect(band.mCurrentViewport);
 
 			const int minX = rect.x;
 			const int maxX = rect.x + rect.width;
@@ -636,52 +814,58 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			for (int y = minY; y < maxY; ++y)
 			{
 				const uint32* palette = (y < paletteManager.mSplitPositionY) ? palettes[0] : palettes[1];
+				const int vy = y - sprite.mInterpolatedPosition.y;
+				int patternY = vy / 8;
+				if (sprite.mFirstPattern & 0x1000)
+					patternY = sprite.mSize.y - patternY - 1;
 
-				for (int x = minX; x < maxX; ++x)
-				{
-					// Depth test
-					if (depthValue < mDepthBuffer[x + y * 0x200])
-						continue;
+				uint32* dstLine = gameScreenBitmap.getPixelPointer(0, y);
+				const uint8* depthLine = &mDepthBuffer[y * 0x200];
 
-					int vx = x - sprite.mInterpolatedPosition.x;
-					int vy = y - sprite.mInterpolatedPosition.y;
+				// Go through the line in spans of up to 8 pixels, each one being part of a single pattern line
+				for (int x = minX; x < maxX; )
+				{
+					const int vx = x - sprite.mInterpolatedPosition.x;
+					const int firstPixel = vx % 8;
+					const int numPixels = std::min(8 - firstPixel, maxX - x);
 
 					int patternX = vx / 8;
-					int patternY = vy / 8;
 					if (sprite.mFirstPattern & 0x0800)
 						patternX = sprite.mSize.x - patternX - 1;
-					if (sprite.mFirstPattern & 0x1000)
-						patternY = sprite.mSize.y - patternY - 1;
 
 					const uint16 patternIndex = sprite.mFirstPattern + patternY + patternX * sprite.mSize.y;
 					const PatternManager::CacheItem::Pattern& pattern = patternCache[patternIndex & 0x07ff].mFlipVariation[(patternIndex >> 11) & 3];
 
-					uint8 colorIndex = pattern.mPixels[(vx%8) + (vy%8) * 8];
-					colorIndex += (patternIndex >> 9) & 0x30;
-					if (colorIndex & 0x0f)
+					// Bit mask of the non-transparent pixels, so that fully transparent spans can be skipped right away
+					const uint32 opaqueMask = (pattern.mOpaqueMask[vy % 8] >> firstPixel) & ((1 << numPixels) - 1);
+					if (opaqueMask != 0)
 					{
-						uint32& dst = *gameScreenBitmap.getPixelPointer(x, y);
+						const uint8* src = &pattern.mPixels[firstPixel + (vy % 8) * 8];
+						const uint32* paletteWithAtex = &palette[(patternIndex >> 9) & 0x30];
+						uint32* dst = &dstLine[x];
+
 						if (useTintColor)
 						{
-							Color color = Color::fromABGR32(palette[colorIndex]);
-							color.r = saturate(sprite.mAddedColor.r + color.r * sprite.mTintColor.r);
-							color.g = saturate(sprite.mAddedColor.g + color.g * sprite.mTintColor.g);
-							color.b = saturate(sprite.mAddedColor.b + color.b * sprite.mTintColor.b);
-							color.a = saturate(sprite.mAddedColor.a + color.a * sprite.mTintColor.a);
-
-							if (color.a < 1.0f)
+							for (int i = 0; i < numPixels; ++i)
 							{
-								color = color.blendOver(Color::fromABGR32(dst));
-								color.a = 1.0f;
+								if ((opaqueMask & (1 << i)) && (!useDepthTest || depthValue >= depthLine[x + i]))
+									dst[i] = fixedPointTint.apply(paletteWithAtex[src[i]], dst[i]);
 							}
-
-							dst = color.getABGR32();
+						}
+						else if (useDepthTest)
+						{
+							PaletteKernels::writeMaskedDepthTest(dst, &depthLine[x], src, paletteWithAtex, numPixels, depthValue);
+						}
+						else if (opaqueMask == (uint32)((1 << numPixels) - 1))
+						{
+							PaletteKernels::writeOpaque(dst, src, paletteWithAtex, numPixels);
 						}
 						else
 						{
-							dst = palette[colorIndex];
+							PaletteKernels::writeMasked(dst, src, paletteWithAtex, numPixels);
 						}
 					}
+					x += numPixels;
 				}
 			}
 
@@ -697,10 +881,10 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			const PaletteManager& paletteManager = mRenderParts.getPaletteManager();
 
 			SpriteBase::BlitOptions blitOptions;
-			blitOptions.mTargetRect = mFullViewport ? nullptr : &mCurrentViewport;
+			blitOptions.mTargetRect = band.mFullViewport ? nullptr : &band.mCurrentViewport;
 			blitOptions.mTransform = hasTransform ? *sprite.mTransformation.mMatrix : nullptr;
 			blitOptions.mInvTransform = hasTransform ? *sprite.mTransformation.mInverse : nullptr;
-			blitOptions.mDepthBuffer = (mEmptyDepthBuffer && !sprite.mPriorityFlag) ? nullptr : mDepthBuffer;
+			blitOptions.mDepthBuffer = (band.mEmptyDepthBuffer && !sprite.mPriorityFlag) ? nullptr : mDepthBuffer;
 			blitOptions.mDepthValue = (sprite.mPriorityFlag) ? 0x80 : 0;
 			blitOptions.mIgnoreAlpha = sprite.mFullyOpaque;
 			blitOptions.mTintColor = (sprite.mTintColor != Color::WHITE) ? &sprite.mTintColor : nullptr;
@@ -712,14 +896,14 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			{
 				Recti targetRect(0, 0, mGameResolution.x, splitY);
 				blitOptions.mTargetRect = &targetRect;
-				if (!mFullViewport)
-					targetRect.intersect(mCurrentViewport);
+				if (!band.mFullViewport)
+					targetRect.intersect(band.mCurrentViewport);
 				paletteSprite.blitInto(gameScreenBitmap, sprite.mInterpolatedPosition, paletteManager.getPalette(0) + sprite.mAtex, blitOptions);
 
 				targetRect.y = splitY;
 				targetRect.height = mGameResolution.y - splitY;
-				if (!mFullViewport)
-					targetRect.intersect(mCurrentViewport);
+				if (!band.mFullViewport)
+					targetRect.intersect(band.mCurrentViewport);
 				paletteSprite.blitInto(gameScreenBitmap, sprite.mInterpolatedPosition, paletteManager.getPalette(1) + sprite.mAtex, blitOptions);
 			}
 			else
@@ -728,7 +912,7 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			}
 
 			if (sprite.mPriorityFlag)
-				mEmptyDepthBuffer = false;
+				band.mEmptyDepthBuffer = false;
 			break;
 		}
 
@@ -752,10 +936,10 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			}
 
 			SpriteBase::BlitOptions blitOptions;
-			blitOptions.mTargetRect = mFullViewport ? nullptr : &mCurrentViewport;
+			blitOptions.mTargetRect = band.mFullViewport ? nullptr : &band.mCurrentViewport;
 			blitOptions.mTransform = hasTransform ? *sprite.mTransformation.mMatrix : nullptr;
 			blitOptions.mInvTransform = hasTransform ? *sprite.mTransformation.mInverse : nullptr;
-			blitOptions.mDepthBuffer = (mEmptyDepthBuffer && !sprite.mPriorityFlag) ? nullptr : mDepthBuffer;
+			blitOptions.mDepthBuffer = (band.mEmptyDepthBuffer && !sprite.mPriorityFlag) ? nullptr : mDepthBuffer;
 			blitOptions.mDepthValue = (sprite.mPriorityFlag) ? 0x80 : 0;
 			blitOptions.mIgnoreAlpha = sprite.mFullyOpaque;
 			blitOptions.mTintColor = (tintColor != Color::WHITE) ? &tintColor : nullptr;
@@ -764,7 +948,7 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 			componentSprite.blitInto(gameScreenBitmap, sprite.mInterpolatedPosition, blitOptions);
 
 			if (sprite.mPriorityFlag)
-				mEmptyDepthBuffer = false;
+				band.mEmptyDepthBuffer = false;
 			break;
 		}
 
@@ -779,8 +963,8 @@ void SoftwareRenderer::renderSprite(const SpriteGeometry& geometry)
 				const int bytes = (maxX - minX) * 4;
 				if (bytes > 0)
 				{
-					const int minY = clamp(mask.mInterpolatedPosition.y, 0, gameScreenBitmap.getHeight());
-					const int maxY = clamp(mask.mInterpolatedPosition.y + mask.mSize.y, 0, gameScreenBitmap.getHeight());
+					const int minY = clamp(mask.mInterpolatedPosition.y, band.mMinY, band.mMaxY);
+					const int maxY = clamp(mask.mInterpolatedPosition.y + mask.mSize.y, band.mMinY, band.mMaxY);
 
 					for (int line = minY; line < maxY; ++line)
 					{
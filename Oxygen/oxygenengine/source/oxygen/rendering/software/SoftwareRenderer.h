@@ -12,6 +12,7 @@
 
 class PlaneGeometry;
 class SpriteGeometry;
+class WorkerPool;
 namespace detail
 {
 	class PixelBlockWriter;
@@ -27,6 +28,7 @@ public:
 
 public:
 	SoftwareRenderer(RenderParts& renderParts, DrawerTexture& outputTexture);
+	~SoftwareRenderer();
 
 	virtual void initialize() override;
 	virtual void reset() override;
@@ -36,20 +38,6 @@ public:
 	virtual void renderDebugDraw(int debugDrawMode, const Recti& rect) override;
 
 private:
-	void renderGeometry(const Geometry& geometry);
-	void renderPlane(const PlaneGeometry& geometry);
-	void renderSprite(const SpriteGeometry& geometry);
-
-private:
-	Vec2i mGameResolution;
-	Bitmap mGameScreenCopy;
-
-	uint8 mDepthBuffer[0x20000] = { 0 };	// 512x256 pixels
-	bool mEmptyDepthBuffer = true;			// Stays true until first non-zero depth value was written
-
-	Recti mCurrentViewport;
-	bool mFullViewport = true;
-
 	struct BufferedPlaneData
 	{
 		struct PixelBlock
@@ -62,6 +50,7 @@ private:
 		};
 
 		bool mValid = false;
+		bool mUsedThisFrame = false;
 		int mPlaneIndex = 0;
 		int mScrollOffsets = 0;
 		Recti mActiveRect;
@@ -69,7 +58,40 @@ private:
 		std::vector<uint8> mContent;
 		std::vector<PixelBlock> mPrioBlocks;
 		std::vector<PixelBlock> mNonPrioBlocks;
+
+		// For reusing the content in later frames
+		std::vector<int> mPlaneState;			// Everything the content depends on except for VRAM, like screen area and scroll offsets
+		BitArray<0x800> mUsedVRAMChunks;		// The 32-byte chunks of VRAM the content depends on, i.e. patterns and name table
+		uint32 mPatternRefreshCounter = 0;		// Pattern manager's refresh counter when the content was last known to be up-to-date
 	};
 	static const constexpr int MAX_BUFFER_PLANE_DATA = 8;
-	BufferedPlaneData mBufferedPlaneData[MAX_BUFFER_PLANE_DATA];
+
+	// Horizontal band of the game screen, rendered independently of the others
+	struct RenderBand
+	{
+		int mMinY = 0;
+		int mMaxY = 0;
+		Recti mCurrentViewport;					// Current viewport, clipped to the band
+		bool mFullViewport = true;				// Only possible if there's just one band covering the whole screen
+		bool mEmptyDepthBuffer = true;			// Stays true until first non-zero depth value was written in the band
+		BufferedPlaneData mBufferedPlaneData[MAX_BUFFER_PLANE_DATA];
+	};
+	static const constexpr int MIN_RENDER_BAND_HEIGHT = 16;
+
+private:
+	void renderBand(RenderBand& band, const std::vector<Geometry*>& geometries, bool usingSpriteMask);
+	void renderGeometry(RenderBand& band, const Geometry& geometry);
+	void renderPlane(RenderBand& band, const PlaneGeometry& geometry);
+	void renderSprite(RenderBand& band, const SpriteGeometry& geometry);
+
+private:
+	Vec2i mGameResolution;
+	Bitmap mGameScreenCopy;
+
+	uint8 mDepthBuffer[0x20000] = { 0 };	// 512x256 pixels, each band only uses its own lines
+
+	std::vector<RenderBand> mRenderBands;
+	WorkerPool* mWorkerPool = nullptr;
+
+	uint32 mPatternRefreshCounter = 0;		// Pattern manager's refresh counter in the current frame
 };
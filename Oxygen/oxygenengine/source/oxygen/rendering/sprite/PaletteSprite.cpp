@@ -18,15 +18,6 @@ namespace
 		return Vec2i((vec.x + 3) & 0xfffffffc, (vec.y + 3) & 0xfffffffc);
 	}
 
-	void applyPalette(Bitmap& output, int& outputReservedSize, const PaletteBitmap& input, const uint32* palette)
-	{
-		output.createReusingMemory(input.mWidth, input.mHeight, outputReservedSize);
-		for (int i = 0; i < output.getPixelCount(); ++i)
-		{
-			output.getData()[i] = palette[input.mData[i]];
-		}
-	}
-
 	void applyScale3x(PaletteBitmap& output, const PaletteBitmap& input)
 	{
 		// Based on https://en.wikipedia.org/wiki/Pixel-art_scaling_algorithms#Scale3%C3%97/AdvMAME3%C3%97_and_ScaleFX
@@ -199,12 +190,8 @@ void PaletteSprite::blitInto(PaletteBitmap& output, const Vec2i& position) const
 
 void PaletteSprite::blitInto(Bitmap& output, const Vec2i& position, const uint32* palette, const BlitOptions& blitOptions) const
 {
-	// We are converting the palette bitmap to RGBA, so we can use the same functionality as for component sprites
-	static Bitmap tempBitmap;
-	static int tempBitmapSize = 0;
-	applyPalette(tempBitmap, tempBitmapSize, blitOptions.mUseUpscaledSprite ? getUpscaledBitmap() : mBitmap, palette);
-
-	SpriteBase::blitInto(output, tempBitmap, position, blitOptions);
+	// Palette indices get resolved only for the pixels actually drawn
+	SpriteBase::blitInto(output, blitOptions.mUseUpscaledSprite ? getUpscaledBitmap() : mBitmap, palette, position, blitOptions);
 }
 
 const PaletteBitmap& PaletteSprite::getUpscaledBitmap() const
@@ -8,10 +8,47 @@
 
 #include "oxygen/pch.h"
 #include "oxygen/rendering/sprite/SpriteBase.h"
+#include "oxygen/rendering/utils/PaletteBitmap.h"
 
 
 namespace spritebaseinternal
 {
+	// Source of RGBA pixels for the blit functions below
+	struct RGBASource
+	{
+		struct Line
+		{
+			const uint32* mPixels;
+			FORCE_INLINE uint32 operator[](int index) const  { return mPixels[index]; }
+		};
+
+		const Bitmap& mBitmap;
+
+		inline int getWidth() const  { return mBitmap.getWidth(); }
+		inline int getHeight() const  { return mBitmap.getHeight(); }
+		FORCE_INLINE uint32 getPixel(int x, int y) const  { return mBitmap.getPixel(x, y); }
+		FORCE_INLINE Line getLine(int x, int y) const  { return Line { mBitmap.getPixelPointer(x, y) }; }
+	};
+
+	// Source of palette indices, which get resolved to RGBA only when reading the pixels
+	struct IndexedSource
+	{
+		struct Line
+		{
+			const uint8* mIndices;
+			const uint32* mPalette;
+			FORCE_INLINE uint32 operator[](int index) const  { return mPalette[mIndices[index]]; }
+		};
+
+		const PaletteBitmap& mBitmap;
+		const uint32* mPalette;
+
+		inline int getWidth() const  { return mBitmap.getWidth(); }
+		inline int getHeight() const  { return mBitmap.getHeight(); }
+		FORCE_INLINE uint32 getPixel(int x, int y) const  { return mPalette[mBitmap.getPixel(x, y)]; }
+		FORCE_INLINE Line getLine(int x, int y) const  { return Line { mBitmap.getPixelPointer(x, y), mPalette }; }
+	};
+
 	uint32 FORCE_INLINE blendColors(uint32 src, uint32 dst)
 	{
 		const uint8* srcPtr = (uint8*)&src;
@@ -26,13 +63,12 @@ namespace spritebaseinternal
 	}
 
 
-	template<bool USE_ALPHA, bool DEPTH_TEST>
-	void blitLine_withTintAdd(uint32* dst, const uint32* src, int numPixels, const uint8* depthBuffer, uint8 depthValue, const Color& addedColor, const Color& tintColor)
+	template<bool USE_ALPHA, bool DEPTH_TEST, typename LINE>
+	void blitLine_withTintAdd(uint32* dst, const LINE& src, int numPixels, const uint8* depthBuffer, uint8 depthValue, const Color& addedColor, const Color& tintColor)
 	{
 		for (int i = 0; i < numPixels; ++i)
 		{
-			uint32 pixel = *src;
-			++src;
+			uint32 pixel = src[i];
 
 			// Check for transparency
 			if (!USE_ALPHA || (pixel & 0xff000000) != 0)
@@ -65,13 +101,12 @@ namespace spritebaseinternal
 		}
 	}
 
-	template<bool USE_ALPHA, bool DEPTH_TEST>
-	void blitLine_noTintAdd(uint32* dst, const uint32* src, int numPixels, const uint8* depthBuffer, uint8 depthValue)
+	template<bool USE_ALPHA, bool DEPTH_TEST, typename LINE>
+	void blitLine_noTintAdd(uint32* dst, const LINE& src, int numPixels, const uint8* depthBuffer, uint8 depthValue)
 	{
 		for (int i = 0; i < numPixels; ++i)
 		{
-			uint32 pixel = *src;
-			++src;
+			uint32 pixel = src[i];
 
 			// Check for transparency
 			if (!USE_ALPHA || (pixel & 0xff000000) != 0)
@@ -92,12 +127,21 @@ namespace spritebaseinternal
 		}
 	}
 
-	void blitLine_simple(uint32* dst, const uint32* src, int numPixels)
+	void blitLine_simple(uint32* dst, const RGBASource::Line& src, int numPixels)
 	{
-		memcpy(dst, src, numPixels * sizeof(uint32));
+		memcpy(dst, src.mPixels, numPixels * sizeof(uint32));
 	}
 
-	void blitSpriteNoTransform(Bitmap& destBitmap, const Vec2i& destPosition, const Bitmap& sourceBitmap, const Vec2i& offset, const SpriteBase::BlitOptions& blitOptions)
+	void blitLine_simple(uint32* dst, const IndexedSource::Line& src, int numPixels)
+	{
+		for (int i = 0; i < numPixels; ++i)
+		{
+			dst[i] = src.mPalette[src.mIndices[i]];
+		}
+	}
+
+	template<typename SOURCE>
+	void blitSpriteNoTransform(Bitmap& destBitmap, const Vec2i& destPosition, const SOURCE& sourceBitmap, const Vec2i& offset, const SpriteBase::BlitOptions& blitOptions)
 	{
 		const bool useTintAdd = (nullptr != blitOptions.mTintColor || nullptr != blitOptions.mAddedColor);
 		const Color tintColor = (nullptr == blitOptions.mTintColor) ? Color::WHITE : *blitOptions.mTintColor;
@@ -122,7 +166,7 @@ namespace spritebaseinternal
 		for (int iy = minY; iy < maxY; ++iy)
 		{
 			uint32* dst = destBitmap.getPixelPointer(minX, iy);
-			const uint32* src = sourceBitmap.getPixelPointer(minX - px, iy - py);
+			const typename SOURCE::Line src = sourceBitmap.getLine(minX - px, iy - py);
 
 			if (!useTintAdd)
 			{
@@ -177,7 +221,8 @@ namespace spritebaseinternal
 		}
 	}
 
-	void blitSpriteWithTransform(Bitmap& destBitmap, const Vec2i& destPosition, const Bitmap& sourceBitmap, const Vec2i& offset, const SpriteBase::BlitOptions& blitOptions)
+	template<typename SOURCE>
+	void blitSpriteWithTransform(Bitmap& destBitmap, const Vec2i& destPosition, const SOURCE& sourceBitmap, const Vec2i& offset, const SpriteBase::BlitOptions& blitOptions)
 	{
 		const bool useTintAdd = (nullptr != blitOptions.mTintColor || nullptr != blitOptions.mAddedColor);
 		const Color tintColor = (nullptr == blitOptions.mTintColor) ? Color::WHITE : *blitOptions.mTintColor;
@@ -282,12 +327,26 @@ namespace spritebaseinternal
 
 void SpriteBase::blitInto(Bitmap& output, const Bitmap& input, const Vec2i& position, const BlitOptions& blitOptions) const
 {
+	const spritebaseinternal::RGBASource source { input };
+	if (nullptr == blitOptions.mTransform)
+	{
+		spritebaseinternal::blitSpriteNoTransform(output, position, source, mOffset, blitOptions);
+	}
+	else
+	{
+		spritebaseinternal::blitSpriteWithTransform(output, position, source, mOffset, blitOptions);
+	}
+}
+
+void SpriteBase::blitInto(Bitmap& output, const PaletteBitmap& input, const uint32* palette, const Vec2i& position, const BlitOptions& blitOptions) const
+{
+	const spritebaseinternal::IndexedSource source { input, palette };
 	if (nullptr == blitOptions.mTransform)
 	{
-		spritebaseinternal::blitSpriteNoTransform(output, position, input, mOffset, blitOptions);
+		spritebaseinternal::blitSpriteNoTransform(output, position, source, mOffset, blitOptions);
 	}
 	else
 	{
-		spritebaseinternal::blitSpriteWithTransform(output, position, input, mOffset, blitOptions);
+		spritebaseinternal::blitSpriteWithTransform(output, position, source, mOffset, blitOptions);
 	}
 }
@@ -10,6 +10,7 @@
 
 #include <rmxbase.h>
 
+class PaletteBitmap;
 
 class SpriteBase
 {
@@ -34,6 +35,7 @@ public:
 
 protected:
 	void blitInto(Bitmap& output, const Bitmap& input, const Vec2i& position, const BlitOptions& blitOptions) const;
+	void blitInto(Bitmap& output, const PaletteBitmap& input, const uint32* palette, const Vec2i& position, const BlitOptions& blitOptions) const;
 
 public:
 	Vec2i mOffset;		// Offset of upper left corner relative to pivot
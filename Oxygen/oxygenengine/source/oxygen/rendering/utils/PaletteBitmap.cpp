@@ -239,6 +239,30 @@ bool PaletteBitmap::loadBMP(const std::vector<uint8>& bmpContent, Color* outPale
 	return true;
 }
 
+bool PaletteBitmap::loadPNG(const std::vector<uint8>& pngContent, Color* outPalette)
+{
+	// Decode palette indices directly, without going through a 32-bit bitmap
+	MemInputStream stream(pngContent.data(), (int)pngContent.size());
+	std::vector<uint8> indices;
+	int width = 0;
+	int height = 0;
+	uint32 palette[0x100];
+	if (!BitmapCodecPNG::decodeIndexed(stream, indices, width, height, palette))
+		return false;
+
+	create(width, height);
+	memcpy(mData, indices.data(), indices.size());
+
+	if (nullptr != outPalette)
+	{
+		for (int i = 0; i < 0x100; ++i)
+		{
+			outPalette[i] = Color::fromABGR32(palette[i]);
+		}
+	}
+	return true;
+}
+
 bool PaletteBitmap::saveBMP(std::vector<uint8>& bmpContent, const Color* palette)
 {
 	VectorBinarySerializer serializer(false, bmpContent);
@@ -44,6 +44,7 @@ public:
 	void overwriteUnusedPaletteEntries(Color* palette);
 
 	bool loadBMP(const std::vector<uint8>& bmpContent, Color* outPalette = nullptr);
+	bool loadPNG(const std::vector<uint8>& pngContent, Color* outPalette = nullptr);
 	bool saveBMP(std::vector<uint8>& bmpContent, const Color* palette);
 
 private:
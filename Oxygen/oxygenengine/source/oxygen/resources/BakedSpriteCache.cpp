@@ -0,0 +1,303 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "oxygen/pch.h"
+#include "oxygen/resources/BakedSpriteCache.h"
+#include "oxygen/application/Configuration.h"
+#include "oxygen/rendering/sprite/ComponentSprite.h"
+#include "oxygen/rendering/sprite/PaletteSprite.h"
+
+
+namespace
+{
+	const constexpr uint32 SIGNATURE = 0x50534b42;		// "BKSP"
+	const constexpr uint32 FORMAT_VERSION = 1;
+	const constexpr size_t DATA_ALIGNMENT = 16;
+
+	struct Header
+	{
+		uint32 mSignature;
+		uint32 mFormatVersion;
+		uint64 mSourceHash;
+		uint32 mNumImageFiles;
+		uint32 mNumSprites;
+		uint64 mSpritesOffset;		// Position of the sprite table; the image file names are stored between header and sprite table
+	};
+	static_assert(sizeof(Header) == 32, "Unexpected size of baked sprite cache header");
+	static_assert(sizeof(BakedSpriteCache::Sprite) == 40, "Unexpected size of baked sprite cache entry");
+
+	inline uint64 addToHash(uint64 hash, uint64 value)
+	{
+		return rmx::addToFNV1a_64(hash, (const uint8*)&value, sizeof(value));
+	}
+
+	inline size_t alignSize(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	void writeData(std::vector<uint8>& buffer, const void* data, size_t size)
+	{
+		const size_t offset = buffer.size();
+		buffer.resize(offset + size);
+		memcpy(&buffer[offset], data, size);
+	}
+
+	std::wstring getCacheDirectory()
+	{
+		return Configuration::instance().mAppDataPath + L"cache/sprites/";
+	}
+}
+
+
+std::wstring BakedSpriteCache::getCacheFilename(const std::wstring& spritesPath)
+{
+	return getCacheDirectory() + String(rmx::hexString(rmx::getMurmur2_64(spritesPath), 16, "")).toStdWString() + L".bin";
+}
+
+uint64 BakedSpriteCache::getSourceHash(const std::vector<std::wstring>& definitionFiles, const std::vector<std::wstring>& imageFiles)
+{
+	uint64 hash = rmx::startFNV1a_64();
+	hash = addToHash(hash, FORMAT_VERSION);
+
+	rmx::FileView content;
+	for (const std::vector<std::wstring>* filenames : { &definitionFiles, &imageFiles })
+	{
+		hash = addToHash(hash, filenames->size());
+		for (const std::wstring& filename : *filenames)
+		{
+			hash = addToHash(hash, rmx::getMurmur2_64(filename));
+
+			// Real files are identified by their size and last write time, so the cache can be validated without reading them
+			//  -> Only for files inside packages, which have no time stamp, the contents need to be hashed
+			const time_t fileTime = FTX::FileSystem->getFileTime(filename);
+			if (fileTime != 0)
+			{
+				hash = addToHash(hash, FTX::FileSystem->getFileSize(filename));
+				hash = addToHash(hash, (uint64)fileTime);
+			}
+			else if (FTX::FileSystem->readFileView(filename, content))
+			{
+				hash = addToHash(hash, content.getSize());
+				hash = addToHash(hash, rmx::getMurmur2_64(content.getData(), content.getSize()));
+			}
+			else
+			{
+				hash = addToHash(hash, 0xffffffffffffffffull);
+			}
+		}
+	}
+	return hash;
+}
+
+void BakedSpriteCache::removeUnusedCacheFiles(const std::vector<std::wstring>& spritesPaths)
+{
+	std::set<std::wstring> usedCacheFilenames;
+	for (const std::wstring& spritesPath : spritesPaths)
+	{
+		usedCacheFilenames.insert(getCacheFilename(spritesPath));
+	}
+
+	const std::wstring cacheDirectory = getCacheDirectory();
+	std::vector<rmx::FileIO::FileEntry> fileEntries;
+	FTX::FileSystem->listFilesByMask(cacheDirectory + L"*.bin", false, fileEntries);
+	for (const rmx::FileIO::FileEntry& entry : fileEntries)
+	{
+		if (usedCacheFilenames.count(cacheDirectory + entry.mFilename) == 0)
+		{
+			FTX::FileSystem->removeFile(entry.mPath + entry.mFilename);
+		}
+	}
+}
+
+bool BakedSpriteCache::save(const std::wstring& cacheFilename, const std::vector<std::wstring>& definitionFiles, const std::vector<std::wstring>& imageFiles, const std::vector<SpriteInput>& sprites)
+{
+	std::vector<uint8> buffer;
+	buffer.resize(sizeof(Header));
+
+	// Image file names, needed for checking if the cache is still valid
+	for (const std::wstring& filename : imageFiles)
+	{
+		const String utf8 = WString(filename).toUTF8();
+		const uint32 length = (uint32)utf8.length();
+		writeData(buffer, &length, sizeof(length));
+		writeData(buffer, *utf8, length);
+	}
+
+	// Sprite table, followed by the pixel data of all sprites
+	const size_t spritesOffset = alignSize(buffer.size(), DATA_ALIGNMENT);
+	size_t dataOffset = alignSize(spritesOffset + sprites.size() * sizeof(Sprite), DATA_ALIGNMENT);
+	buffer.resize(dataOffset, 0);
+	for (size_t index = 0; index < sprites.size(); ++index)
+	{
+		const SpriteInput& input = sprites[index];
+		Sprite sprite;
+		memset(&sprite, 0, sizeof(Sprite));
+		sprite.mKey = input.mKey;
+		sprite.mOffsetX = input.mSprite->mOffset.x;
+		sprite.mOffsetY = input.mSprite->mOffset.y;
+		sprite.mUsesComponentSprite = input.mUsesComponentSprite ? 1 : 0;
+
+		const void* pixels = nullptr;
+		size_t pixelsSize = 0;
+		if (input.mUsesComponentSprite)
+		{
+			const Bitmap& bitmap = static_cast<const ComponentSprite*>(input.mSprite)->getBitmap();
+			sprite.mWidth = bitmap.getWidth();
+			sprite.mHeight = bitmap.getHeight();
+			pixels = bitmap.getData();
+			pixelsSize = (size_t)bitmap.getPixelCount() * 4;
+		}
+		else
+		{
+			const PaletteBitmap& bitmap = static_cast<const PaletteSprite*>(input.mSprite)->getBitmap();
+			sprite.mWidth = bitmap.getWidth();
+			sprite.mHeight = bitmap.getHeight();
+			pixels = bitmap.getData();
+			pixelsSize = (size_t)bitmap.getPixelCount();
+		}
+
+		if (nullptr != pixels && pixelsSize > 0)
+		{
+			sprite.mDataOffset = dataOffset;
+			buffer.resize(dataOffset);
+			writeData(buffer, pixels, pixelsSize);
+			dataOffset = alignSize(buffer.size(), DATA_ALIGNMENT);
+		}
+		else
+		{
+			sprite.mWidth = 0;
+			sprite.mHeight = 0;
+		}
+		memcpy(&buffer[spritesOffset + index * sizeof(Sprite)], &sprite, sizeof(Sprite));
+	}
+
+	Header header;
+	header.mSignature = SIGNATURE;
+	header.mFormatVersion = FORMAT_VERSION;
+	header.mSourceHash = getSourceHash(definitionFiles, imageFiles);
+	header.mNumImageFiles = (uint32)imageFiles.size();
+	header.mNumSprites = (uint32)sprites.size();
+	header.mSpritesOffset = spritesOffset;
+	memcpy(&buffer[0], &header, sizeof(Header));
+
+	return FTX::FileSystem->saveFile(cacheFilename, buffer);
+}
+
+bool BakedSpriteCache::load(const std::wstring& cacheFilename, const std::vector<std::wstring>& definitionFiles)
+{
+	clear();
+	if (!FTX::FileSystem->mapFile(cacheFilename, mContent))
+		return false;
+
+	// The sprite table gets accessed in-place, so the data needs to be properly aligned
+	const uint8* data = mContent.getData();
+	const size_t size = mContent.getSize();
+	if (size < sizeof(Header) || ((size_t)data % alignof(Sprite)) != 0)
+	{
+		clear();
+		return false;
+	}
+
+	Header header;
+	memcpy(&header, data, sizeof(Header));
+	if (header.mSignature != SIGNATURE || header.mFormatVersion != FORMAT_VERSION)
+	{
+		clear();
+		return false;
+	}
+
+	// Read image file names
+	std::vector<std::wstring> imageFiles;
+	imageFiles.reserve(header.mNumImageFiles);
+	size_t position = sizeof(Header);
+	for (uint32 k = 0; k < header.mNumImageFiles; ++k)
+	{
+		uint32 length = 0;
+		if (position + sizeof(length) > size)
+			break;
+		memcpy(&length, &data[position], sizeof(length));
+		position += sizeof(length);
+		if (position + length > size)
+			break;
+
+		WString filename;
+		filename.fromUTF8((const char*)&data[position], length);
+		imageFiles.emplace_back(filename.toStdWString());
+		position += length;
+	}
+
+	// Validate the sprite table
+	bool valid = (imageFiles.size() == header.mNumImageFiles);
+	valid = valid && (header.mSpritesOffset >= position && header.mSpritesOffset % DATA_ALIGNMENT == 0 && header.mSpritesOffset + (uint64)header.mNumSprites * sizeof(Sprite) <= size);
+	if (valid)
+	{
+		const Sprite* sprites = reinterpret_cast<const Sprite*>(&data[header.mSpritesOffset]);
+		for (uint32 k = 0; k < header.mNumSprites; ++k)
+		{
+			const Sprite& sprite = sprites[k];
+			const uint64 pixelsSize = (uint64)sprite.mWidth * sprite.mHeight * (sprite.mUsesComponentSprite ? 4 : 1);
+			if (sprite.mWidth > 0x10000 || sprite.mHeight > 0x10000 || (pixelsSize > 0 && (sprite.mDataOffset > size || pixelsSize > size - sprite.mDataOffset)))
+			{
+				valid = false;
+				break;
+			}
+		}
+	}
+
+	// Check if any of the source files changed
+	if (!valid || header.mSourceHash != getSourceHash(definitionFiles, imageFiles))
+	{
+		clear();
+		return false;
+	}
+
+	mSprites = reinterpret_cast<const Sprite*>(&data[header.mSpritesOffset]);
+	mNumSprites = header.mNumSprites;
+	return true;
+}
+
+void BakedSpriteCache::clear()
+{
+	mContent.clear();
+	mSprites = nullptr;
+	mNumSprites = 0;
+}
+
+SpriteBase* BakedSpriteCache::createSprite(size_t index) const
+{
+	const Sprite& sprite = mSprites[index];
+	const uint8* pixels = mContent.getData() + sprite.mDataOffset;
+	SpriteBase* result = nullptr;
+
+	if (sprite.mUsesComponentSprite)
+	{
+		ComponentSprite* componentSprite = new ComponentSprite();
+		if (sprite.mWidth > 0 && sprite.mHeight > 0)
+		{
+			Bitmap& bitmap = componentSprite->accessBitmap();
+			bitmap.create(sprite.mWidth, sprite.mHeight);
+			memcpy(bitmap.getData(), pixels, (size_t)bitmap.getPixelCount() * 4);
+		}
+		result = componentSprite;
+	}
+	else
+	{
+		PaletteSprite* paletteSprite = new PaletteSprite();
+		if (sprite.mWidth > 0 && sprite.mHeight > 0)
+		{
+			PaletteBitmap& bitmap = paletteSprite->accessBitmap();
+			bitmap.create(sprite.mWidth, sprite.mHeight);
+			memcpy(bitmap.getData(), pixels, (size_t)bitmap.getPixelCount());
+		}
+		result = paletteSprite;
+	}
+
+	result->mOffset.set(sprite.mOffsetX, sprite.mOffsetY);
+	return result;
+}
@@ -0,0 +1,68 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include <rmxbase.h>
+
+class SpriteBase;
+
+
+// Binary cache of all sprites loaded from one sprites directory (of the base game data or a mod)
+//  -> Sprites are stored already cut out of their sprite sheets, so that neither JSON parsing nor image decoding is needed
+//  -> The cache file gets memory-mapped where possible and its contents are used in-place; it's validated using a hash over the sizes and time stamps of all source files
+//     (or their contents, for files inside packages)
+class BakedSpriteCache
+{
+public:
+	struct SpriteInput
+	{
+		uint64 mKey = 0;
+		const SpriteBase* mSprite = nullptr;
+		bool mUsesComponentSprite = false;
+	};
+
+	// Sprite entry as stored in the cache file
+	struct Sprite
+	{
+		uint64 mKey;
+		uint64 mDataOffset;		// Position of the pixel data, relative to the start of the cache file
+		int32 mOffsetX;
+		int32 mOffsetY;
+		uint32 mWidth;
+		uint32 mHeight;
+		uint8 mUsesComponentSprite;
+		uint8 mReserved[7];
+	};
+
+public:
+	static std::wstring getCacheFilename(const std::wstring& spritesPath);
+	static uint64 getSourceHash(const std::vector<std::wstring>& definitionFiles, const std::vector<std::wstring>& imageFiles);
+
+	// Delete all cache files that don't belong to any of the given sprites directories, e.g. those of mods that got removed
+	static void removeUnusedCacheFiles(const std::vector<std::wstring>& spritesPaths);
+
+	// Save the given sprites (in the order they get added to the sprite cache) together with the hash of their source files
+	static bool save(const std::wstring& cacheFilename, const std::vector<std::wstring>& definitionFiles, const std::vector<std::wstring>& imageFiles, const std::vector<SpriteInput>& sprites);
+
+public:
+	// Load the cache file, and check if it's still up-to-date with the given sprite definition files and the image files it refers to
+	bool load(const std::wstring& cacheFilename, const std::vector<std::wstring>& definitionFiles);
+	void clear();
+
+	inline size_t getNumSprites() const  { return mNumSprites; }
+	inline const Sprite& getSprite(size_t index) const  { return mSprites[index]; }
+
+	// Create a new sprite instance from the cached data
+	SpriteBase* createSprite(size_t index) const;
+
+private:
+	rmx::FileView mContent;
+	const Sprite* mSprites = nullptr;
+	size_t mNumSprites = 0;
+};
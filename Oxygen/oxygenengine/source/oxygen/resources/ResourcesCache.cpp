@@ -133,23 +133,18 @@ bool ResourcesCache::loadRomFromMemory(const std::vector<uint8>& content)
 
 void ResourcesCache::loadAllResources()
 {
+	// File reading and decoding is done on multiple threads, but results get added in a fixed order
+	WorkerPool workerPool(WorkerPool::getDefaultNumWorkerThreads());
+
 	// Load raw data incl. ROM injections
 	mRawDataMap.clear();
 	mRomInjections.clear();
 	mRawDataPool.clear();
-	loadRawData(L"data/rawdata", false);
-	for (const Mod* mod : ModManager::instance().getActiveMods())
-	{
-		loadRawData(mod->mFullPath + L"rawdata", true);
-	}
+	loadRawData(workerPool);
 
 	// Load palettes
 	mPalettes.clear();
-	loadPalettes(L"data/palettes", false);
-	for (const Mod* mod : ModManager::instance().getActiveMods())
-	{
-		loadPalettes(mod->mFullPath + L"palettes", true);
-	}
+	loadPalettes(workerPool);
 }
 
 const std::vector<const ResourcesCache::RawData*>& ResourcesCache::getRawData(uint64 key) const
@@ -326,73 +321,152 @@ void ResourcesCache::saveRomToAppData()
 	}
 }
 
-void ResourcesCache::loadRawData(const std::wstring& path, bool isModded)
+void ResourcesCache::loadRawData(WorkerPool& workerPool)
 {
-	// Load raw data from the given path
-	std::vector<rmx::FileIO::FileEntry> fileEntries;
-	fileEntries.reserve(8);
-	FTX::FileSystem->listFilesByMask(path + L"/*.json", true, fileEntries);
-	for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+	struct RawDataEntry
+	{
+		uint64 mKey = 0;
+		std::vector<uint8> mContent;
+		bool mIsRomInjection = false;
+		uint32 mRomInjectAddress = 0xffffffff;
+	};
+	struct RawDataFile
+	{
+		std::wstring mPath;
+		std::wstring mFilename;
+		bool mIsModded = false;
+		std::string mErrors;
+		std::vector<RawDataEntry> mEntries;
+	};
+
+	// Collect the raw data definition files, in the order they get applied
+	std::vector<RawDataFile> rawDataFiles;
+	{
+		std::vector<rmx::FileIO::FileEntry> fileEntries;
+		fileEntries.reserve(8);
+		const std::vector<Mod*>& mods = ModManager::instance().getActiveMods();
+		for (size_t index = 0; index <= mods.size(); ++index)
+		{
+			fileEntries.clear();
+			FTX::FileSystem->listFilesByMask((index == 0) ? L"data/rawdata/*.json" : mods[index-1]->mFullPath + L"rawdata/*.json", true, fileEntries);
+			for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+			{
+				RawDataFile& rawDataFile = vectorAdd(rawDataFiles);
+				rawDataFile.mPath = fileEntry.mPath;
+				rawDataFile.mFilename = fileEntry.mFilename;
+				rawDataFile.mIsModded = (index != 0);
+			}
+		}
+	}
+
+	// Parse the definitions and read the raw data files in parallel
+	workerPool.execute(rawDataFiles.size(), [&](size_t index)
 	{
-		const Json::Value root = JsonHelper::loadFile(fileEntry.mPath + fileEntry.mFilename);
+		RawDataFile& rawDataFile = rawDataFiles[index];
+		const Json::Value root = JsonHelper::loadFile(rawDataFile.mPath + rawDataFile.mFilename, rawDataFile.mErrors);
 
 		for (auto it = root.begin(); it != root.end(); ++it)
 		{
 			const Json::Value& entryJson = *it;
-			if (!entryJson.isObject())
+			if (!entryJson.isObject() || !entryJson["File"].isString())
 				continue;
 
-			RawData* rawData = nullptr;
-			if (entryJson["File"].isString())
-			{
-				const char* filename = entryJson["File"].asCString();
-				const uint64 key = rmx::getMurmur2_64(String(it.key().asCString()));
-				rawData = &mRawDataPool.createObject();
-				rawData->mIsModded = isModded;
-				if (!FTX::FileSystem->readFile(fileEntry.mPath + String(filename).toStdWString(), rawData->mContent))
-				{
-					mRawDataPool.destroyObject(*rawData);
-					continue;
-				}
-				mRawDataMap[key].push_back(rawData);
-			}
-
-			if (nullptr == rawData)
+			RawDataEntry entry;
+			entry.mKey = rmx::getMurmur2_64(String(it.key().asCString()));
+			if (!FTX::FileSystem->readFile(rawDataFile.mPath + String(entryJson["File"].asCString()).toStdWString(), entry.mContent))
 				continue;
 
 			// Check if it's a ROM injection
 			if (!entryJson["RomInject"].isNull())
 			{
-				rawData->mRomInjectAddress = (uint32)rmx::parseInteger(entryJson["RomInject"].asCString());
-				mRomInjections.emplace_back(rawData);
+				entry.mIsRomInjection = true;
+				entry.mRomInjectAddress = (uint32)rmx::parseInteger(entryJson["RomInject"].asCString());
+			}
+			rawDataFile.mEntries.emplace_back(std::move(entry));
+		}
+	});
+
+	// Add everything in the original order
+	for (RawDataFile& rawDataFile : rawDataFiles)
+	{
+		JsonHelper::showLoadErrors(rawDataFile.mPath + rawDataFile.mFilename, rawDataFile.mErrors);
+
+		for (RawDataEntry& entry : rawDataFile.mEntries)
+		{
+			RawData& rawData = mRawDataPool.createObject();
+			rawData.mContent.swap(entry.mContent);
+			rawData.mIsModded = rawDataFile.mIsModded;
+			mRawDataMap[entry.mKey].push_back(&rawData);
+
+			if (entry.mIsRomInjection)
+			{
+				rawData.mRomInjectAddress = entry.mRomInjectAddress;
+				mRomInjections.emplace_back(&rawData);
 			}
 		}
 	}
 }
 
-void ResourcesCache::loadPalettes(const std::wstring& path, bool isModded)
+void ResourcesCache::loadPalettes(WorkerPool& workerPool)
 {
-	// Load palettes from the given path
-	std::vector<rmx::FileIO::FileEntry> fileEntries;
-	fileEntries.reserve(8);
-	FTX::FileSystem->listFilesByMask(path + L"/*.png", true, fileEntries);
-	for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+	struct PaletteFile
 	{
-		if (!FTX::FileSystem->exists(fileEntry.mPath + fileEntry.mFilename))
-			continue;
+		std::wstring mPath;
+		std::wstring mFilename;
+		bool mIsModded = false;
+		bool mFound = false;
+		bool mLoaded = false;
+		Bitmap mBitmap;
+	};
+
+	// Collect the palette files, in the order they get applied
+	std::vector<PaletteFile> paletteFiles;
+	{
+		std::vector<rmx::FileIO::FileEntry> fileEntries;
+		fileEntries.reserve(8);
+		const std::vector<Mod*>& mods = ModManager::instance().getActiveMods();
+		for (size_t index = 0; index <= mods.size(); ++index)
+		{
+			fileEntries.clear();
+			FTX::FileSystem->listFilesByMask((index == 0) ? L"data/palettes/*.png" : mods[index-1]->mFullPath + L"palettes/*.png", true, fileEntries);
+			for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+			{
+				PaletteFile& paletteFile = vectorAdd(paletteFiles);
+				paletteFile.mPath = fileEntry.mPath;
+				paletteFile.mFilename = fileEntry.mFilename;
+				paletteFile.mIsModded = (index != 0);
+			}
+		}
+	}
 
+	// Decode the palette images in parallel
+	workerPool.execute(paletteFiles.size(), [&](size_t index)
+	{
+		PaletteFile& paletteFile = paletteFiles[index];
 		std::vector<uint8> content;
-		if (!FTX::FileSystem->readFile(fileEntry.mPath + fileEntry.mFilename, content))
+		if (!FTX::FileSystem->readFile(paletteFile.mPath + paletteFile.mFilename, content))
+			return;
+
+		paletteFile.mFound = true;
+		MemInputStream stream(content.data(), (int)content.size());
+		Bitmap::LoadResult loadResult;
+		paletteFile.mLoaded = paletteFile.mBitmap.decode(stream, loadResult, "png");
+	});
+
+	// Add the palettes in the original order, so that mods can overwrite palettes
+	for (const PaletteFile& paletteFile : paletteFiles)
+	{
+		if (!paletteFile.mFound)
 			continue;
 
-		Bitmap bitmap;
-		if (!bitmap.load(fileEntry.mPath + fileEntry.mFilename))
+		if (!paletteFile.mLoaded)
 		{
-			RMX_ERROR("Failed to load PNG at '" << *WString(fileEntry.mPath + fileEntry.mFilename).toString() << "'", );
+			RMX_ERROR("Failed to load PNG at '" << *WString(paletteFile.mPath + paletteFile.mFilename).toString() << "'", );
 			continue;
 		}
 
-		String name = WString(fileEntry.mFilename).toString();
+		const Bitmap& bitmap = paletteFile.mBitmap;
+		String name = WString(paletteFile.mFilename).toString();
 		name.remove(name.length() - 4, 4);
 
 		uint64 key = rmx::getMurmur2_64(name);		// Hash is the key of the first palette, the others are enumerated from there
@@ -402,7 +476,7 @@ void ResourcesCache::loadPalettes(const std::wstring& path, bool isModded)
 		for (int y = 0; y < numLines; ++y)
 		{
 			Palette& palette = mPalettes[key];
-			palette.mIsModded = isModded;
+			palette.mIsModded = paletteFile.mIsModded;
 			palette.mColors.resize(numColorsPerLine);
 
 			for (int x = 0; x < numColorsPerLine; ++x)
@@ -10,6 +10,8 @@
 
 #include "oxygen/application/GameProfile.h"
 
+class WorkerPool;
+
 
 class ResourcesCache : public SingleInstance<ResourcesCache>
 {
@@ -49,8 +51,8 @@ private:
 	bool checkRomContent();
 	void saveRomToAppData();
 
-	void loadRawData(const std::wstring& path, bool isModded);
-	void loadPalettes(const std::wstring& path, bool isModded);
+	void loadRawData(WorkerPool& workerPool);
+	void loadPalettes(WorkerPool& workerPool);
 
 private:
 	std::vector<uint8> mRom;	// This is the original, unmodified ROM (i.e. without any raw data injections or ROM writes)
@@ -15,6 +15,7 @@
 #include "oxygen/helper/JsonHelper.h"
 #include "oxygen/rendering/sprite/SpriteDump.h"
 #include "oxygen/rendering/utils/Kosinski.h"
+#include "oxygen/resources/BakedSpriteCache.h"
 #include "oxygen/simulation/EmulatorInterface.h"
 #include "oxygen/simulation/LemonScriptRuntime.h"
 
@@ -150,6 +151,174 @@ namespace
 		return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
 	}
 
+	struct SpriteDefinition
+	{
+		uint64 mKey = 0;
+		std::wstring mFilename;
+		Vec2i mCenter;
+		Recti mRect;
+		size_t mSheetIndex = 0;
+		bool mUsesComponentSprite = false;
+		const BakedSpriteCache* mBakedSpriteCache = nullptr;	// Only set for sprites loaded from a baked sprite cache
+		size_t mBakedSpriteIndex = 0;
+		SpriteBase* mSprite = nullptr;
+	};
+
+	struct SpriteDefinitionFile
+	{
+		size_t mPathIndex = 0;
+		std::wstring mPath;
+		std::wstring mFilename;
+		std::string mErrors;
+		std::vector<SpriteDefinition> mDefinitions;
+	};
+
+	struct SpriteSheet
+	{
+		std::wstring mFullPath;
+		bool mUsesComponentSprite = false;
+		size_t mNumUses = 0;		// Number of sprite definitions referring to this image file
+		size_t mLastPathIndex = (size_t)-1;
+		bool mLoaded = false;
+		PaletteBitmap mPaletteBitmap;
+		Bitmap mBitmap;
+	};
+
+	struct SpriteSource
+	{
+		std::vector<std::wstring> mDefinitionFilenames;
+		std::vector<size_t> mDefinitionFileIndices;
+		std::vector<size_t> mSheetIndices;
+		std::wstring mCacheFilename;
+		BakedSpriteCache mBakedSpriteCache;
+		bool mUseBakedSpriteCache = false;
+		bool mHasErrors = false;
+		std::vector<SpriteDefinition> mBakedDefinitions;
+	};
+
+	uint64 getSpriteKey(const String& identifier)
+	{
+		// Check if it's an hex identifier or a string
+		if (identifier.length() >= 3 && identifier[0] == '0' && identifier[1] == 'x')
+		{
+			bool isHex = true;
+			for (int i = 2; i < identifier.length(); ++i)
+			{
+				if (!isHexDigit(identifier[i]))
+				{
+					isHex = false;
+					break;
+				}
+			}
+			if (isHex)
+			{
+				const uint64 key = rmx::parseInteger(identifier);
+				if (key != 0)
+					return key;
+			}
+		}
+		return rmx::getMurmur2_64(identifier);
+	}
+
+	void readSpriteDefinitions(const Json::Value& spritesJson, std::vector<SpriteDefinition>& outDefinitions)
+	{
+		for (auto iterator = spritesJson.begin(); iterator != spritesJson.end(); ++iterator)
+		{
+			SpriteDefinition definition;
+			definition.mKey = getSpriteKey(String(iterator.key().asString()));
+
+			for (auto it = iterator->begin(); it != iterator->end(); ++it)
+			{
+				if (it.key().asString() == "File" && !it->asString().empty())
+				{
+					definition.mFilename = *String(it->asString()).toWString();
+				}
+				else if (it.key().asString() == "Center" && !it->asString().empty())
+				{
+					std::vector<String> parts;
+					String(it->asString()).split(parts, ',');
+					if (parts.size() == 2)
+					{
+						definition.mCenter.x = parts[0].parseInt();
+						definition.mCenter.y = parts[1].parseInt();
+					}
+				}
+				else if (it.key().asString() == "Rect" && !it->asString().empty())
+				{
+					std::vector<String> parts;
+					String(it->asString()).split(parts, ',');
+					if (parts.size() == 4)
+					{
+						definition.mRect.x = parts[0].parseInt();
+						definition.mRect.y = parts[1].parseInt();
+						definition.mRect.width = parts[2].parseInt();
+						definition.mRect.height = parts[3].parseInt();
+					}
+				}
+			}
+
+			if (!definition.mFilename.empty())
+			{
+				outDefinitions.emplace_back(std::move(definition));
+			}
+		}
+	}
+
+	void createSprite(SpriteDefinition& definition, SpriteSheet& sheet)
+	{
+		// Part of a sprite sheet?
+		const bool isPartOfSheet = (definition.mRect.width != 0);
+
+		// The image can be moved into the sprite if no other sprite uses it
+		const bool isExclusive = (!isPartOfSheet && sheet.mNumUses == 1);
+
+		if (!sheet.mUsesComponentSprite)
+		{
+			// Palette sprite (= 8-bit palette sprite)
+			PaletteSprite* sprite = new PaletteSprite();
+			definition.mSprite = sprite;
+
+			if (sheet.mLoaded)
+			{
+				if (isPartOfSheet)
+				{
+					sprite->createFromBitmap(sheet.mPaletteBitmap, definition.mRect, -definition.mCenter);
+				}
+				else if (isExclusive)
+				{
+					sprite->createFromBitmap(std::move(sheet.mPaletteBitmap), -definition.mCenter);
+				}
+				else
+				{
+					sprite->createFromBitmap(sheet.mPaletteBitmap, -definition.mCenter);
+				}
+			}
+		}
+		else
+		{
+			// Component sprite (= 32-bit RGBA sprite)
+			ComponentSprite* sprite = new ComponentSprite();
+			definition.mSprite = sprite;
+
+			if (sheet.mLoaded)
+			{
+				if (isPartOfSheet)
+				{
+					sprite->accessBitmap().copy(sheet.mBitmap, definition.mRect);
+				}
+				else if (isExclusive)
+				{
+					sprite->accessBitmap().swap(sheet.mBitmap);
+				}
+				else
+				{
+					sprite->accessBitmap().copy(sheet.mBitmap);
+				}
+			}
+			sprite->mOffset = -definition.mCenter;
+		}
+	}
+
 }
 
 
@@ -171,6 +340,7 @@ SpriteCache::~SpriteCache()
 
 void SpriteCache::clear()
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	// Delete the sprite instances
 	for (auto& pair : mCachedSprites)
 	{
@@ -183,20 +353,35 @@ void SpriteCache::clear()
 void SpriteCache::loadAllSpriteDefinitions()
 {
 	// Load or reload from all mods
-	loadSpriteDefinitions(L"data/sprites");
+	std::vector<std::wstring> paths;
+	paths.emplace_back(L"data/sprites");
 	for (const Mod* mod : ModManager::instance().getActiveMods())
 	{
-		loadSpriteDefinitions(mod->mFullPath + L"sprites");
+		paths.emplace_back(mod->mFullPath + L"sprites");
+	}
+	loadSpriteDefinitions(paths);
+
+	// Clean up baked caches of mods that are not installed any more, but keep those of inactive mods
+	if (!Configuration::instance().mAppDataPath.empty())
+	{
+		paths.resize(1);
+		for (const Mod* mod : ModManager::instance().getAllMods())
+		{
+			paths.emplace_back(mod->mFullPath + L"sprites");
+		}
+		BakedSpriteCache::removeUnusedCacheFiles(paths);
 	}
 }
 
 bool SpriteCache::hasSprite(uint64 key) const
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	return (mCachedSprites.count(key) != 0);
 }
 
 const SpriteCache::CacheItem* SpriteCache::getSprite(uint64 key)
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	CacheItem* item = mapFind(mCachedSprites, key);
 	if (nullptr != item)
 	{
@@ -228,6 +413,7 @@ const SpriteCache::CacheItem* SpriteCache::getSprite(uint64 key)
 
 SpriteCache::CacheItem& SpriteCache::getOrCreatePaletteSprite(uint64 key)
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	CacheItem* item = mapFind(mCachedSprites, key);
 	if (nullptr != item)
 	{
@@ -244,6 +430,7 @@ SpriteCache::CacheItem& SpriteCache::getOrCreatePaletteSprite(uint64 key)
 
 SpriteCache::CacheItem& SpriteCache::getOrCreateComponentSprite(uint64 key)
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	CacheItem* item = mapFind(mCachedSprites, key);
 	if (nullptr != item)
 	{
@@ -262,6 +449,7 @@ uint64 SpriteCache::setupSpriteFromROM(uint32 patternsBaseAddress, uint32 tableA
 {
 	const uint64 key = (((uint64)patternsBaseAddress) << 42) ^ (((uint64)tableAddress) << 25) ^ (((uint64)mappingOffset) << 8) ^ (uint64)animationSprite;
 
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	CacheItem* item = mapFind(mCachedSprites, key);
 	if (nullptr == item)
 	{
@@ -284,6 +472,7 @@ uint64 SpriteCache::setupSpriteFromROM(uint32 patternsBaseAddress, uint32 tableA
 
 void SpriteCache::clearRedirect(uint64 sourceKey)
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	CacheItem* source = mapFind(mCachedSprites, sourceKey);
 	if (nullptr != source)
 	{
@@ -293,6 +482,7 @@ void SpriteCache::clearRedirect(uint64 sourceKey)
 
 void SpriteCache::setupRedirect(uint64 sourceKey, uint64 targetKey)
 {
+	std::lock_guard<std::recursive_mutex> lock(mMutex);
 	CacheItem* source = mapFind(mCachedSprites, sourceKey);
 	if (nullptr == source)
 	{
@@ -341,179 +531,224 @@ SpriteCache::CacheItem& SpriteCache::createCacheItem(uint64 key)
 	return item;
 }
 
-void SpriteCache::loadSpriteDefinitions(const std::wstring& path)
+void SpriteCache::loadSpriteDefinitions(const std::vector<std::wstring>& paths)
 {
-	struct SheetCache
+	// Collect all sprite definition files, in the order they get applied
+	std::vector<SpriteSource> sources(paths.size());
+	std::vector<SpriteDefinitionFile> definitionFiles;
 	{
-		std::map<std::wstring, PaletteBitmap> mPaletteSpriteSheets;
-		std::map<std::wstring, Bitmap> mComponentSpriteSheets;
-	};
-	SheetCache sheetCache;
+		std::vector<rmx::FileIO::FileEntry> fileEntries;
+		fileEntries.reserve(8);
+		for (size_t pathIndex = 0; pathIndex < paths.size(); ++pathIndex)
+		{
+			fileEntries.clear();
+			FTX::FileSystem->listFilesByMask(paths[pathIndex] + L"/*.json", true, fileEntries);
+			for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+			{
+				sources[pathIndex].mDefinitionFilenames.push_back(fileEntry.mPath + fileEntry.mFilename);
+				sources[pathIndex].mDefinitionFileIndices.push_back(definitionFiles.size());
 
-	std::vector<rmx::FileIO::FileEntry> fileEntries;
-	fileEntries.reserve(8);
-	FTX::FileSystem->listFilesByMask(path + L"/*.json", true, fileEntries);
-	if (fileEntries.empty())
+				SpriteDefinitionFile& definitionFile = vectorAdd(definitionFiles);
+				definitionFile.mPathIndex = pathIndex;
+				definitionFile.mPath = fileEntry.mPath;
+				definitionFile.mFilename = fileEntry.mFilename;
+			}
+		}
+	}
+	if (definitionFiles.empty())
 		return;
 
-	++mGlobalChangeCounter;
-	for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+	WorkerPool workerPool(WorkerPool::getDefaultNumWorkerThreads());
+
+	// Check which sources can use their baked sprite cache, as none of their files changed
+	const bool useBakedSpriteCaches = !Configuration::instance().mAppDataPath.empty();
+	if (useBakedSpriteCaches)
 	{
-		const Json::Value spritesJson = JsonHelper::loadFile(fileEntry.mPath + fileEntry.mFilename);
-		for (auto iterator = spritesJson.begin(); iterator != spritesJson.end(); ++iterator)
+		workerPool.execute(sources.size(), [&](size_t index)
 		{
-			const String identifier(iterator.key().asString());
-			uint64 key = 0;
-			{
-				// Check if it's an hex identifier or a string
-				if (identifier.length() >= 3 && identifier[0] == '0' && identifier[1] == 'x')
-				{
-					bool isHex = true;
-					for (int i = 2; i < identifier.length(); ++i)
-					{
-						if (!isHexDigit(identifier[i]))
-						{
-							isHex = false;
-							break;
-						}
-					}
-					if (isHex)
-					{
-						key = rmx::parseInteger(identifier);
-					}
-				}
+			SpriteSource& source = sources[index];
+			if (source.mDefinitionFilenames.empty())
+				return;
 
-				if (key == 0)
+			source.mCacheFilename = BakedSpriteCache::getCacheFilename(paths[index]);
+			source.mUseBakedSpriteCache = source.mBakedSpriteCache.load(source.mCacheFilename, source.mDefinitionFilenames);
+			if (source.mUseBakedSpriteCache)
+			{
+				source.mBakedDefinitions.resize(source.mBakedSpriteCache.getNumSprites());
+				for (size_t k = 0; k < source.mBakedDefinitions.size(); ++k)
 				{
-					key = rmx::getMurmur2_64(identifier);
+					SpriteDefinition& definition = source.mBakedDefinitions[k];
+					definition.mKey = source.mBakedSpriteCache.getSprite(k).mKey;
+					definition.mUsesComponentSprite = (source.mBakedSpriteCache.getSprite(k).mUsesComponentSprite != 0);
+					definition.mBakedSpriteCache = &source.mBakedSpriteCache;
+					definition.mBakedSpriteIndex = k;
 				}
 			}
+		});
+	}
 
-			std::wstring filename;
-			Vec2i center;
-			Recti rect;
+	// Read and parse the definition files in parallel
+	workerPool.execute(definitionFiles.size(), [&](size_t index)
+	{
+		SpriteDefinitionFile& definitionFile = definitionFiles[index];
+		if (sources[definitionFile.mPathIndex].mUseBakedSpriteCache)
+			return;
+
+		const Json::Value spritesJson = JsonHelper::loadFile(definitionFile.mPath + definitionFile.mFilename, definitionFile.mErrors);
+		readSpriteDefinitions(spritesJson, definitionFile.mDefinitions);
+	});
+
+	// Gather the image files to load
+	//  -> Each one gets decoded only once, even if it's used as a sprite sheet by multiple definition files
+	std::vector<SpriteSheet> sheets;
+	std::vector<SpriteDefinition*> definitions;
+	{
+		std::unordered_map<std::wstring, size_t> sheetIndices;
+		for (SpriteDefinitionFile& definitionFile : definitionFiles)
+		{
+			SpriteSource& source = sources[definitionFile.mPathIndex];
+			if (!definitionFile.mErrors.empty())
+			{
+				JsonHelper::showLoadErrors(definitionFile.mPath + definitionFile.mFilename, definitionFile.mErrors);
+				source.mHasErrors = true;
+			}
 
-			for (auto it = iterator->begin(); it != iterator->end(); ++it)
+			for (SpriteDefinition& definition : definitionFile.mDefinitions)
 			{
-				if (it.key().asString() == "File" && !it->asString().empty())
+				const std::wstring fullpath = definitionFile.mPath + definition.mFilename;
+				const auto pair = sheetIndices.emplace(fullpath, sheets.size());
+				if (pair.second)
 				{
-					filename = *String(it->asString()).toWString();
+					SpriteSheet& sheet = vectorAdd(sheets);
+					sheet.mFullPath = fullpath;
+					sheet.mUsesComponentSprite = WString(definition.mFilename).endsWith(L".png");		// Palette or RGBA?
 				}
-				else if (it.key().asString() == "Center" && !it->asString().empty())
-				{
-					std::vector<String> parts;
-					String(it->asString()).split(parts, ',');
-					if (parts.size() == 2)
-					{
-						center.x = parts[0].parseInt();
-						center.y = parts[1].parseInt();
-					}
-				}
-				else if (it.key().asString() == "Rect" && !it->asString().empty())
+
+				definition.mSheetIndex = pair.first->second;
+				SpriteSheet& sheet = sheets[definition.mSheetIndex];
+				definition.mUsesComponentSprite = sheet.mUsesComponentSprite;
+				++sheet.mNumUses;
+				if (sheet.mLastPathIndex != definitionFile.mPathIndex)
 				{
-					std::vector<String> parts;
-					String(it->asString()).split(parts, ',');
-					if (parts.size() == 4)
-					{
-						rect.x = parts[0].parseInt();
-						rect.y = parts[1].parseInt();
-						rect.width = parts[2].parseInt();
-						rect.height = parts[3].parseInt();
-					}
+					sheet.mLastPathIndex = definitionFile.mPathIndex;
+					source.mSheetIndices.push_back(definition.mSheetIndex);
 				}
+				definitions.push_back(&definition);
 			}
+		}
 
-			if (!filename.empty())
+		for (SpriteSource& source : sources)
+		{
+			for (SpriteDefinition& definition : source.mBakedDefinitions)
 			{
-				// Check for overloading
-				{
-					const auto it = mCachedSprites.find(key);
-					if (it != mCachedSprites.end())
-					{
-						// This sprite got overloaded e.g. by a mod -- remove the old version
-						SAFE_DELETE(it->second.mSprite);
-					}
-				}
+				definitions.push_back(&definition);
+			}
+		}
+	}
 
-				CacheItem& item = createCacheItem(key);
-				const std::wstring fullpath = fileEntry.mPath + filename;
+	// Decode the images in parallel
+	workerPool.execute(sheets.size(), [&](size_t index)
+	{
+		SpriteSheet& sheet = sheets[index];
+		if (sheet.mUsesComponentSprite)
+		{
+			sheet.mLoaded = FileHelper::loadBitmap(sheet.mBitmap, sheet.mFullPath, false);
+		}
+		else
+		{
+			sheet.mLoaded = FileHelper::loadPaletteBitmap(sheet.mPaletteBitmap, sheet.mFullPath, false);
+		}
+	});
 
-				// Palette or RGBA?
-				item.mUsesComponentSprite = WString(filename).endsWith(L".png");
+	for (const SpriteSheet& sheet : sheets)
+	{
+		RMX_CHECK(sheet.mLoaded, "Failed to load image file '" << *WString(sheet.mFullPath).toString() << "'", );
+	}
 
-				// Part of a sprite sheet?
-				const bool isPartOfSheet = (rect.width != 0);
+	// Create the sprites in parallel as well
+	workerPool.execute(definitions.size(), [&](size_t index)
+	{
+		SpriteDefinition& definition = *definitions[index];
+		if (nullptr != definition.mBakedSpriteCache)
+		{
+			definition.mSprite = definition.mBakedSpriteCache->createSprite(definition.mBakedSpriteIndex);
+		}
+		else
+		{
+			createSprite(definition, sheets[definition.mSheetIndex]);
+		}
+	});
 
-				bool success = false;
-				if (!item.mUsesComponentSprite)
-				{
-					// Load palette sprite (= 8-bit palette sprite)
-					PaletteSprite* sprite = new PaletteSprite();
-					item.mSprite = sprite;
+	// Update the baked sprite caches that were outdated, unless there were errors
+	//  -> This has to happen before adding the sprites to the cache, as overloaded sprites get deleted there
+	if (useBakedSpriteCaches)
+	{
+		for (SpriteSource& source : sources)
+		{
+			source.mBakedSpriteCache.clear();
+			if (source.mDefinitionFilenames.empty() || source.mUseBakedSpriteCache)
+				continue;
 
-					if (isPartOfSheet)
-					{
-						PaletteBitmap* bitmap = nullptr;
-						const auto it = sheetCache.mPaletteSpriteSheets.find(fullpath);
-						if (it == sheetCache.mPaletteSpriteSheets.end())
-						{
-							bitmap = &sheetCache.mPaletteSpriteSheets[fullpath];
-							success = FileHelper::loadPaletteBitmap(*bitmap, fullpath);
-						}
-						else
-						{
-							bitmap = &it->second;
-							success = true;
-						}
-
-						if (success)
-						{
-							sprite->createFromBitmap(*bitmap, rect, -center);
-						}
-					}
-					else
-					{
-						PaletteBitmap bitmap;
-						success = FileHelper::loadPaletteBitmap(bitmap, fullpath);
-						if (success)
-						{
-							static_cast<PaletteSprite*>(item.mSprite)->createFromBitmap(std::move(bitmap), -center);
-						}
-					}
-				}
-				else
+			std::vector<std::wstring> imageFiles;
+			for (size_t sheetIndex : source.mSheetIndices)
+			{
+				source.mHasErrors |= !sheets[sheetIndex].mLoaded;
+				imageFiles.push_back(sheets[sheetIndex].mFullPath);
+			}
+			if (source.mHasErrors)
+				continue;
+
+			std::vector<BakedSpriteCache::SpriteInput> spriteInputs;
+			for (size_t fileIndex : source.mDefinitionFileIndices)
+			{
+				for (const SpriteDefinition& definition : definitionFiles[fileIndex].mDefinitions)
 				{
-					// Load component sprite (= 32-bit RGBA sprite)
-					ComponentSprite* sprite = new ComponentSprite();
-					item.mSprite = sprite;
+					BakedSpriteCache::SpriteInput& input = vectorAdd(spriteInputs);
+					input.mKey = definition.mKey;
+					input.mSprite = definition.mSprite;
+					input.mUsesComponentSprite = definition.mUsesComponentSprite;
+				}
+			}
+			BakedSpriteCache::save(source.mCacheFilename, source.mDefinitionFilenames, imageFiles, spriteInputs);
+		}
+	}
 
-					if (isPartOfSheet)
-					{
-						Bitmap* bitmap = nullptr;
-						const auto it = sheetCache.mComponentSpriteSheets.find(fullpath);
-						if (it == sheetCache.mComponentSpriteSheets.end())
-						{
-							bitmap = &sheetCache.mComponentSpriteSheets[fullpath];
-							success = FileHelper::loadBitmap(*bitmap, fullpath);
-						}
-						else
-						{
-							bitmap = &it->second;
-							success = true;
-						}
-
-						if (success)
-						{
-							sprite->accessBitmap().copy(*bitmap, rect);
-						}
-					}
-					else
-					{
-						success = FileHelper::loadBitmap(static_cast<ComponentSprite*>(item.mSprite)->accessBitmap(), fullpath);
-					}
-					item.mSprite->mOffset = -center;
+	// Add the sprites to the cache, in the same order as the definitions were loaded
+	for (SpriteSource& source : sources)
+	{
+		if (source.mDefinitionFilenames.empty())
+			continue;
+
+		++mGlobalChangeCounter;
+		const auto addSprite = [&](const SpriteDefinition& definition)
+		{
+			// Check for overloading
+			{
+				const auto it = mCachedSprites.find(definition.mKey);
+				if (it != mCachedSprites.end())
+				{
+					// This sprite got overloaded e.g. by a mod -- remove the old version
+					SAFE_DELETE(it->second.mSprite);
 				}
 			}
+
+			CacheItem& item = createCacheItem(definition.mKey);
+			item.mUsesComponentSprite = definition.mUsesComponentSprite;
+			item.mSprite = definition.mSprite;
+		};
+
+		if (source.mUseBakedSpriteCache)
+		{
+			for (const SpriteDefinition& definition : source.mBakedDefinitions)
+				addSprite(definition);
+		}
+		else
+		{
+			for (size_t fileIndex : source.mDefinitionFileIndices)
+			{
+				for (const SpriteDefinition& definition : definitionFiles[fileIndex].mDefinitions)
+					addSprite(definition);
+			}
 		}
 	}
 }
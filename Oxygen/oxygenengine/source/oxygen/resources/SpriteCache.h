@@ -60,10 +60,11 @@ public:
 
 private:
 	CacheItem& createCacheItem(uint64 key);
-	void loadSpriteDefinitions(const std::wstring& path);
+	void loadSpriteDefinitions(const std::vector<std::wstring>& paths);
 
 private:
 	std::unordered_map<uint64, CacheItem> mCachedSprites;
+	mutable std::recursive_mutex mMutex;	// Script bindings may access the cache from additional simulation contexts on other threads
 	SpriteDump* mSpriteDump = nullptr;
 	uint32 mGlobalChangeCounter = 0;
 };
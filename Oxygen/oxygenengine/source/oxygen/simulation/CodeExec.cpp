@@ -210,11 +210,22 @@ CodeExec::CodeExec() :
 	}
 }
 
+CodeExec::CodeExec(LemonScriptProgram& sharedProgram) :
+	mLemonScriptProgram(sharedProgram),
+	mEmulatorInterface(*new EmulatorInterface()),
+	mLemonScriptRuntime(*new LemonScriptRuntime(mLemonScriptProgram, mEmulatorInterface)),
+	mOwnsLemonScriptProgram(false)
+{
+	// The shared program is expected to be loaded already, and never gets reloaded from here
+	mLemonScriptRuntime.onProgramUpdated();
+}
+
 CodeExec::~CodeExec()
 {
 	delete &mEmulatorInterface;
 	delete &mLemonScriptRuntime;
-	delete &mLemonScriptProgram;
+	if (mOwnsLemonScriptProgram)
+		delete &mLemonScriptProgram;
 }
 
 void CodeExec::startup()
@@ -278,7 +289,8 @@ bool CodeExec::reloadScripts(bool enforceFullReload, bool retainRuntimeState)
 	const LemonScriptProgram::LoadScriptsResult result = mLemonScriptProgram.loadScripts(mainScriptPath.toStdString(), options);
 	if (result == LemonScriptProgram::LoadScriptsResult::PROGRAM_CHANGED)
 	{
-		mLemonScriptRuntime.onProgramUpdated();
+		// Unchanged functions keep their runtime opcodes, which also keeps their program counters in the retained call stack valid
+		mLemonScriptRuntime.onProgramUpdated(true);
 	}
 	cleanScriptDebug();
 
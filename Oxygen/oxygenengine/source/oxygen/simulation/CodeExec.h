@@ -118,6 +118,7 @@ public:
 
 public:
 	CodeExec();
+	explicit CodeExec(LemonScriptProgram& sharedProgram);	// For additional simulations running the program of the main simulation
 	~CodeExec();
 
 	void startup();
@@ -189,6 +190,7 @@ private:
 	LemonScriptProgram& mLemonScriptProgram;	// Move instance to Simulation?
 	EmulatorInterface&  mEmulatorInterface;
 	LemonScriptRuntime& mLemonScriptRuntime;
+	bool mOwnsLemonScriptProgram = true;
 	bool mIsDeveloperMode = false;
 
 	ExecutionState mExecutionState = ExecutionState::INACTIVE;
@@ -215,5 +217,5 @@ private:
 	RentableObjectPool<VRAMWrite, 32> mVRAMWritePool;
 
 private:
-	static inline CodeExec* mActiveInstance = nullptr;
+	static inline thread_local CodeExec* mActiveInstance = nullptr;
 };
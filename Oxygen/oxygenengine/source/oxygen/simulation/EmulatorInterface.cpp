@@ -15,6 +15,8 @@
 
 namespace emulatorinterface
 {
+	static const constexpr uint32 MIN_DIRTY_PAGE_SIZE = 0x40;
+	static const constexpr uint32 MAX_DIRTY_PAGE_SIZE = 0x4000;
 
 	struct Internal
 	{
@@ -27,6 +29,11 @@ namespace emulatorinterface
 		uint16 mVSRam[0x40] = { 0 };			// Buffer for vertical scroll offsets
 		uint8 mSharedMemory[0x100000] = { 0 };	// 1 MB of additional shared memory between script and C++ (usage similar to RAM, but not used by original code, obviously)
 		uint64 mSharedMemoryUsage = 0;			// Each bit represents 16 KB of shared memory and tells us if anything non-zero is written there at all
+		uint8 mRamDirtyPages[0x10000 / MIN_DIRTY_PAGE_SIZE] = { 0 };				// One byte per page of RAM, set to 1 if the page got written
+		uint8 mSharedMemoryDirtyPages[0x100000 / MIN_DIRTY_PAGE_SIZE] = { 0 };	// One byte per page of shared memory, set to 1 if the page got written
+		uint32 mDirtyPageShift = 8;				// Page size is 256 bytes by default
+		bool mDirtyPageTracking = false;		// Dirty page flags are only updated if this is set
+		bool mDirtyFlagPointersGiven = false;	// Set once runtime opcodes got pointers into the dirty page flags, which rely on the current tracking setup
 		std::vector<uint8> mSRam;				// Persistent memory to be saved on disk
 		uint32 mRegisters[16] = { 0 };			// Registers
 		bool mFlagZ = false;					// Zero flag
@@ -52,6 +59,7 @@ namespace emulatorinterface
 			mVRamChangeBits.setAllBits();		// Count all VRAM as changed
 			memset(mSharedMemory, 0, sizeof(mSharedMemory));
 			mSharedMemoryUsage = 0;
+			setAllPagesDirty();
 			memset(mRegisters, 0, sizeof(mRegisters));
 			mRegisters[15] = GameProfile::instance().mAsmStackRange.second;   // Initialization of A7 (just leaving it 0 is no good idea)
 		}
@@ -61,6 +69,22 @@ namespace emulatorinterface
 			ResourcesCache::instance().applyRomInjections(mRom, sizeof(mRom));
 		}
 
+		void setAllPagesDirty()
+		{
+			memset(mRamDirtyPages, 1, sizeof(mRamDirtyPages));
+			memset(mSharedMemoryDirtyPages, 1, sizeof(mSharedMemoryDirtyPages));
+		}
+
+		FORCE_INLINE void markPagesDirty(uint8* dirtyPages, uint32 address, uint32 size)
+		{
+			const uint32 firstPage = address >> mDirtyPageShift;
+			const uint32 lastPage = (address + size - 1) >> mDirtyPageShift;
+			for (uint32 page = firstPage; page <= lastPage; ++page)
+			{
+				dirtyPages[page] = 1;
+			}
+		}
+
 		FORCE_INLINE bool isValidMemoryRegion(uint32 address, uint32 size)
 		{
 			address &= 0x00ffffff;
@@ -94,6 +118,8 @@ namespace emulatorinterface
 					checkWatches(address, size);
 				address &= 0x00ffff;
 				RMX_CHECK(address + size <= sizeof(mRam), "Too large memory " << (MODE == MEMORY_MODE_READ ? "read" : "write") << " access of " << rmx::hexString(size) << " bytes at RAM address " << rmx::hexString(0xffff0000 + address), RMX_REACT_THROW);
+				if (MODE != MEMORY_MODE_READ && mDirtyPageTracking)
+					markPagesDirty(mRamDirtyPages, address, size);
 				return &mRam[address];
 			}
 			else if (address < 0x400000)
@@ -113,6 +139,8 @@ namespace emulatorinterface
 						mSharedMemoryUsage |= (1ull << uint64(address >> 14));
 					else
 						mSharedMemoryUsage |= (3ull << uint64(address >> 14));	// Assmuming size is smaller than 16 KB
+					if (mDirtyPageTracking)
+						markPagesDirty(mSharedMemoryDirtyPages, address, size);
 				}
 				return &mSharedMemory[address];
 			}
@@ -209,6 +237,55 @@ void EmulatorInterface::clearSharedMemory()
 {
 	memset(mInternal.mSharedMemory, 0, sizeof(mInternal.mSharedMemory));
 	mInternal.mSharedMemoryUsage = 0;
+	memset(mInternal.mSharedMemoryDirtyPages, 1, sizeof(mInternal.mSharedMemoryDirtyPages));
+}
+
+bool EmulatorInterface::isDirtyPageTrackingEnabled()
+{
+	return mInternal.mDirtyPageTracking;
+}
+
+void EmulatorInterface::setDirtyPageTrackingEnabled(bool enable)
+{
+	RMX_ASSERT(!mInternal.mDirtyFlagPointersGiven || enable == mInternal.mDirtyPageTracking, "Dirty page tracking can't be toggled after runtime functions got built");
+	mInternal.mDirtyPageTracking = enable;
+	mInternal.setAllPagesDirty();
+}
+
+uint32 EmulatorInterface::getDirtyPageSize()
+{
+	return 1 << mInternal.mDirtyPageShift;
+}
+
+void EmulatorInterface::setDirtyPageSize(uint32 pageSize)
+{
+	RMX_CHECK(pageSize >= emulatorinterface::MIN_DIRTY_PAGE_SIZE && pageSize <= emulatorinterface::MAX_DIRTY_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0, "Invalid dirty page size " << pageSize, return);
+	RMX_ASSERT(!mInternal.mDirtyFlagPointersGiven || pageSize == getDirtyPageSize(), "Dirty page size can't be changed after runtime functions got built");
+	mInternal.mDirtyPageShift = 0;
+	while ((1u << mInternal.mDirtyPageShift) < pageSize)
+		++mInternal.mDirtyPageShift;
+	mInternal.setAllPagesDirty();
+}
+
+const uint8* EmulatorInterface::getRamDirtyPages()
+{
+	return mInternal.mRamDirtyPages;
+}
+
+const uint8* EmulatorInterface::getSharedMemoryDirtyPages()
+{
+	return mInternal.mSharedMemoryDirtyPages;
+}
+
+void EmulatorInterface::setAllPagesDirty()
+{
+	mInternal.setAllPagesDirty();
+}
+
+void EmulatorInterface::clearDirtyPages()
+{
+	memset(mInternal.mRamDirtyPages, 0, sizeof(mInternal.mRamDirtyPages));
+	memset(mInternal.mSharedMemoryDirtyPages, 0, sizeof(mInternal.mSharedMemoryDirtyPages));
 }
 
 bool EmulatorInterface::isValidMemoryRegion(uint32 address, uint32 size)
@@ -449,6 +526,18 @@ void EmulatorInterface::getDirectAccessSpecialization(SpecializationResult& outR
 		}
 		else
 		{
+			if (writeAccess && mInternal.mDirtyPageTracking)
+			{
+				// Direct write access can only mark a single page, so leave writes crossing a page boundary to the generic path
+				const uint32 firstPage = (uint32)address >> mInternal.mDirtyPageShift;
+				if (firstPage != ((uint32)(address + size - 1) >> mInternal.mDirtyPageShift))
+				{
+					outResult.mResult = SpecializationResult::NO_SPECIALIZATION;
+					return;
+				}
+				outResult.mDirtyFlagPointer = &mInternal.mRamDirtyPages[firstPage];
+				mInternal.mDirtyFlagPointersGiven = true;
+			}
 			outResult.mResult = SpecializationResult::HAS_SPECIALIZATION;
 			outResult.mDirectAccessPointer = &mInternal.mRam[address];
 		}
@@ -18,7 +18,7 @@ namespace emulatorinterface
 }
 
 
-class EmulatorInterface : public SingleInstance<EmulatorInterface>, public lemon::MemoryAccessHandler
+class EmulatorInterface : public ThreadLocalInstance<EmulatorInterface>, public lemon::MemoryAccessHandler
 {
 public:
 	enum class Register
@@ -54,6 +54,19 @@ public:
 	uint64 getSharedMemoryUsage();
 	void   clearSharedMemory();
 
+	// Dirty page tracking for RAM and shared memory
+	//  -> Each page has one byte that is set to 1 on write access (including direct write access of runtime opcodes), and only reset by "clearDirtyPages"
+	//  -> Direct write access is only handed out for writes inside a single page, so writes crossing a page boundary mark both pages
+	//  -> Tracking is disabled by default; both the enabled state and the page size have to be set before any runtime functions get built, as these can store pointers into the dirty page flags (changing them later asserts)
+	bool isDirtyPageTrackingEnabled();
+	void setDirtyPageTrackingEnabled(bool enable);
+	uint32 getDirtyPageSize();
+	void setDirtyPageSize(uint32 pageSize);
+	const uint8* getRamDirtyPages();			// One entry per page of the 64 KB RAM
+	const uint8* getSharedMemoryDirtyPages();	// One entry per page of the 1 MB shared memory
+	void setAllPagesDirty();
+	void clearDirtyPages();
+
 	// General memory access
 	bool isValidMemoryRegion(uint32 address, uint32 size);
 	virtual uint8* getMemoryPointer(uint32 address, bool writeAccess, uint32 size);
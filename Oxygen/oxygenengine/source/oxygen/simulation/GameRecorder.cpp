@@ -10,66 +10,148 @@
 #include "oxygen/simulation/GameRecorder.h"
 #include "oxygen/simulation/LogDisplay.h"
 #include "oxygen/application/EngineMain.h"
+#include "oxygen/helper/BitStream.h"
 #include "oxygen/helper/FileHelper.h"
 
 
+namespace
+{
+	// Version history
+	//  - 0: Keyframes compressed with own deflate implementation
+	//  - 1: Keyframes compressed with zlib
+	//  - 2: Keyframe index, bit-packed input changes, and keyframes stored as differences to the previous one
+	static const constexpr int GAMERECORDING_FORMATVERSION = 2;
+
+	// In format version 2, every n-th keyframe is stored in full, the others as differences
+	//  -> This limits the number of keyframes to decode for random access
+	static const constexpr size_t FULL_KEYFRAME_INTERVAL = 5;
+
+	// Frame types of format versions 0 and 1
+	static const constexpr uint8 FRAMETYPE_INPUT_ONLY = 0;
+	static const constexpr uint8 FRAMETYPE_KEYFRAME = 1;
+
+	void writeBits(Bitstream& bitstream, uint16 value)
+	{
+		for (int bit = 0; bit < 16; ++bit)
+			bitstream.write(((value >> bit) & 1) != 0);
+	}
+
+	uint16 readBits(Bitstream& bitstream)
+	{
+		uint16 value = 0;
+		for (int bit = 0; bit < 16; ++bit)
+		{
+			if (bitstream.read())
+				value |= (1 << bit);
+		}
+		return value;
+	}
+}
+
+
 void GameRecorder::clear()
 {
-	mFrames.clear();
-	mFrameNoDataPool.clear();
-	mFrameWithDataPool.clear();
+	mInputs.clear();
+	mKeyframes.clear();
+	mFileData.clear();
 	mPlaybackPosition = -1;
 	mRangeStart = 0;
 	mRangeEnd = 0;
+	mPlaybackData.clear();
+	mPlaybackDataIndex = INVALID_INDEX;
 }
 
 void GameRecorder::addFrame(const uint16* inputs)
 {
-	RMX_CHECK(!mFrames.empty(), "First frame must be a keyframe", );
-	addFrameInternal(inputs, Frame::Type::INPUT_ONLY);
+	RMX_CHECK(!mKeyframes.empty(), "First frame must be a keyframe", );
+	mInputs.push_back(inputs[0]);
+	mInputs.push_back(inputs[1]);
+	++mRangeEnd;
 }
 
 void GameRecorder::addKeyFrame(const uint16* inputs, const std::vector<uint8>& data)
 {
-	Frame& frame = addFrameInternal(inputs, Frame::Type::KEYFRAME);
-	frame.mType = Frame::Type::KEYFRAME;
-	frame.mData = data;
+	Keyframe& keyframe = vectorAdd(mKeyframes);
+	keyframe.mNumber = mRangeEnd;
+	keyframe.mData = data;
+	keyframe.mStateSize = (uint32)data.size();
+
+	mInputs.push_back(inputs[0]);
+	mInputs.push_back(inputs[1]);
+	++mRangeEnd;
 }
 
 void GameRecorder::discardOldFrames(uint32 minKeepNumber)
 {
-	size_t firstIndexToKeep = 0;
-	for (size_t index = 0; index < mFrames.size(); ++index)
+	// Go back to the last keyframe, as we can't keep dependent frames whose keyframes get discarded
+	const uint32 firstNumberToKeep = (mRangeEnd > minKeepNumber) ? (mRangeEnd - minKeepNumber) : 0;
+	size_t firstKeyframeToKeep = 0;
+	while (firstKeyframeToKeep + 1 < mKeyframes.size() && mKeyframes[firstKeyframeToKeep + 1].mNumber <= firstNumberToKeep)
 	{
-		if (mFrames[index]->mNumber >= mRangeEnd - minKeepNumber)
-		{
-			firstIndexToKeep = index;
-			break;
-		}
+		++firstKeyframeToKeep;
 	}
 
-	// Go back to the last keyframe, as we can't keep dependent frames whose keyframes get discarded
-	for (; firstIndexToKeep > 0; --firstIndexToKeep)
+	if (firstKeyframeToKeep > 0)
 	{
-		if (mFrames[firstIndexToKeep]->mType == Frame::Type::KEYFRAME)
-			break;
+		const uint32 newRangeStart = mKeyframes[firstKeyframeToKeep].mNumber;
+		mInputs.erase(mInputs.begin(), mInputs.begin() + (size_t)(newRangeStart - mRangeStart) * 2);
+		mKeyframes.erase(mKeyframes.begin(), mKeyframes.begin() + firstKeyframeToKeep);
+		mRangeStart = newRangeStart;
+		mPlaybackDataIndex = INVALID_INDEX;
+		RMX_CHECK(mRangeEnd == mRangeStart + (uint32)mInputs.size() / 2, "Inconsistency in game recorder frames", );
 	}
+}
+
+void GameRecorder::discardNewFrames(uint32 firstNumberToDiscard)
+{
+	if (firstNumberToDiscard >= mRangeEnd)
+		return;
 
-	if (firstIndexToKeep > 0)
+	if (firstNumberToDiscard <= mRangeStart)
 	{
-		for (size_t index = 0; index < firstIndexToKeep; ++index)
-		{
-			Frame& frame = *mFrames[index];
-			if (frame.mType == Frame::Type::INPUT_ONLY)
-				mFrameNoDataPool.returnObject(frame);
-			else
-				mFrameWithDataPool.returnObject(frame);
-		}
-		mFrames.erase(mFrames.begin(), mFrames.begin() + firstIndexToKeep);
+		// Nothing can be kept, as the first frame must always be a keyframe
+		clear();
+		return;
+	}
 
-		mRangeStart = mFrames[0]->mNumber;
-		RMX_CHECK(mRangeEnd == mRangeStart + (uint32)mFrames.size(), "Inconsistency in game recorder frames", );
+	mInputs.resize((size_t)(firstNumberToDiscard - mRangeStart) * 2);
+	while (mKeyframes.back().mNumber >= firstNumberToDiscard)
+	{
+		mKeyframes.pop_back();
 	}
+	mRangeEnd = firstNumberToDiscard;
+	mPlaybackDataIndex = INVALID_INDEX;
+}
+
+void GameRecorder::getKeyframeNumbers(std::vector<uint32>& outFrameNumbers) const
+{
+	outFrameNumbers.clear();
+	outFrameNumbers.reserve(mKeyframes.size());
+	for (const Keyframe& keyframe : mKeyframes)
+	{
+		outFrameNumbers.push_back(keyframe.mNumber);
+	}
+}
+
+bool GameRecorder::getFrameInputs(uint32 frameNumber, uint16* outInputs) const
+{
+	if (frameNumber < mRangeStart || frameNumber >= mRangeEnd)
+		return false;
+
+	const size_t offset = (size_t)(frameNumber - mRangeStart) * 2;
+	outInputs[0] = mInputs[offset];
+	outInputs[1] = mInputs[offset + 1];
+	return true;
+}
+
+bool GameRecorder::getKeyframeData(uint32 frameNumber, std::vector<uint8>& outData) const
+{
+	const size_t index = getKeyframeIndex(frameNumber);
+	if (index == INVALID_INDEX)
+		return false;
+
+	size_t dataIndex = INVALID_INDEX;
+	return decodeKeyframe(index, outData, dataIndex);
 }
 
 bool GameRecorder::updatePlayback(PlaybackResult& outResult)
@@ -84,16 +166,25 @@ bool GameRecorder::updatePlayback(PlaybackResult& outResult)
 		return false;
 	}
 
-	Frame& frame = *mFrames[mPlaybackPosition];
-	outResult.mInputs[0] = frame.mInputs[0];
-	outResult.mInputs[1] = frame.mInputs[1];
+	const size_t offset = (size_t)(mPlaybackPosition - mRangeStart) * 2;
+	outResult.mInputs[0] = mInputs[offset];
+	outResult.mInputs[1] = mInputs[offset + 1];
 
-	if (frame.mType == Frame::Type::KEYFRAME)
+	if (!mIgnoreKeys || mPlaybackPosition == (int32)mRangeStart)
 	{
-		if (!mIgnoreKeys || mPlaybackPosition == 0)
+		const size_t index = getKeyframeIndex((uint32)mPlaybackPosition);
+		if (index != INVALID_INDEX)
 		{
-			// TODO: Handle "frame.mCompressedData == true" (not needed for pure playback after loading from file)
-			outResult.mData = &frame.mData;
+			// Keyframes get decoded only now, and usually only one difference needs to be applied to the last one
+			if (decodeKeyframe(index, mPlaybackData, mPlaybackDataIndex))
+			{
+				if (!mPlaybackData.empty())
+					outResult.mData = &mPlaybackData;
+			}
+			else
+			{
+				RMX_ERROR("Failed to decode game recording keyframe at frame " << mPlaybackPosition, );
+			}
 		}
 	}
 
@@ -103,21 +194,38 @@ bool GameRecorder::updatePlayback(PlaybackResult& outResult)
 	return true;
 }
 
+uint32 GameRecorder::seekPlayback(uint32 frameNumber)
+{
+	if (!isPlaying() || mKeyframes.empty())
+		return (uint32)std::max(mPlaybackPosition, 0);
+
+	const auto it = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), frameNumber, [](uint32 number, const Keyframe& keyframe) { return number < keyframe.mNumber; });
+	const Keyframe& keyframe = (it == mKeyframes.begin()) ? mKeyframes.front() : *(it - 1);
+	mPlaybackPosition = (int32)keyframe.mNumber;
+	return keyframe.mNumber;
+}
+
 bool GameRecorder::loadRecording(const std::wstring& filename)
 {
 	clear();
 
-	std::vector<uint8> dump;
-	if (!FTX::FileSystem->readFile(filename, dump))
+	if (!FTX::FileSystem->readFileView(filename, mFileData))
 		return false;
 
-	VectorBinarySerializer serializer(true, dump);
+	// Only the parts in front of the keyframe data get copied for parsing, keyframes get decoded directly from the file view when needed
+	std::vector<uint8> content;
+	VectorBinarySerializer serializer(true, content);
+	copyFileData(content, 18);
 
 	// Signature
 	char signature[4];
 	serializer.read(signature, 4);
 	int formatVersion = 0;
-	if (memcmp(signature, "GRC1", 4) == 0)
+	if (memcmp(signature, "GRC2", 4) == 0)
+	{
+		formatVersion = 2;
+	}
+	else if (memcmp(signature, "GRC1", 4) == 0)
 	{
 		formatVersion = 1;
 	}
@@ -137,6 +245,7 @@ bool GameRecorder::loadRecording(const std::wstring& filename)
 	if (std::string(buildString) >= "19.08.11.0")
 	{
 		const uint32 bufferSize = serializer.read<uint32>();
+		copyFileData(content, serializer.getReadPosition() + (size_t)bufferSize + 4);
 		if (bufferSize > 0)
 		{
 			std::vector<uint8> buffer;
@@ -146,49 +255,80 @@ bool GameRecorder::loadRecording(const std::wstring& filename)
 		}
 	}
 
-	// Load all frames
 	const uint32 frameCount = serializer.read<uint32>();
-	for (uint32 index = 0; index < frameCount; ++index)
+	if (formatVersion >= 2)
 	{
-		const Frame::Type frameType = (Frame::Type)serializer.read<uint8>();
-		Frame& frame = createFrameInternal(frameType, index);
-		mFrames.push_back(&frame);
-
-		serializer.serialize(frame.mInputs[0]);
-		serializer.serialize(frame.mInputs[1]);
-
-		if (frameType == Frame::Type::KEYFRAME)
+		if (!loadRecordingV2(serializer, content, frameCount))
+		{
+			clear();
+			return false;
+		}
+	}
+	else
+	{
+		// Load all frames, with the keyframe data in between
+		copyFileData(content, mFileData.getSize());
+		mInputs.reserve((size_t)frameCount * 2);
+		for (uint32 index = 0; index < frameCount; ++index)
 		{
-			frame.mCompressedData = false;
-			const uint32 dataSize = serializer.read<uint32>();
-			if (dataSize > 0)
+			const uint8 frameType = serializer.read<uint8>();
+			mInputs.push_back(serializer.read<uint16>());
+			mInputs.push_back(serializer.read<uint16>());
+
+			if (frameType == FRAMETYPE_KEYFRAME)
 			{
-				if (formatVersion >= 1)
+				const uint32 dataSize = serializer.read<uint32>();
+				if (serializer.getRemaining() < dataSize)
 				{
-					// Newer versions use zlib deflate, including the two zlib header bytes
-					ZlibDeflate::decode(frame.mData, serializer.peek(), dataSize);
-					serializer.skip(dataSize);
+					clear();
+					return false;
 				}
-				else
+
+				// Keyframes without state data are treated like regular frames, except for the first one, as there's always a keyframe at the start
+				if (dataSize == 0 && !mKeyframes.empty())
+					continue;
+
+				Keyframe& keyframe = vectorAdd(mKeyframes);
+				keyframe.mNumber = index;
+				if (dataSize > 0)
 				{
-					// Older version using own (slower) deflate implementation, lacking the two zlib header bytes
-					frame.mData.resize(dataSize);
-					serializer.read((char*)&frame.mData[0], dataSize);
-
-					// Uncompress data
-					int size = 0;
-					uint8* decoded = Deflate::decode(size, (void*)&frame.mData[0], (uint32)frame.mData.size());
-					frame.mData.resize(size);
-					frame.mData.shrink_to_fit();
-					memcpy(frame.mData.data(), decoded, size);
-					delete[] decoded;
+					if (formatVersion >= 1)
+					{
+						// Newer versions use zlib deflate, including the two zlib header bytes
+						//  -> Decompression happens only when the keyframe is needed
+						keyframe.mEncoding = Keyframe::Encoding::ZLIB_FULL;
+						keyframe.mEncodedOffset = serializer.getReadPosition();
+						keyframe.mEncodedSize = dataSize;
+						serializer.skip(dataSize);
+					}
+					else
+					{
+						// Older version using own (slower) deflate implementation, lacking the two zlib header bytes
+						std::vector<uint8> buffer;
+						buffer.resize(dataSize);
+						serializer.read((char*)&buffer[0], dataSize);
+
+						// Uncompress data
+						int size = 0;
+						uint8* decoded = Deflate::decode(size, (void*)&buffer[0], (uint32)buffer.size());
+						keyframe.mData.resize(size);
+						memcpy(keyframe.mData.data(), decoded, size);
+						keyframe.mStateSize = (uint32)size;
+						delete[] decoded;
+					}
 				}
 			}
 		}
+
+		if (serializer.hasError() || mKeyframes.empty() || mKeyframes[0].mNumber != 0)
+		{
+			clear();
+			return false;
+		}
 	}
 
 	mPlaybackPosition = 0;
-	mRangeEnd = (uint32)mFrames.size();
+	mRangeEnd = frameCount;
 	return true;
 }
 
@@ -206,7 +346,8 @@ bool GameRecorder::saveRecording(const std::wstring& filename) const
 
 	// Signature
 	const EngineDelegateInterface::AppMetaData& appMetaData = EngineMain::getDelegate().getAppMetaData();
-	const char SIGNATURE[] = "GRC1";
+	const char SIGNATURE[] = "GRC2";
+	static_assert(GAMERECORDING_FORMATVERSION == 2, "Update the signature");
 	serializer.write(SIGNATURE, 4);
 	serializer.write(appMetaData.mBuildVersionString.c_str(), 10);
 
@@ -222,56 +363,251 @@ bool GameRecorder::saveRecording(const std::wstring& filename) const
 		}
 	}
 
-	// Save all frames
-	const uint32 frameCount = (uint32)mFrames.size();
+	const uint32 frameCount = mRangeEnd - mRangeStart;
+	const uint32 keyframeCount = (uint32)mKeyframes.size();
 	serializer.write(frameCount);
+	serializer.write(keyframeCount);
 
-	for (Frame* frame : mFrames)
+	// Inputs, bit-packed as they rarely change
+	//  -> Per frame, there's one bit telling whether any input changed; if so, followed by one bit per controller and the new 16-bit value for each that changed
 	{
-		serializer.writeAs<uint8>(frame->mType);
-		serializer.write(frame->mInputs[0]);
-		serializer.write(frame->mInputs[1]);
+		buffer.clear();
+		Bitstream bitstream(buffer);
+		uint16 lastInputs[2] = { 0, 0 };
+		for (size_t offset = 0; offset < mInputs.size(); offset += 2)
+		{
+			const bool changed0 = (mInputs[offset] != lastInputs[0]);
+			const bool changed1 = (mInputs[offset + 1] != lastInputs[1]);
+			bitstream.write(changed0 || changed1);
+			if (changed0 || changed1)
+			{
+				bitstream.write(changed0);
+				if (changed0)
+					writeBits(bitstream, mInputs[offset]);
+				bitstream.write(changed1);
+				if (changed1)
+					writeBits(bitstream, mInputs[offset + 1]);
+				lastInputs[0] = mInputs[offset];
+				lastInputs[1] = mInputs[offset + 1];
+			}
+		}
+		const uint32 inputDataSize = (uint32)bitstream.getSize();
+		serializer.write(inputDataSize);
+		if (inputDataSize > 0)
+		{
+			serializer.write(&buffer[0], inputDataSize);
+		}
+	}
 
-		if (frame->mType == Frame::Type::KEYFRAME)
+	// Encode keyframes
+	std::vector<std::vector<uint8>> encodedKeyframes(mKeyframes.size());
+	std::vector<Keyframe::Encoding> encodings(mKeyframes.size());
+	std::vector<uint32> stateSizes(mKeyframes.size());
+	{
+		std::vector<uint8> previousState;
+		std::vector<uint8> currentState;
+		size_t currentIndex = INVALID_INDEX;
+		for (size_t index = 0; index < mKeyframes.size(); ++index)
 		{
-			if (!frame->mCompressedData)
+			previousState = currentState;
+			if (!decodeKeyframe(index, currentState, currentIndex))
+				return false;
+			stateSizes[index] = (uint32)currentState.size();
+
+			if ((index % FULL_KEYFRAME_INTERVAL) == 0)
 			{
-				// Compress data
-				buffer.clear();
-				ZlibDeflate::encode(buffer, &frame->mData[0], frame->mData.size());
-				frame->mData.swap(buffer);
-				frame->mData.shrink_to_fit();
-				frame->mCompressedData = true;
+				encodings[index] = Keyframe::Encoding::ZLIB_FULL;
+				ZlibDeflate::encode(encodedKeyframes[index], currentState.data(), currentState.size());
 			}
+			else
+			{
+				encodings[index] = Keyframe::Encoding::ZLIB_DELTA;
+				buffer.resize(currentState.size());
+				for (size_t k = 0; k < currentState.size(); ++k)
+				{
+					buffer[k] = currentState[k] ^ ((k < previousState.size()) ? previousState[k] : 0);
+				}
+				ZlibDeflate::encode(encodedKeyframes[index], buffer.data(), buffer.size());
+			}
+		}
+	}
 
-			const uint32 dataSize = (uint32)frame->mData.size();
-			serializer.write(dataSize);
-			serializer.write(&frame->mData[0], dataSize);
+	// Keyframe index, with positions relative to the start of the keyframe data that follows
+	{
+		uint32 position = 0;
+		for (size_t index = 0; index < mKeyframes.size(); ++index)
+		{
+			serializer.write<uint32>(mKeyframes[index].mNumber - mRangeStart);
+			serializer.writeAs<uint8>(encodings[index]);
+			serializer.write<uint32>(stateSizes[index]);
+			serializer.write<uint32>(position);
+			serializer.write<uint32>((uint32)encodedKeyframes[index].size());
+			position += (uint32)encodedKeyframes[index].size();
 		}
 	}
 
+	// Keyframe data
+	for (const std::vector<uint8>& encoded : encodedKeyframes)
+	{
+		if (!encoded.empty())
+			serializer.write(&encoded[0], encoded.size());
+	}
+
 	return FTX::FileSystem->saveFile(filename, dump);
 }
 
-GameRecorder::Frame& GameRecorder::createFrameInternal(Frame::Type frameType, uint32 number)
+size_t GameRecorder::getKeyframeIndex(uint32 frameNumber) const
 {
-	Frame& frame = (frameType == Frame::Type::INPUT_ONLY) ? mFrameNoDataPool.rentObject() : mFrameWithDataPool.rentObject();
-	frame.mType = frameType;
-	frame.mNumber = number;
-	frame.mInputs[0] = 0;
-	frame.mInputs[1] = 0;
-	frame.mCompressedData = false;
-	frame.mData.clear();
-	return frame;
+	const auto it = std::lower_bound(mKeyframes.begin(), mKeyframes.end(), frameNumber, [](const Keyframe& keyframe, uint32 number) { return keyframe.mNumber < number; });
+	return (it != mKeyframes.end() && it->mNumber == frameNumber) ? (size_t)(it - mKeyframes.begin()) : INVALID_INDEX;
 }
 
-GameRecorder::Frame& GameRecorder::addFrameInternal(const uint16* inputs, Frame::Type frameType)
+bool GameRecorder::decodeKeyframe(size_t index, std::vector<uint8>& data, size_t& dataIndex) const
 {
-	Frame& frame = createFrameInternal(frameType, mRangeEnd);
-	frame.mInputs[0] = inputs[0];
-	frame.mInputs[1] = inputs[1];
+	// The given data holds the state of the keyframe with index "dataIndex", or nothing useful if that is INVALID_INDEX
+	if (dataIndex == index)
+		return true;
 
-	mFrames.push_back(&frame);
-	++mRangeEnd;
-	return frame;
+	// Go back to the closest keyframe that does not depend on its predecessor, unless the given data holds that predecessor already
+	size_t firstIndex = index;
+	while (firstIndex > 0 && firstIndex != dataIndex + 1 && mKeyframes[firstIndex].mData.empty() && mKeyframes[firstIndex].mEncoding == Keyframe::Encoding::ZLIB_DELTA)
+	{
+		--firstIndex;
+	}
+
+	for (size_t k = firstIndex; k <= index; ++k)
+	{
+		if (!applyKeyframe(mKeyframes[k], data))
+		{
+			dataIndex = INVALID_INDEX;
+			return false;
+		}
+	}
+	dataIndex = index;
+	return true;
+}
+
+bool GameRecorder::applyKeyframe(const Keyframe& keyframe, std::vector<uint8>& data) const
+{
+	if (!keyframe.mData.empty())
+	{
+		data = keyframe.mData;
+		return true;
+	}
+
+	if (keyframe.mEncodedSize == 0)
+	{
+		// Keyframe without any state data
+		data.clear();
+		return true;
+	}
+	if (keyframe.mEncodedOffset + keyframe.mEncodedSize > mFileData.getSize())
+		return false;
+
+	const uint8* encoded = mFileData.getData() + keyframe.mEncodedOffset;
+	if (keyframe.mEncoding == Keyframe::Encoding::ZLIB_FULL)
+	{
+		data.clear();
+		data.reserve(keyframe.mStateSize);
+		return ZlibDeflate::decode(data, encoded, keyframe.mEncodedSize);
+	}
+	else
+	{
+		static thread_local std::vector<uint8> difference;
+		difference.clear();
+		difference.reserve(keyframe.mStateSize);
+		if (!ZlibDeflate::decode(difference, encoded, keyframe.mEncodedSize) || difference.size() != keyframe.mStateSize)
+			return false;
+
+		data.resize(difference.size(), 0);
+		for (size_t k = 0; k < difference.size(); ++k)
+		{
+			data[k] ^= difference[k];
+		}
+		return true;
+	}
+}
+
+void GameRecorder::copyFileData(std::vector<uint8>& content, size_t endPosition) const
+{
+	// Extend the content copy so that it covers the file data up to the given position, as far as available
+	endPosition = std::min(endPosition, mFileData.getSize());
+	if (content.size() < endPosition)
+	{
+		content.insert(content.end(), mFileData.getData() + content.size(), mFileData.getData() + endPosition);
+	}
+}
+
+bool GameRecorder::loadRecordingV2(VectorBinarySerializer& serializer, std::vector<uint8>& content, uint32 frameCount)
+{
+	copyFileData(content, serializer.getReadPosition() + 8);
+	const uint32 keyframeCount = serializer.read<uint32>();
+
+	// Inputs
+	{
+		const uint32 inputDataSize = serializer.read<uint32>();
+		copyFileData(content, serializer.getReadPosition() + (size_t)inputDataSize);
+		if (serializer.getRemaining() < inputDataSize)
+			return false;
+
+		// Reading a frame's inputs takes 33 bits at most, so a few extra bytes of padding make sure it never reads past the end
+		std::vector<uint8> inputBits(inputDataSize + 5, 0);
+		if (inputDataSize > 0)
+		{
+			serializer.read(&inputBits[0], inputDataSize);
+		}
+
+		Bitstream bitstream(inputBits);
+		uint16 inputs[2] = { 0, 0 };
+		mInputs.resize((size_t)frameCount * 2);
+		for (size_t offset = 0; offset < mInputs.size(); offset += 2)
+		{
+			if (bitstream.getSize() > inputDataSize)
+				return false;
+
+			if (bitstream.read())
+			{
+				if (bitstream.read())
+					inputs[0] = readBits(bitstream);
+				if (bitstream.read())
+					inputs[1] = readBits(bitstream);
+			}
+			mInputs[offset] = inputs[0];
+			mInputs[offset + 1] = inputs[1];
+		}
+	}
+
+	// Keyframe index
+	const size_t KEYFRAME_INDEX_ENTRY_SIZE = 17;
+	copyFileData(content, serializer.getReadPosition() + (size_t)keyframeCount * KEYFRAME_INDEX_ENTRY_SIZE);
+	if (serializer.getRemaining() < (size_t)keyframeCount * KEYFRAME_INDEX_ENTRY_SIZE)
+		return false;
+
+	mKeyframes.resize(keyframeCount);
+	for (uint32 index = 0; index < keyframeCount; ++index)
+	{
+		Keyframe& keyframe = mKeyframes[index];
+		keyframe.mNumber = serializer.read<uint32>();
+		keyframe.mEncoding = (Keyframe::Encoding)serializer.read<uint8>();
+		keyframe.mStateSize = serializer.read<uint32>();
+		keyframe.mEncodedOffset = serializer.read<uint32>();
+		keyframe.mEncodedSize = serializer.read<uint32>();
+
+		if (keyframe.mNumber >= frameCount || (index > 0 && keyframe.mNumber <= mKeyframes[index - 1].mNumber))
+			return false;
+		if (keyframe.mEncoding != Keyframe::Encoding::ZLIB_FULL && keyframe.mEncoding != Keyframe::Encoding::ZLIB_DELTA)
+			return false;
+	}
+	if (serializer.hasError() || mKeyframes.empty() || mKeyframes[0].mNumber != 0 || mKeyframes[0].mEncoding != Keyframe::Encoding::ZLIB_FULL)
+		return false;
+
+	// Keyframe data is not read here, only its position inside the file contents gets stored
+	const size_t dataStart = serializer.getReadPosition();
+	for (Keyframe& keyframe : mKeyframes)
+	{
+		keyframe.mEncodedOffset += dataStart;
+		if (keyframe.mEncodedOffset + keyframe.mEncodedSize > mFileData.getSize())
+			return false;
+	}
+	return true;
 }
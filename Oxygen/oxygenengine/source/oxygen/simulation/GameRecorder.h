@@ -26,47 +26,65 @@ public:
 	void addKeyFrame(const uint16* inputs, const std::vector<uint8>& data);
 
 	void discardOldFrames(uint32 minKeepNumber = 3600);
+	void discardNewFrames(uint32 firstNumberToDiscard);		// For continuing the recording from an earlier frame, e.g. after rewinding
 
 	inline uint32 getCurrentNumberOfFrames() const  { return mRangeEnd - mRangeStart; }
 	inline uint32 getRangeStart() const	 { return mRangeStart; }
 	inline uint32 getRangeEnd() const	 { return mRangeEnd; }
 
+	// Random access to recorded frames, e.g. for verification
+	void getKeyframeNumbers(std::vector<uint32>& outFrameNumbers) const;
+	bool getFrameInputs(uint32 frameNumber, uint16* outInputs) const;
+	bool getKeyframeData(uint32 frameNumber, std::vector<uint8>& outData) const;
+
 	inline bool isPlaying() const	{ return mPlaybackPosition >= 0; }
 	bool updatePlayback(PlaybackResult& outResult);
 
+	// Continue playback at the last keyframe at or before the given frame, and return that keyframe's frame number
+	uint32 seekPlayback(uint32 frameNumber);
+
 	bool loadRecording(const std::wstring& filename);
 	bool saveRecording(const std::wstring& filename) const;
 
 	inline void setIgnoreKeys(bool ignoreKeys)  { mIgnoreKeys = ignoreKeys; }
 
 private:
-	struct Frame
+	struct Keyframe
 	{
-		enum class Type : uint8
+		enum class Encoding : uint8
 		{
-			INPUT_ONLY,
-			KEYFRAME,
-			DIFFERENTIAL	// Difference to last keyframe; not implemented yet
+			ZLIB_FULL  = 0,		// Zlib compressed state data
+			ZLIB_DELTA = 1		// Zlib compressed XOR difference to the previous keyframe's state data
 		};
 
-		Type mType = Type::INPUT_ONLY;
 		uint32 mNumber = 0;
-		uint16 mInputs[2] = { 0 };
-		bool mCompressedData = false;
-		std::vector<uint8> mData;
+		std::vector<uint8> mData;		// Uncompressed state data; empty for keyframes of a loaded recording, which get decoded only when needed
+		Encoding mEncoding = Encoding::ZLIB_FULL;
+		uint32 mStateSize = 0;			// Size of the uncompressed state data, for encoded keyframes
+		size_t mEncodedOffset = 0;		// Position of the encoded data in "mFileData"
+		uint32 mEncodedSize = 0;		// Can be 0 for keyframes without any state data, which older recordings may contain
 	};
 
+	static const constexpr size_t INVALID_INDEX = (size_t)-1;
+
 private:
-	Frame& createFrameInternal(Frame::Type frameType, uint32 number);
-	Frame& addFrameInternal(const uint16* inputs, Frame::Type frameType);
+	size_t getKeyframeIndex(uint32 frameNumber) const;
+	bool decodeKeyframe(size_t index, std::vector<uint8>& data, size_t& dataIndex) const;
+	bool applyKeyframe(const Keyframe& keyframe, std::vector<uint8>& data) const;
+
+	void copyFileData(std::vector<uint8>& content, size_t endPosition) const;
+	bool loadRecordingV2(VectorBinarySerializer& serializer, std::vector<uint8>& content, uint32 frameCount);
 
 private:
-	std::vector<Frame*> mFrames;
-	RentableObjectPool<Frame> mFrameNoDataPool;
-	RentableObjectPool<Frame> mFrameWithDataPool;
+	std::vector<uint16> mInputs;		// Two entries per frame, starting with frame number "mRangeStart"
+	std::vector<Keyframe> mKeyframes;	// Sorted by frame number, the first one is always at "mRangeStart"
+	rmx::FileView mFileData;			// Contents of the loaded recording file, with the encoded keyframes
 
 	int32 mPlaybackPosition = -1;	// Frame number of next frame to play; or -1 if no playback active
-	uint32 mRangeStart = 0;			// Frame number of first frame stored in mFrames
-	uint32 mRangeEnd = 0;			// Frame number of last frame stored in mFrames plus one (!)
+	uint32 mRangeStart = 0;			// Frame number of first frame stored
+	uint32 mRangeEnd = 0;			// Frame number of last frame stored plus one (!)
 	bool mIgnoreKeys = false;
+
+	std::vector<uint8> mPlaybackData;	// State data of the keyframe with index "mPlaybackDataIndex", for playback
+	size_t mPlaybackDataIndex = INVALID_INDEX;
 };
@@ -13,6 +13,7 @@
 #include "oxygen/simulation/LogDisplay.h"
 #include "oxygen/simulation/PersistentData.h"
 #include "oxygen/simulation/Simulation.h"
+#include "oxygen/simulation/SimulationContext.h"
 #include "oxygen/simulation/analyse/ROMDataAnalyser.h"
 #include "oxygen/application/Application.h"
 #include "oxygen/application/EngineMain.h"
@@ -325,8 +326,18 @@ namespace
 	}
 
 
+	LogDisplay* getLogDisplay()
+	{
+		// Additional simulation contexts bound to a thread don't write to the log display, only the main simulation does
+		return EmulatorInterface::hasThreadInstance() ? nullptr : &LogDisplay::instance();
+	}
+
 	void debugLogInternal(std::string_view valueString)
 	{
+		LogDisplay* logDisplay = getLogDisplay();
+		if (nullptr == logDisplay)
+			return;
+
 		uint32 lineNumber = 0;
 		const bool success = LemonScriptRuntime::getCurrentScriptFunction(nullptr, nullptr, &lineNumber, nullptr);
 	#if DEBUG
@@ -334,7 +345,7 @@ namespace
 			RMX_ERROR("Could not determine current script function during logging", );
 	#endif
 
-		LogDisplay::ScriptLogSingleEntry& scriptLogSingleEntry = LogDisplay::instance().updateScriptLogValue(*String(0, "%04d", lineNumber), valueString);
+		LogDisplay::ScriptLogSingleEntry& scriptLogSingleEntry = logDisplay->updateScriptLogValue(*String(0, "%04d", lineNumber), valueString);
 		if (gDebugNotificationInterface)
 			gDebugNotificationInterface->onLog(scriptLogSingleEntry);
 
@@ -359,7 +370,8 @@ namespace
 	{
 		if (EngineMain::getDelegate().useDeveloperFeatures())
 		{
-			if (!name.isValid())
+			LogDisplay* logDisplay = getLogDisplay();
+			if (!name.isValid() || nullptr == logDisplay)
 				return;
 
 			CodeExec* codeExec = CodeExec::getActiveInstance();
@@ -374,7 +386,7 @@ namespace
 				const uint16 packedColor = emulatorInterface.readMemory16(startAddress + i * 2);
 				entry.mColors.push_back(PaletteManager::unpackColor(packedColor));
 			}
-			LogDisplay::instance().addColorLogEntry(entry);
+			logDisplay->addColorLogEntry(entry);
 
 			Application::instance().getSimulation().stopSingleStepContinue();
 		}
@@ -922,19 +934,34 @@ namespace
 	}
 
 
+	AudioOutBase* getAudioOut()
+	{
+		// Additional simulation contexts bound to a thread don't output any audio, only the main simulation does
+		//  -> Instead, they keep track of their own audio state, see "SimulationContext"
+		return (nullptr != SimulationContext::getBoundContext()) ? nullptr : &EngineMain::instance().getAudioOut();
+	}
+
+	bool playAudioBase(uint64 sfxId, uint8 contextId)
+	{
+		SimulationContext* simulationContext = SimulationContext::getBoundContext();
+		return (nullptr != simulationContext) ? simulationContext->playAudio(sfxId, contextId) : EngineMain::instance().getAudioOut().playAudioBase(sfxId, contextId);
+	}
+
 	uint8 Audio_getAudioKeyType(uint64 sfxId)
 	{
+		// This only depends on the audio collection, which is the same for all simulation contexts
 		return (uint8)EngineMain::instance().getAudioOut().getAudioKeyType(sfxId);
 	}
 
 	bool Audio_isPlayingAudio(uint64 sfxId)
 	{
-		return EngineMain::instance().getAudioOut().isPlayingSfxId(sfxId);
+		SimulationContext* simulationContext = SimulationContext::getBoundContext();
+		return (nullptr != simulationContext) ? simulationContext->isPlayingAudio(sfxId) : EngineMain::instance().getAudioOut().isPlayingSfxId(sfxId);
 	}
 
 	void Audio_playAudio1(uint64 sfxId, uint8 contextId)
 	{
-		const bool success = EngineMain::instance().getAudioOut().playAudioBase(sfxId, contextId);
+		const bool success = playAudioBase(sfxId, contextId);
 		if (!success)
 		{
 			// Audio collections expect lowercase IDs, so we might need to do the conversion here first
@@ -953,7 +980,7 @@ namespace
 						String str = textString;
 						str.lowerCase();
 						sfxId = rmx::getMurmur2_64(str);
-						EngineMain::instance().getAudioOut().playAudioBase(sfxId, contextId);
+						playAudioBase(sfxId, contextId);
 					}
 				}
 			}
@@ -967,35 +994,53 @@ namespace
 
 	void Audio_stopChannel(uint8 channel)
 	{
-		EngineMain::instance().getAudioOut().stopChannel(channel);
+		SimulationContext* simulationContext = SimulationContext::getBoundContext();
+		if (nullptr != simulationContext)
+			simulationContext->stopChannel(channel);
+		else
+			EngineMain::instance().getAudioOut().stopChannel(channel);
 	}
 
 	void Audio_fadeInChannel(uint8 channel, uint16 length)
 	{
-		EngineMain::instance().getAudioOut().fadeInChannel(channel, (float)length / 256.0f);
+		AudioOutBase* audioOut = getAudioOut();
+		if (nullptr != audioOut)
+			audioOut->fadeInChannel(channel, (float)length / 256.0f);
 	}
 
 	void Audio_fadeOutChannel(uint8 channel, uint16 length)
 	{
-		EngineMain::instance().getAudioOut().fadeOutChannel(channel, (float)length / 256.0f);
+		// Simulation contexts don't play audio, so fading out is the same as stopping right away for them
+		SimulationContext* simulationContext = SimulationContext::getBoundContext();
+		if (nullptr != simulationContext)
+			simulationContext->stopChannel(channel);
+		else
+			EngineMain::instance().getAudioOut().fadeOutChannel(channel, (float)length / 256.0f);
 	}
 
 	void Audio_playOverride(uint64 sfxId, uint8 contextId, uint8 channelId, uint8 overriddenChannelId)
 	{
-		EngineMain::instance().getAudioOut().playOverride(sfxId, contextId, channelId, overriddenChannelId);
+		SimulationContext* simulationContext = SimulationContext::getBoundContext();
+		if (nullptr != simulationContext)
+			simulationContext->playOverride(sfxId, contextId, channelId);
+		else
+			EngineMain::instance().getAudioOut().playOverride(sfxId, contextId, channelId, overriddenChannelId);
 	}
 
 	void Audio_enableAudioModifier(uint8 channel, uint8 context, lemon::StringRef postfix, uint32 relativeSpeed)
 	{
-		if (postfix.isValid())
+		AudioOutBase* audioOut = getAudioOut();
+		if (nullptr != audioOut && postfix.isValid())
 		{
-			EngineMain::instance().getAudioOut().enableAudioModifier(channel, context, postfix.getString(), (float)relativeSpeed / 65536.0f);
+			audioOut->enableAudioModifier(channel, context, postfix.getString(), (float)relativeSpeed / 65536.0f);
 		}
 	}
 
 	void Audio_disableAudioModifier(uint8 channel, uint8 context)
 	{
-		EngineMain::instance().getAudioOut().disableAudioModifier(channel, context);
+		AudioOutBase* audioOut = getAudioOut();
+		if (nullptr != audioOut)
+			audioOut->disableAudioModifier(channel, context);
 	}
 
 
@@ -1235,9 +1280,10 @@ namespace
 
 	void System_writeDisplayLine(lemon::StringRef text)
 	{
-		if (text.isValid())
+		LogDisplay* logDisplay = getLogDisplay();
+		if (text.isValid() && nullptr != logDisplay)
 		{
-			LogDisplay::instance().setLogDisplay(text.getString(), 2.0f);
+			logDisplay->setLogDisplay(text.getString(), 2.0f);
 		}
 	}
 
@@ -20,6 +20,66 @@
 #include <lemon/program/Program.h>
 #include <lemon/utility/PragmaSplitter.h>
 
+#include <chrono>
+#include <thread>
+
+
+namespace
+{
+	const uint32 MODULE_CACHE_FORMAT_VERSION = 3;	// Increase this when changing what gets written to the module cache files
+
+	inline uint64 addToHash(uint64 hash, uint64 value)
+	{
+		return rmx::addToFNV1a_64(hash, (const uint8*)&value, sizeof(value));
+	}
+
+	uint64 buildModSourceHash(const Mod& mod, std::vector<std::wstring>& outScriptFiles)
+	{
+		// Collect all script files of the mod, in a fixed order
+		std::vector<rmx::FileIO::FileEntry> fileEntries;
+		FTX::FileSystem->listFilesByMask(mod.mFullPath + L"scripts/*.lemon", true, fileEntries);
+		std::sort(fileEntries.begin(), fileEntries.end(), [](const rmx::FileIO::FileEntry& a, const rmx::FileIO::FileEntry& b) { return (a.mPath == b.mPath) ? (a.mFilename < b.mFilename) : (a.mPath < b.mPath); });
+
+		uint64 hash = rmx::startFNV1a_64();
+		std::vector<uint8> content;
+		outScriptFiles.clear();
+		for (const rmx::FileIO::FileEntry& fileEntry : fileEntries)
+		{
+			const std::wstring fullPath = fileEntry.mPath + fileEntry.mFilename;
+			if (!FTX::FileSystem->readFile(fullPath, content))
+				continue;
+
+			hash = addToHash(hash, rmx::getMurmur2_64(fullPath.substr(mod.mFullPath.length())));
+			hash = addToHash(hash, content.size());
+			hash = rmx::addToFNV1a_64(hash, content.data(), content.size());
+			outScriptFiles.push_back(fullPath);
+		}
+		return hash;
+	}
+
+	uint64 buildFilesHash(const std::vector<std::wstring>& filenames)
+	{
+		uint64 hash = rmx::startFNV1a_64();
+		std::vector<uint8> content;
+		for (const std::wstring& filename : filenames)
+		{
+			// A file that can't be read gets hashed like an empty file, so that its removal gets noticed as well
+			if (!FTX::FileSystem->readFile(filename, content))
+				content.clear();
+
+			hash = addToHash(hash, rmx::getMurmur2_64(filename));
+			hash = addToHash(hash, content.size());
+			hash = rmx::addToFNV1a_64(hash, content.data(), content.size());
+		}
+		return hash;
+	}
+
+	std::wstring getModuleCacheFilename(const Mod& mod)
+	{
+		return Configuration::instance().mAppDataPath + L"cache/scripts/" + String(rmx::hexString(mod.mLocalDirectoryHash, 16, "")).toStdWString() + L".bin";
+	}
+}
+
 
 struct LemonScriptProgram::Internal
 {
@@ -139,6 +199,64 @@ bool LemonScriptProgram::loadScriptModule(lemon::Module& module, lemon::GlobalsL
 	return true;
 }
 
+bool LemonScriptProgram::loadModuleFromCache(lemon::Module& module, const std::wstring& cacheFilename, uint64 sourceHash, uint64 dependencyHash, uint32 appVersion)
+{
+	std::vector<uint8> buffer;
+	if (!FTX::FileSystem->readFile(cacheFilename, buffer) || buffer.size() < sizeof(uint32) + sizeof(uint64))
+		return false;
+
+	VectorBinarySerializer serializer(true, buffer);
+	if (serializer.read<uint32>() != MODULE_CACHE_FORMAT_VERSION)
+		return false;
+	if (serializer.read<uint64>() != sourceHash)
+		return false;
+	if (serializer.read<uint64>() != dependencyHash)
+		return false;
+
+	// Script files that got included from outside the mod's scripts folder are not part of the source hash, so check them separately
+	std::vector<std::wstring> externalFiles;
+	serializer.serializeArraySize(externalFiles);
+	for (std::wstring& filename : externalFiles)
+		serializer.serialize(filename);
+	if (serializer.read<uint64>() != buildFilesHash(externalFiles))
+		return false;
+
+	// Module serialization checks the core module's dependency hash and app version on its own
+	return module.serialize(serializer, mInternal.mCoreModule.buildDependencyHash(), appVersion);
+}
+
+void LemonScriptProgram::saveModuleToCache(lemon::Module& module, const std::wstring& cacheFilename, uint64 sourceHash, const std::vector<std::wstring>& scriptFiles, uint64 dependencyHash, uint32 appVersion)
+{
+	// Collect all source files that the compiler loaded, but are not covered by the source hash
+	std::vector<std::wstring> externalFiles;
+	for (const lemon::SourceFileInfo* sourceFileInfo : module.getSourceFileInfos())
+	{
+		if (std::find(scriptFiles.begin(), scriptFiles.end(), sourceFileInfo->mFullPath) == scriptFiles.end())
+			externalFiles.push_back(sourceFileInfo->mFullPath);
+	}
+
+	std::vector<uint8> buffer;
+	VectorBinarySerializer serializer(false, buffer);
+	serializer.write(MODULE_CACHE_FORMAT_VERSION);
+	serializer.write(sourceHash);
+	serializer.write(dependencyHash);
+	serializer.serializeArraySize(externalFiles);
+	for (std::wstring& filename : externalFiles)
+		serializer.serialize(filename);
+	serializer.write(buildFilesHash(externalFiles));
+	if (module.serialize(serializer, mInternal.mCoreModule.buildDependencyHash(), appVersion))
+	{
+		// Write to a temporary file first and then rename it, so that other instances running at the same time never read a partially written cache file
+		const uint64 uniqueId = (uint64)std::chrono::high_resolution_clock::now().time_since_epoch().count() ^ (uint64)std::hash<std::thread::id>()(std::this_thread::get_id());
+		const std::wstring tempFilename = cacheFilename + L"." + String(rmx::hexString(uniqueId, 16, "")).toStdWString() + L".tmp";
+		if (FTX::FileSystem->saveFile(tempFilename, buffer))
+		{
+			if (!FTX::FileSystem->renameFile(tempFilename, cacheFilename))
+				FTX::FileSystem->removeFile(tempFilename);
+		}
+	}
+}
+
 LemonScriptProgram::LoadScriptsResult LemonScriptProgram::loadScripts(const std::string& filename, const LoadOptions& loadOptions)
 {
 	// Select script mods to load
@@ -243,7 +361,7 @@ LemonScriptProgram::LoadScriptsResult LemonScriptProgram::loadScripts(const std:
 	}
 
 	// Load mod script modules
-	// TODO: There might be mod script modules already loaded that should stay loaded, i.e. no actual reload is needed for these
+	//  -> Unchanged mod script modules get loaded from the compiled module cache instead of being recompiled
 	{
 		for (lemon::Module* module : mInternal.mModModules)
 			delete module;
@@ -251,6 +369,16 @@ LemonScriptProgram::LoadScriptsResult LemonScriptProgram::loadScripts(const std:
 
 		if (!modsToLoad.empty())
 		{
+			// Hash of everything that a mod module's compilation depends on, except for its own sources
+			uint64 predecessorsHash = rmx::startFNV1a_64();
+			for (const auto& pair : config.mPreprocessorDefinitions.getDefinitions())
+			{
+				predecessorsHash = addToHash(predecessorsHash, pair.second.mIdentifier.getHash());
+				predecessorsHash = addToHash(predecessorsHash, pair.second.mValue);
+			}
+			predecessorsHash = addToHash(predecessorsHash, mInternal.mCoreModule.buildDefinitionsHash());
+			predecessorsHash = addToHash(predecessorsHash, mInternal.mScriptModule.buildDefinitionsHash());
+
 			lemon::Module* previousModule = &mInternal.mScriptModule;
 			for (const Mod* mod : modsToLoad)
 			{
@@ -260,14 +388,28 @@ LemonScriptProgram::LoadScriptsResult LemonScriptProgram::loadScripts(const std:
 					previousModule = nullptr;
 				}
 
-				// Create and compile module
+				// Create module and load it from the cache, or compile it if the cache is outdated
 				lemon::Module* module = new lemon::Module(mod->mName);
-				const std::wstring mainScriptFilename = mod->mFullPath + L"scripts/main.lemon";
-				const bool success = loadScriptModule(*module, globalsLookup, mainScriptFilename);
+				std::vector<std::wstring> scriptFiles;
+				const uint64 sourceHash = buildModSourceHash(*mod, scriptFiles);
+				bool success = !config.mForceCompileScripts && loadModuleFromCache(*module, getModuleCacheFilename(*mod), sourceHash, predecessorsHash, loadOptions.mAppVersion);
+				if (!success)
+				{
+					module->clear();
+					const std::wstring mainScriptFilename = mod->mFullPath + L"scripts/main.lemon";
+					success = loadScriptModule(*module, globalsLookup, mainScriptFilename);
+					if (success)
+					{
+						saveModuleToCache(*module, getModuleCacheFilename(*mod), sourceHash, scriptFiles, predecessorsHash, loadOptions.mAppVersion);
+					}
+				}
+
 				if (success)
 				{
 					mInternal.mModModules.push_back(module);
 					previousModule = module;
+					predecessorsHash = addToHash(predecessorsHash, sourceHash);
+					predecessorsHash = addToHash(predecessorsHash, module->buildDefinitionsHash());
 				}
 				else
 				{
@@ -288,7 +430,7 @@ LemonScriptProgram::LoadScriptsResult LemonScriptProgram::loadScripts(const std:
 
 	// Set script optimization level
 	{
-		int scriptOptimizationLevel = clamp(config.mScriptOptimizationLevel, 0, 3);
+		int scriptOptimizationLevel = clamp(config.mScriptOptimizationLevel, 0, 5);
 		if (config.mScriptOptimizationLevel < 0)
 		{
 			// Auto-select script optimization level
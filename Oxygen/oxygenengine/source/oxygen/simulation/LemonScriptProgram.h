@@ -99,6 +99,8 @@ public:
 
 private:
 	bool loadScriptModule(lemon::Module& module, lemon::GlobalsLookup& globalsLookup, const std::wstring& filename);
+	bool loadModuleFromCache(lemon::Module& module, const std::wstring& cacheFilename, uint64 sourceHash, uint64 dependencyHash, uint32 appVersion);
+	void saveModuleToCache(lemon::Module& module, const std::wstring& cacheFilename, uint64 sourceHash, const std::vector<std::wstring>& scriptFiles, uint64 dependencyHash, uint32 appVersion);
 	void evaluateFunctionPragmas();
 	void evaluateDefines();
 
@@ -105,9 +105,20 @@ struct LemonScriptRuntime::Internal
 	lemon::Runtime mRuntime;
 	RuntimeDetailHandler mRuntimeDetailHandler;
 	LinearLookupTable<const lemon::RuntimeFunction*, 0x400000, 6, 1024> mAddressHookLookup;
+	std::vector<uint64> mHotFunctions;		// Name and signature hashes of the functions that got called in the last session
+	bool mHotFunctionsLoaded = false;
 };
 
 
+namespace
+{
+	std::wstring getHotFunctionsProfileFilename()
+	{
+		return Configuration::instance().mAppDataPath + L"cache/scripts/hotfunctions.bin";
+	}
+}
+
+
 
 bool LemonScriptRuntime::getCurrentScriptFunction(std::string_view* outFunctionName, std::wstring* outFileName, uint32* outLineNumber, std::string* outModuleName)
 {
@@ -183,16 +194,68 @@ bool LemonScriptRuntime::hasValidProgram() const
 	return mProgram.hasValidProgram();
 }
 
-void LemonScriptRuntime::onProgramUpdated()
+void LemonScriptRuntime::onProgramUpdated(bool keepUnchangedFunctions)
 {
 	// Assign lemon script program to runtime, implicitly resetting the runtime as well
-	mInternal.mRuntime.setProgram(mProgram.getInternalLemonProgram());
+	if (keepUnchangedFunctions)
+	{
+		// Only functions that changed will have to be built again
+		mInternal.mRuntime.reloadProgram(mProgram.getInternalLemonProgram());
+	}
+	else
+	{
+		mInternal.mRuntime.setProgram(mProgram.getInternalLemonProgram());
+	}
 
 	// Reset the lookup table for address hook runtime functions
 	mInternal.mAddressHookLookup.clear();
 
-	// Build all runtime functions right away
-	mInternal.mRuntime.buildAllRuntimeFunctions();
+	// Calls only need to be counted if the hot functions profile gets saved at shutdown
+	mInternal.mRuntime.setRecordCallCounts(Configuration::instance().mLazyScriptFunctionBuilding && !EngineMain::instance().isHeadless());
+
+	if (Configuration::instance().mLazyScriptFunctionBuilding)
+	{
+		// Build only the functions that were called in the last session, all others get built when they're called for the first time
+		if (!mInternal.mHotFunctionsLoaded)
+		{
+			std::vector<uint8> buffer;
+			if (FTX::FileSystem->readFile(getHotFunctionsProfileFilename(), buffer))
+			{
+				VectorBinarySerializer serializer(true, buffer);
+				serializer.serializeArraySize(mInternal.mHotFunctions);
+				for (uint64& hash : mInternal.mHotFunctions)
+					serializer & hash;
+			}
+			mInternal.mHotFunctionsLoaded = true;
+		}
+
+		for (uint64 hash : mInternal.mHotFunctions)
+		{
+			mInternal.mRuntime.getRuntimeFunctionBySignature(hash);
+		}
+	}
+	else
+	{
+		// Build all runtime functions right away
+		mInternal.mRuntime.buildAllRuntimeFunctions();
+	}
+}
+
+void LemonScriptRuntime::saveHotFunctionsProfile()
+{
+	if (!hasValidProgram())
+		return;
+
+	mInternal.mRuntime.getCalledRuntimeFunctions(mInternal.mHotFunctions);
+	if (mInternal.mHotFunctions.size() > 0xffff)
+		mInternal.mHotFunctions.resize(0xffff);
+
+	std::vector<uint8> buffer;
+	VectorBinarySerializer serializer(false, buffer);
+	serializer.serializeArraySize(mInternal.mHotFunctions);
+	for (uint64& hash : mInternal.mHotFunctions)
+		serializer & hash;
+	FTX::FileSystem->saveFile(getHotFunctionsProfileFilename(), buffer);
 }
 
 bool LemonScriptRuntime::serializeRuntime(VectorBinarySerializer& serializer)
@@ -44,7 +44,8 @@ public:
 	inline LemonScriptProgram& getLemonScriptProgram() { return mProgram; }
 
 	bool hasValidProgram() const;
-	void onProgramUpdated();
+	void onProgramUpdated(bool keepUnchangedFunctions = false);
+	void saveHotFunctionsProfile();
 
 	bool serializeRuntime(VectorBinarySerializer& serializer);
 
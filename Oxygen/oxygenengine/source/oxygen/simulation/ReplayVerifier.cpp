@@ -0,0 +1,119 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "oxygen/pch.h"
+#include "oxygen/simulation/ReplayVerifier.h"
+#include "oxygen/simulation/EmulatorInterface.h"
+#include "oxygen/simulation/GameRecorder.h"
+#include "oxygen/simulation/SaveStateSerializer.h"
+#include "oxygen/simulation/SimulationContext.h"
+#include "oxygen/application/input/ControlsIn.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+
+bool ReplayVerifier::verify(const GameRecorder& gameRecorder, LemonScriptProgram& program, size_t maxThreads)
+{
+	mResult = Result();
+
+	std::vector<uint32> keyframeNumbers;
+	gameRecorder.getKeyframeNumbers(keyframeNumbers);
+	if (keyframeNumbers.size() < 2)
+		return false;
+
+	std::vector<Segment>& segments = mResult.mSegments;
+	segments.resize(keyframeNumbers.size() - 1);
+	for (size_t index = 0; index < segments.size(); ++index)
+	{
+		segments[index].mStartFrame = keyframeNumbers[index];
+		segments[index].mEndFrame = keyframeNumbers[index + 1];
+	}
+
+	const size_t numThreads = std::clamp<size_t>((maxThreads > 0) ? maxThreads : std::thread::hardware_concurrency(), 1, segments.size());
+
+	// Simulation contexts get created here, as their construction is not thread-safe
+	std::vector<SimulationContext*> contexts;
+	contexts.reserve(numThreads);
+	for (size_t k = 0; k < numThreads; ++k)
+	{
+		contexts.push_back(new SimulationContext(program));
+	}
+
+	std::atomic<size_t> nextIndex = 0;
+	std::atomic<uint32> framesSimulated = 0;
+	std::mutex loadStateMutex;
+	const auto workerFunc = [&](SimulationContext& context)
+	{
+		std::vector<uint8> stateData;
+		uint16 inputs[2] = { 0, 0 };
+		while (true)
+		{
+			const size_t index = nextIndex++;
+			if (index >= segments.size())
+				break;
+
+			Segment& segment = segments[index];
+			if (!gameRecorder.getKeyframeData(segment.mEndFrame, stateData))
+				continue;
+			const uint8* expectedRam = SaveStateSerializer::getRamInState(stateData);
+			if (nullptr == expectedRam)
+				continue;
+			segment.mExpectedRamHash = rmx::getMurmur2_64(expectedRam, 0x10000);
+
+			if (!gameRecorder.getKeyframeData(segment.mStartFrame, stateData) || !gameRecorder.getFrameInputs(segment.mStartFrame, inputs))
+				continue;
+			{
+				// State loading also resets process-wide debug output like the log display, so only one thread at a time may do this
+				std::lock_guard<std::mutex> lock(loadStateMutex);
+				if (!context.loadState(stateData))
+					continue;
+			}
+
+			// Like in regular playback, the keyframe's inputs become the current ones, so the next frame sees them as previous inputs
+			context.getControlsIn().injectInput(0, inputs[0]);
+			context.getControlsIn().injectInput(1, inputs[1]);
+
+			bool completed = true;
+			for (uint32 frameNumber = segment.mStartFrame + 1; frameNumber <= segment.mEndFrame && completed; ++frameNumber)
+			{
+				completed = gameRecorder.getFrameInputs(frameNumber, inputs) && context.generateFrame(inputs[0], inputs[1]);
+				if (completed)
+					++framesSimulated;
+			}
+			if (!completed)
+				continue;
+
+			segment.mSimulatedRamHash = rmx::getMurmur2_64(context.getEmulatorInterface().getRam(), 0x10000);
+			segment.mSuccess = (segment.mSimulatedRamHash == segment.mExpectedRamHash);
+		}
+	};
+
+	// One task per simulation context, each of them processes segments until none are left
+	{
+		WorkerPool workerPool(numThreads - 1);
+		workerPool.execute(numThreads, [&](size_t taskIndex)
+		{
+			workerFunc(*contexts[taskIndex]);
+		});
+	}
+
+	for (SimulationContext* context : contexts)
+	{
+		delete context;
+	}
+
+	mResult.mFramesSimulated = framesSimulated;
+	for (const Segment& segment : segments)
+	{
+		if (!segment.mSuccess)
+			++mResult.mFailedSegments;
+	}
+	return (mResult.mFailedSegments == 0);
+}
@@ -0,0 +1,46 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include <rmxbase.h>
+
+class GameRecorder;
+class LemonScriptProgram;
+
+
+// Verifies a game recording by splitting it at its keyframes and re-simulating all segments in parallel
+//  -> Each worker thread uses its own simulation context, running the already loaded script program of the main simulation
+//  -> A segment starts at a keyframe and is correct if the RAM contents after simulating up to the next keyframe match those stored there
+class ReplayVerifier
+{
+public:
+	struct Segment
+	{
+		uint32 mStartFrame = 0;			// Frame number of the keyframe the segment starts with
+		uint32 mEndFrame = 0;			// Frame number of the keyframe to compare with
+		bool mSuccess = false;
+		uint64 mExpectedRamHash = 0;
+		uint64 mSimulatedRamHash = 0;
+	};
+
+	struct Result
+	{
+		std::vector<Segment> mSegments;
+		uint32 mFramesSimulated = 0;
+		uint32 mFailedSegments = 0;
+	};
+
+public:
+	bool verify(const GameRecorder& gameRecorder, LemonScriptProgram& program, size_t maxThreads = 0);
+
+	inline const Result& getResult() const  { return mResult; }
+
+private:
+	Result mResult;
+};
@@ -0,0 +1,342 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "oxygen/pch.h"
+#include "oxygen/simulation/RewindBuffer.h"
+
+
+namespace
+{
+	static const constexpr uint16 END_OF_PAGES = 0xffff;
+
+	// Starting from the newest frame is preferred over decoding a keyframe, unless this saves more than this many differences to apply
+	static const constexpr size_t MAX_DELTAS_BEFORE_KEYFRAME_USE = 8;
+
+	inline size_t getPaddedSize(size_t size)
+	{
+		return (size + RewindBuffer::PAGE_SIZE - 1) / RewindBuffer::PAGE_SIZE * RewindBuffer::PAGE_SIZE;
+	}
+
+	bool isAllZeroes(const uint8* data, size_t size)
+	{
+		const uint64* data64 = (const uint64*)data;
+		for (size_t k = 0; k < size / 8; ++k)
+		{
+			if (data64[k] != 0)
+				return false;
+		}
+		return true;
+	}
+}
+
+
+void RewindBuffer::clear()
+{
+	mFrames.clear();
+	mCurrentState.clear();
+	mMemoryUsage = 0;
+	mFramesSinceKeyframe = 0;
+}
+
+void RewindBuffer::setTrackedMemory(const std::vector<TrackedMemory>& trackedMemory)
+{
+	clear();
+	mTrackedMemory = trackedMemory;
+
+	size_t totalSize = 0;
+	for (const TrackedMemory& memory : mTrackedMemory)
+	{
+		RMX_ASSERT(memory.mSize % PAGE_SIZE == 0 && memory.mDirtyPageSize > 0 && memory.mSize % memory.mDirtyPageSize == 0, "Invalid tracked memory setup for the rewind buffer");
+		totalSize += memory.mSize;
+	}
+	mTrackedCopy.resize(totalSize);
+	discardOldFrames();
+}
+
+void RewindBuffer::setMemoryBudget(size_t bytes)
+{
+	mMemoryBudget = bytes;
+	if (mMemoryBudget == 0)
+		clear();
+	else
+		discardOldFrames();
+}
+
+void RewindBuffer::addFrame(uint32 frameNumber, const std::vector<uint8>& state)
+{
+	if (!isEnabled())
+		return;
+
+	// Frame numbers must be increasing, otherwise the history does not fit any more (e.g. after loading a save state)
+	if (!mFrames.empty() && frameNumber <= mFrames.back().mNumber)
+		clear();
+
+	const size_t numTrackedPages = mTrackedCopy.size() / PAGE_SIZE;
+	const size_t paddedSize = getPaddedSize(state.size());
+	RMX_CHECK(numTrackedPages + paddedSize / PAGE_SIZE < END_OF_PAGES, "State is too large for the rewind buffer", return);
+
+	// Both the previous and the new state get padded with zeroes to the same size
+	const size_t combinedSize = std::max(paddedSize, mCurrentState.size());
+	mTempState.resize(combinedSize);
+	if (!state.empty())
+		memcpy(&mTempState[0], &state[0], state.size());
+	memset(mTempState.data() + state.size(), 0, combinedSize - state.size());
+	mCurrentState.resize(combinedSize, 0);
+
+	Frame& frame = mFrames.emplace_back();
+	frame.mNumber = frameNumber;
+	frame.mStateSize = (uint32)state.size();
+	if (mFrames.size() > 1)
+	{
+		// Only the dirty pages of tracked memory can differ, while the state needs to get compared as a whole
+		encodeTrackedMemory(frame.mDelta);
+		encodePages(frame.mDelta, mCurrentState.data(), mTempState.data(), combinedSize / PAGE_SIZE, numTrackedPages);
+		encodeEndOfPages(frame.mDelta);
+		frame.mDelta.shrink_to_fit();
+	}
+	else
+	{
+		// Nothing to compare against, so take over all tracked memory
+		size_t offset = 0;
+		for (const TrackedMemory& memory : mTrackedMemory)
+		{
+			memcpy(&mTrackedCopy[offset], memory.mData, memory.mSize);
+			offset += memory.mSize;
+		}
+	}
+	if (mFrames.size() == 1 || mFramesSinceKeyframe >= KEYFRAME_INTERVAL)
+	{
+		encodePages(frame.mKeyframe, nullptr, mTrackedCopy.data(), numTrackedPages, 0);
+		encodePages(frame.mKeyframe, nullptr, mTempState.data(), paddedSize / PAGE_SIZE, numTrackedPages);
+		encodeEndOfPages(frame.mKeyframe);
+		frame.mKeyframe.shrink_to_fit();
+		mFramesSinceKeyframe = 0;
+	}
+	++mFramesSinceKeyframe;
+
+	mCurrentState.swap(mTempState);
+	mCurrentState.resize(paddedSize);	// Cut off only zeroes here
+	mMemoryUsage += getFrameMemory(frame);
+	discardOldFrames();
+}
+
+bool RewindBuffer::rewindToFrame(uint32 frameNumber, std::vector<uint8>& outState)
+{
+	if (mFrames.empty() || frameNumber < mFrames.front().mNumber || frameNumber > mFrames.back().mNumber)
+		return false;
+
+	const auto it = std::lower_bound(mFrames.begin(), mFrames.end(), frameNumber, [](const Frame& frame, uint32 number) { return frame.mNumber < number; });
+	if (it == mFrames.end() || it->mNumber != frameNumber)
+		return false;
+	const size_t targetIndex = (size_t)(it - mFrames.begin());
+
+	// Go backwards starting from either the newest frame, or a keyframe closer to the target
+	const size_t newestIndex = mFrames.size() - 1;
+	size_t startIndex = newestIndex;
+	for (size_t index = targetIndex; index + MAX_DELTAS_BEFORE_KEYFRAME_USE < newestIndex; ++index)
+	{
+		if (!mFrames[index].mKeyframe.empty())
+		{
+			startIndex = index;
+			break;
+		}
+	}
+
+	bool success = true;
+	if (startIndex != newestIndex)
+	{
+		std::fill(mTrackedCopy.begin(), mTrackedCopy.end(), 0);
+		mCurrentState.assign(getPaddedSize(mFrames[startIndex].mStateSize), 0);
+		success = applyPages(mCurrentState, mFrames[startIndex].mKeyframe);
+	}
+	for (size_t index = startIndex; index > targetIndex && success; --index)
+	{
+		success = applyPages(mCurrentState, mFrames[index].mDelta);
+	}
+	if (!success)
+	{
+		clear();
+		RMX_ERROR("Rewind buffer data is corrupt", return false);
+	}
+
+	// Newer frames are of no use any more
+	while (mFrames.size() > targetIndex + 1)
+	{
+		mMemoryUsage -= getFrameMemory(mFrames.back());
+		mFrames.pop_back();
+	}
+
+	mFramesSinceKeyframe = 0;
+	for (auto rit = mFrames.rbegin(); rit != mFrames.rend(); ++rit)
+	{
+		++mFramesSinceKeyframe;
+		if (!rit->mKeyframe.empty())
+			break;
+	}
+
+	size_t offset = 0;
+	for (const TrackedMemory& memory : mTrackedMemory)
+	{
+		memcpy(memory.mData, &mTrackedCopy[offset], memory.mSize);
+		offset += memory.mSize;
+	}
+
+	const Frame& frame = mFrames.back();
+	mCurrentState.resize(getPaddedSize(frame.mStateSize));
+	outState.assign(mCurrentState.begin(), mCurrentState.begin() + frame.mStateSize);
+	return true;
+}
+
+bool RewindBuffer::encodePage(std::vector<uint8>& output, size_t pageIndex, const uint8* oldPage, const uint8* newPage)
+{
+	// Output is the page index and the run-length encoded XOR difference, and nothing at all for unchanged pages
+	//  -> Control byte values 0x00..0x7f stand for a run of 1..128 zero bytes, values 0x80..0xff for 1..128 literal bytes that follow
+	uint8 difference[PAGE_SIZE];
+	if (nullptr == oldPage)
+	{
+		if (isAllZeroes(newPage, PAGE_SIZE))
+			return false;
+		memcpy(difference, newPage, PAGE_SIZE);
+	}
+	else
+	{
+		if (memcmp(oldPage, newPage, PAGE_SIZE) == 0)
+			return false;
+		for (size_t k = 0; k < PAGE_SIZE; ++k)
+			difference[k] = oldPage[k] ^ newPage[k];
+	}
+
+	output.push_back((uint8)pageIndex);
+	output.push_back((uint8)(pageIndex >> 8));
+
+	size_t position = 0;
+	while (position < PAGE_SIZE)
+	{
+		size_t end = position + 1;
+		if (difference[position] == 0)
+		{
+			while (end < PAGE_SIZE && end - position < 0x80 && difference[end] == 0)
+				++end;
+			output.push_back((uint8)(end - position - 1));
+		}
+		else
+		{
+			// Single zeroes are included in the literal bytes, two or more end them
+			while (end < PAGE_SIZE && end - position < 0x80 && (difference[end] != 0 || (end + 1 < PAGE_SIZE && difference[end + 1] != 0)))
+				++end;
+			output.push_back((uint8)(0x80 + end - position - 1));
+			output.insert(output.end(), &difference[position], &difference[end]);
+		}
+		position = end;
+	}
+	return true;
+}
+
+void RewindBuffer::encodePages(std::vector<uint8>& output, const uint8* oldData, const uint8* newData, size_t numPages, size_t firstPageIndex)
+{
+	for (size_t page = 0; page < numPages; ++page)
+	{
+		encodePage(output, firstPageIndex + page, (nullptr == oldData) ? nullptr : oldData + page * PAGE_SIZE, newData + page * PAGE_SIZE);
+	}
+}
+
+void RewindBuffer::encodeEndOfPages(std::vector<uint8>& output)
+{
+	output.push_back((uint8)END_OF_PAGES);
+	output.push_back((uint8)(END_OF_PAGES >> 8));
+}
+
+void RewindBuffer::encodeTrackedMemory(std::vector<uint8>& output)
+{
+	// Encode the changes of all dirty pages, and update the copy of tracked memory along the way
+	size_t offset = 0;
+	for (const TrackedMemory& memory : mTrackedMemory)
+	{
+		const size_t firstPageIndex = offset / PAGE_SIZE;
+		const size_t numDirtyPages = memory.mSize / memory.mDirtyPageSize;
+		size_t nextPage = 0;	// All pages before this one got handled already
+		for (size_t dirtyPage = 0; dirtyPage < numDirtyPages; ++dirtyPage)
+		{
+			if (0 == memory.mDirtyPages[dirtyPage])
+				continue;
+
+			const size_t start = dirtyPage * memory.mDirtyPageSize;
+			const size_t end = start + memory.mDirtyPageSize;
+			const size_t lastPage = (end - 1) / PAGE_SIZE;
+			for (size_t page = std::max(start / PAGE_SIZE, nextPage); page <= lastPage; ++page)
+			{
+				uint8* copy = &mTrackedCopy[offset + page * PAGE_SIZE];
+				const uint8* data = memory.mData + page * PAGE_SIZE;
+				if (encodePage(output, firstPageIndex + page, copy, data))
+					memcpy(copy, data, PAGE_SIZE);
+			}
+			nextPage = lastPage + 1;
+		}
+		offset += memory.mSize;
+	}
+}
+
+bool RewindBuffer::applyPages(std::vector<uint8>& state, const std::vector<uint8>& encoded)
+{
+	const size_t numTrackedPages = mTrackedCopy.size() / PAGE_SIZE;
+	size_t inputPosition = 0;
+	while (inputPosition + 2 <= encoded.size())
+	{
+		const uint16 page = (uint16)encoded[inputPosition] + ((uint16)encoded[inputPosition + 1] << 8);
+		inputPosition += 2;
+		if (page == END_OF_PAGES)
+			return true;
+
+		uint8* output;
+		if (page < numTrackedPages)
+		{
+			output = &mTrackedCopy[(size_t)page * PAGE_SIZE];
+		}
+		else
+		{
+			const size_t pageStart = (size_t)(page - numTrackedPages) * PAGE_SIZE;
+			if (pageStart + PAGE_SIZE > state.size())
+				state.resize(pageStart + PAGE_SIZE, 0);
+			output = &state[pageStart];
+		}
+
+		size_t position = 0;
+		while (position < PAGE_SIZE)
+		{
+			if (inputPosition >= encoded.size())
+				return false;
+
+			const uint8 control = encoded[inputPosition];
+			++inputPosition;
+			const size_t length = (size_t)(control & 0x7f) + 1;
+			if (position + length > PAGE_SIZE)
+				return false;
+
+			if (control & 0x80)
+			{
+				if (inputPosition + length > encoded.size())
+					return false;
+				for (size_t k = 0; k < length; ++k)
+					output[position + k] ^= encoded[inputPosition + k];
+				inputPosition += length;
+			}
+			position += length;
+		}
+	}
+	return false;
+}
+
+void RewindBuffer::discardOldFrames()
+{
+	// Always keep at least the newest frame
+	while (mFrames.size() > 1 && mMemoryUsage + mCurrentState.capacity() + mTrackedCopy.capacity() > mMemoryBudget)
+	{
+		mMemoryUsage -= getFrameMemory(mFrames.front());
+		mFrames.pop_front();
+	}
+}
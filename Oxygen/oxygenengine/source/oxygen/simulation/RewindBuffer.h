@@ -0,0 +1,83 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include <rmxbase.h>
+
+
+// In-memory history of serialized save states, one per simulated frame, used for rewinding
+//  -> Each frame only stores the XOR difference to the previous frame's state, for the 256-byte pages that actually changed, with runs of zeroes compressed
+//  -> As XOR is symmetric, that same difference brings back the previous state when going backwards from the newest state
+//  -> Full keyframes in regular intervals limit the number of differences to apply when going back a longer way
+//  -> Large memory blocks with dirty page tracking are not part of the serialized state, and only their dirty pages get compared
+class RewindBuffer
+{
+public:
+	static const constexpr size_t PAGE_SIZE = 0x100;
+	static const constexpr uint32 KEYFRAME_INTERVAL = 300;
+
+	struct TrackedMemory
+	{
+		uint8* mData = nullptr;					// Gets written back when rewinding
+		size_t mSize = 0;						// In bytes, must be a multiple of PAGE_SIZE
+		const uint8* mDirtyPages = nullptr;		// One byte per dirty page, non-zero if the page was written to since the last added frame
+		size_t mDirtyPageSize = 0;				// In bytes, size of memory covered by each dirty page flag
+	};
+
+public:
+	void clear();
+
+	void setTrackedMemory(const std::vector<TrackedMemory>& trackedMemory);
+
+	inline bool isEnabled() const  { return mMemoryBudget > 0; }
+	inline size_t getMemoryBudget() const  { return mMemoryBudget; }
+	void setMemoryBudget(size_t bytes);
+	inline size_t getMemoryUsage() const  { return mMemoryUsage; }
+
+	inline bool empty() const  { return mFrames.empty(); }
+	inline size_t getNumberOfFrames() const  { return mFrames.size(); }
+	inline uint32 getOldestFrameNumber() const  { return mFrames.empty() ? 0 : mFrames.front().mNumber; }
+	inline uint32 getNewestFrameNumber() const  { return mFrames.empty() ? 0 : mFrames.back().mNumber; }
+
+	// Expects the serialized state without the tracked memory; the caller has to reset the dirty page flags afterwards
+	void addFrame(uint32 frameNumber, const std::vector<uint8>& state);
+
+	// Reconstructs the state of the given frame and discards all newer frames, so that it becomes the newest one
+	//  -> Tracked memory contents get restored directly, the output state is the serialized rest
+	bool rewindToFrame(uint32 frameNumber, std::vector<uint8>& outState);
+
+private:
+	struct Frame
+	{
+		uint32 mNumber = 0;
+		uint32 mStateSize = 0;			// Size of this frame's state in bytes
+		std::vector<uint8> mDelta;		// Encoded XOR difference to the previous frame's state; empty if there's no difference or no previous frame
+		std::vector<uint8> mKeyframe;	// Encoded full state, for keyframes only
+	};
+
+private:
+	static bool encodePage(std::vector<uint8>& output, size_t pageIndex, const uint8* oldPage, const uint8* newPage);
+	static void encodePages(std::vector<uint8>& output, const uint8* oldData, const uint8* newData, size_t numPages, size_t firstPageIndex);
+	static void encodeEndOfPages(std::vector<uint8>& output);
+	void encodeTrackedMemory(std::vector<uint8>& output);
+	bool applyPages(std::vector<uint8>& state, const std::vector<uint8>& encoded);
+
+	static inline size_t getFrameMemory(const Frame& frame)  { return sizeof(Frame) + frame.mDelta.capacity() + frame.mKeyframe.capacity(); }
+	void discardOldFrames();
+
+private:
+	std::deque<Frame> mFrames;
+	std::vector<TrackedMemory> mTrackedMemory;
+	std::vector<uint8> mTrackedCopy;	// Contents of all tracked memory at the newest frame; its pages come first in the page numbering, followed by the state's pages
+	std::vector<uint8> mCurrentState;	// State of the newest frame, padded with zeroes to a multiple of the page size
+	std::vector<uint8> mTempState;
+	size_t mMemoryBudget = 0;
+	size_t mMemoryUsage = 0;			// Memory used by frames, excluding the current state
+	uint32 mFramesSinceKeyframe = 0;
+};
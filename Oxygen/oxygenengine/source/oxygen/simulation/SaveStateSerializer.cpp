@@ -77,6 +77,33 @@ bool SaveStateSerializer::saveState(const std::wstring& filename)
 	return FTX::FileSystem->saveFile(filename, state);
 }
 
+bool SaveStateSerializer::loadStateWithoutMemory(const std::vector<uint8>& input)
+{
+	mSkipMemory = true;
+	const bool success = loadState(input);
+	mSkipMemory = false;
+	return success;
+}
+
+bool SaveStateSerializer::saveStateWithoutMemory(std::vector<uint8>& output)
+{
+	mSkipMemory = true;
+	const bool success = saveState(output);
+	mSkipMemory = false;
+	return success;
+}
+
+const uint8* SaveStateSerializer::getRamInState(const std::vector<uint8>& stateData)
+{
+	// Only standalone states are supported, these start with the signature and the registers, followed by the RAM
+	const size_t ramOffset = 16 + 16 * sizeof(uint32);
+	if (stateData.size() < ramOffset + 0x10000)
+		return nullptr;
+	if (memcmp(&stateData[0], "AIR Standalone", 15) != 0 && memcmp(&stateData[0], "Oxygen_State__", 15) != 0)
+		return nullptr;
+	return &stateData[ramOffset];
+}
+
 bool SaveStateSerializer::serializeState(VectorBinarySerializer& serializer, StateType& stateType)
 {
 	EmulatorInterface& emulatorInterface = mCodeExec.getEmulatorInterface();
@@ -119,6 +146,14 @@ bool SaveStateSerializer::serializeState(VectorBinarySerializer& serializer, Sta
 	{
 		const uint8 formatVersion = signature[15];
 
+		// Check the size of registers, RAM and VRAM before anything gets overwritten
+		if (serializer.isReading())
+		{
+			const size_t minimumSize = 16 * sizeof(uint32) + (mSkipMemory ? 0 : 0x10000) + 0x10000;
+			if (serializer.getRemaining() < minimumSize)
+				return false;
+		}
+
 		// Registers
 		for (size_t i = 0; i < 16; ++i)
 		{
@@ -126,13 +161,31 @@ bool SaveStateSerializer::serializeState(VectorBinarySerializer& serializer, Sta
 		}
 
 		// RAM and VRAM
-		serializer.serialize(emulatorInterface.getRam(), 0x10000);
-		serializer.serialize(emulatorInterface.getVRam(), 0x10000);
+		if (!mSkipMemory)
+			serializer.serialize(emulatorInterface.getRam(), 0x10000);
 		if (serializer.isReading())
-			emulatorInterface.getVRamChangeBits().setAllBits();
+		{
+			// Mark only those VRAM patterns as changed that actually differ
+			//  -> Loading a similar state (like for a rollback by a few frames) then does not invalidate the whole pattern cache
+			const uint8* oldVRam = emulatorInterface.getVRam();
+			const uint8* newVRam = serializer.getBufferPointer(serializer.getReadPosition());
+			BitArray<0x800>& changeBits = emulatorInterface.getVRamChangeBits();
+			for (size_t index = 0; index < 0x800; ++index)
+			{
+				if (memcmp(&oldVRam[index * 0x20], &newVRam[index * 0x20], 0x20) != 0)
+					changeBits.setBit(index);
+			}
+			if (!mSkipMemory)
+				emulatorInterface.setAllPagesDirty();
+		}
+		serializer.serialize(emulatorInterface.getVRam(), 0x10000);
 
 		// Shared memory
-		if (formatVersion >= 3)
+		if (mSkipMemory)
+		{
+			// Nothing to do here
+		}
+		else if (formatVersion >= 3)
 		{
 			if (serializer.isReading())
 			{
@@ -271,6 +324,7 @@ bool SaveStateSerializer::readGensxState(VectorBinarySerializer& serializer)
 		ram[i] = ram[i+1];
 		ram[i+1] = tmp;
 	}
+	emulatorInterface.setAllPagesDirty();
 
 	memset(emulatorInterface.getSharedMemory(), 0, 0x100000);
 
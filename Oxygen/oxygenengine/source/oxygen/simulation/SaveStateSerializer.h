@@ -33,6 +33,13 @@ public:
 	bool saveState(std::vector<uint8>& output);
 	bool saveState(const std::wstring& filename);
 
+	// Variants that leave out RAM and shared memory, for users that keep track of these themselves (like the rewind buffer)
+	bool loadStateWithoutMemory(const std::vector<uint8>& input);
+	bool saveStateWithoutMemory(std::vector<uint8>& output);
+
+	// Returns the RAM contents inside of serialized state data without loading it, or a null pointer if that's not possible
+	static const uint8* getRamInState(const std::vector<uint8>& stateData);
+
 private:
 	bool serializeState(VectorBinarySerializer& serializer, StateType& stateType);
 	bool readGensxState(VectorBinarySerializer& serializer);
@@ -40,4 +47,5 @@ private:
 private:
 	CodeExec& mCodeExec;
 	RenderParts& mRenderParts;
+	bool mSkipMemory = false;
 };
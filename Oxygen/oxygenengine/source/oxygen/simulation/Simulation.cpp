@@ -22,13 +22,15 @@
 #include "oxygen/rendering/parts/RenderParts.h"
 #include "oxygen/simulation/GameRecorder.h"
 #include "oxygen/simulation/LogDisplay.h"
+#include "oxygen/simulation/RewindBuffer.h"
 #include "oxygen/simulation/analyse/ROMDataAnalyser.h"
 
 
 Simulation::Simulation() :
 	mCodeExec(*new CodeExec()),
 	mGameRecorder(*new GameRecorder()),
-	mInputRecorder(*new InputRecorder())
+	mInputRecorder(*new InputRecorder()),
+	mRewindBuffer(*new RewindBuffer())
 {
 	if (EngineMain::getDelegate().useDeveloperFeatures())
 	{
@@ -41,6 +43,7 @@ Simulation::~Simulation()
 	delete &mCodeExec;
 	delete &mGameRecorder;
 	delete &mInputRecorder;
+	delete &mRewindBuffer;
 	delete mROMDataAnalyser;
 }
 
@@ -51,6 +54,10 @@ bool Simulation::startup()
 	RMX_LOG_INFO("Setup of EmulatorInterface");
 	mCodeExec.startup();
 
+	// The rewind buffer relies on dirty page tracking, which needs to be enabled before any runtime functions get built
+	EmulatorInterface& emulatorInterface = mCodeExec.getEmulatorInterface();
+	emulatorInterface.setDirtyPageTrackingEnabled(config.mRewindMemoryBudget > 0);
+
 	// Load scripts
 	RMX_LOG_INFO("Loading scripts");
 	bool success = mCodeExec.reloadScripts(true, false);	// Note: First parameter could just as well be set to false
@@ -69,6 +76,21 @@ bool Simulation::startup()
 	}
 	RMX_LOG_INFO("Runtime environment ready");
 
+	mRewindBuffer.setMemoryBudget((size_t)std::max(config.mRewindMemoryBudget, 0) * 0x100000);
+	if (mRewindBuffer.isEnabled())
+	{
+		std::vector<RewindBuffer::TrackedMemory> trackedMemory(2);
+		trackedMemory[0].mData = emulatorInterface.getRam();
+		trackedMemory[0].mSize = 0x10000;
+		trackedMemory[0].mDirtyPages = emulatorInterface.getRamDirtyPages();
+		trackedMemory[0].mDirtyPageSize = emulatorInterface.getDirtyPageSize();
+		trackedMemory[1].mData = emulatorInterface.getSharedMemory();
+		trackedMemory[1].mSize = 0x100000;
+		trackedMemory[1].mDirtyPages = emulatorInterface.getSharedMemoryDirtyPages();
+		trackedMemory[1].mDirtyPageSize = emulatorInterface.getDirtyPageSize();
+		mRewindBuffer.setTrackedMemory(trackedMemory);
+	}
+
 	if (EngineMain::getDelegate().useDeveloperFeatures())
 	{
 		// Startup input recorder
@@ -77,8 +99,15 @@ bool Simulation::startup()
 
 	if (config.mGameRecorder.mIsPlayback)
 	{
+		if (!config.mGameRecorder.mPlaybackFilename.empty())
+		{
+			if (mGameRecorder.loadRecording(config.mGameRecorder.mPlaybackFilename))
+			{
+				RMX_LOG_INFO("Playback of '" << WString(config.mGameRecorder.mPlaybackFilename).toStdString() << "'");
+			}
+		}
 		// Try the long and short name
-		if (mGameRecorder.loadRecording(L"gamerecording.bin"))
+		else if (mGameRecorder.loadRecording(L"gamerecording.bin"))
 		{
 			RMX_LOG_INFO("Playback of 'gamerecording.bin'");
 		}
@@ -90,7 +119,12 @@ bool Simulation::startup()
 		if (mGameRecorder.isPlaying())
 		{
 			mGameRecorder.setIgnoreKeys(config.mGameRecorder.mPlaybackIgnoreKeys);
-			mFastForwardTarget = config.mGameRecorder.mPlaybackStartFrame;
+			mFastForwardTarget = (uint32)std::max(config.mGameRecorder.mPlaybackStartFrame, 0);
+			if (!config.mGameRecorder.mPlaybackIgnoreKeys)
+			{
+				// Start right at the last keyframe before the start frame, so only the frames after that need to be simulated
+				mFrameNumber = mGameRecorder.seekPlayback(mFastForwardTarget);
+			}
 			config.setSettingsReadOnly(true);	// Do not overwrite settings
 		}
 	}
@@ -103,6 +137,13 @@ void Simulation::shutdown()
 	RMX_LOG_INFO("Simulation shutdown");
 	mInputRecorder.shutdown();
 
+	if (Configuration::instance().mLazyScriptFunctionBuilding && !EngineMain::instance().isHeadless())
+	{
+		// Remember which script functions were needed, so they can get built in advance next time
+		//  -> Not for headless runs, as these only replay recordings and should not affect the next interactive session
+		mCodeExec.getLemonScriptRuntime().saveHotFunctionsProfile();
+	}
+
 	mIsRunning = false;
 }
 
@@ -133,6 +174,7 @@ void Simulation::resetIntoGame(const std::vector<std::pair<std::string, std::str
 	// Reset code execution
 	mCodeExec.reset();
 	mStateLoaded.clear();
+	mRewindBuffer.clear();
 
 	// Reload and initialize scripts as needed
 	if (mCodeExec.reloadScripts(false, false))
@@ -191,6 +233,7 @@ bool Simulation::loadState(const std::wstring& filename, bool showError)
 	}
 
 	mStateLoaded = filename;
+	mRewindBuffer.clear();
 	mCodeExec.reinitRuntime(nullptr, (stateType == SaveStateSerializer::StateType::GENSX) ? CodeExec::CallStackInitPolicy::READ_FROM_ASM : CodeExec::CallStackInitPolicy::USE_EXISTING);
 	return true;
 }
@@ -210,6 +253,113 @@ void Simulation::saveState(const std::wstring& filename)
 	mStateLoaded = filename;
 }
 
+bool Simulation::rewindFrames(uint32 numFrames)
+{
+	if (mRewindBuffer.empty())
+		return false;
+
+	const uint32 newestFrame = mRewindBuffer.getNewestFrameNumber();
+	const uint32 targetFrame = std::max(mRewindBuffer.getOldestFrameNumber(), (newestFrame >= numFrames) ? (newestFrame - numFrames) : 0);
+
+	// This restores RAM and shared memory directly, and returns the rest of the state
+	if (!mRewindBuffer.rewindToFrame(targetFrame, mRewindStateData))
+		return false;
+
+	SaveStateSerializer serializer(mCodeExec, RenderParts::instance());
+	if (!serializer.loadStateWithoutMemory(mRewindStateData))
+		return false;
+	mCodeExec.getEmulatorInterface().clearDirtyPages();
+
+	mCodeExec.reinitRuntime(nullptr, CodeExec::CallStackInitPolicy::USE_EXISTING);
+	discardRecordedFrames(newestFrame - targetFrame);
+	mFrameNumber = targetFrame;
+	return true;
+}
+
+bool Simulation::saveSnapshot(Snapshot& outSnapshot)
+{
+	if (!mCodeExec.willBeginNewFrame())
+		return false;
+
+	outSnapshot.mFrameNumber = mFrameNumber;
+	outSnapshot.mData.clear();
+
+	SaveStateSerializer serializer(mCodeExec, RenderParts::instance());
+	return serializer.saveState(outSnapshot.mData);
+}
+
+bool Simulation::restoreSnapshot(const Snapshot& snapshot)
+{
+	if (!mCodeExec.willBeginNewFrame())
+		return false;
+
+	// If the rewind buffer still has the snapshot's frame, go the same way as "rewindFrames": this restores only the changed memory pages and keeps the rewind history
+	//  -> Otherwise load the full snapshot, and start the rewind history anew
+	SaveStateSerializer serializer(mCodeExec, RenderParts::instance());
+	if (mRewindBuffer.isEnabled() && mRewindBuffer.rewindToFrame(snapshot.mFrameNumber, mRewindStateData))
+	{
+		if (!serializer.loadStateWithoutMemory(mRewindStateData))
+			return false;
+		mCodeExec.getEmulatorInterface().clearDirtyPages();
+	}
+	else
+	{
+		mRewindBuffer.clear();
+		if (!serializer.loadState(snapshot.mData))
+			return false;
+	}
+
+	// The call stack was part of the snapshot, so the runtime is good to go
+	mCodeExec.reinitRuntime(nullptr, CodeExec::CallStackInitPolicy::USE_EXISTING);
+	discardRecordedFrames((mFrameNumber > snapshot.mFrameNumber) ? (mFrameNumber - snapshot.mFrameNumber) : 0);
+	mFrameNumber = snapshot.mFrameNumber;
+	return true;
+}
+
+bool Simulation::resimulateFrames(const uint16* inputPads, uint32 numFrames)
+{
+	// This is a reduced version of "generateFrame" without audio updates
+	//  -> Nothing gets rendered for these frames, as video output only renders the last completed frame
+	//  -> Starting new audio is muted, as the sounds of these frames already got played when they were simulated the first time
+	ControlsIn& controlsIn = ControlsIn::instance();
+	AudioOutBase& audioOut = EngineMain::instance().getAudioOut();
+	audioOut.setMuted(true);
+
+	bool success = true;
+	for (uint32 frame = 0; frame < numFrames; ++frame)
+	{
+		if (!mCodeExec.willBeginNewFrame())
+		{
+			success = false;
+			break;
+		}
+
+		EngineMain::getDelegate().onPreFrameUpdate();
+		VideoOut::instance().preFrameUpdate();
+
+		controlsIn.injectInput(0, inputPads[frame * 2]);
+		controlsIn.injectInput(1, inputPads[frame * 2 + 1]);
+		controlsIn.update(false);
+		EngineMain::getDelegate().onControlsUpdate();
+
+		if (!mCodeExec.performFrameUpdate())
+		{
+			success = false;
+			break;
+		}
+
+		EngineMain::getDelegate().onPostFrameUpdate();
+		VideoOut::instance().postFrameUpdate();
+
+		updateGameRecording();
+		++mFrameNumber;
+		updateRewindBuffer();
+	}
+
+	audioOut.setMuted(false);
+	return success && mCodeExec.isCodeExecutionPossible();
+}
+
 bool Simulation::triggerFullScriptsReload()
 {
 	if (mCodeExec.reloadScripts(true, true))
@@ -319,7 +469,6 @@ bool Simulation::generateFrame()
 {
 	ControlsIn& controlsIn = ControlsIn::instance();
 	const bool isGameRecorderPlayback = Configuration::instance().mGameRecorder.mIsPlayback;
-	const bool isGameRecorderRecording = Configuration::instance().mGameRecorder.mIsRecording;
 
 	const bool beginningNewFrame = (mCodeExec.willBeginNewFrame() || isGameRecorderPlayback);
 	const float tickLength = 1.0f / getSimulationFrequency();
@@ -350,6 +499,7 @@ bool Simulation::generateFrame()
 					const bool success = serializer.loadState(*result.mData, &stateType);
 					if (success)
 					{
+						mRewindBuffer.clear();
 						mCodeExec.reinitRuntime(nullptr, (stateType == SaveStateSerializer::StateType::GENSX) ? CodeExec::CallStackInitPolicy::READ_FROM_ASM : CodeExec::CallStackInitPolicy::USE_EXISTING);
 						completedCurrentFrame = true;
 					}
@@ -401,7 +551,10 @@ bool Simulation::generateFrame()
 		VideoOut::instance().postFrameUpdate();
 
 		// Update audio
-		EngineMain::instance().getAudioOut().update(tickLength);
+		if (!EngineMain::instance().isHeadless())
+		{
+			EngineMain::instance().getAudioOut().update(tickLength);
+		}
 
 		if (EngineMain::getDelegate().useDeveloperFeatures())
 		{
@@ -416,31 +569,12 @@ bool Simulation::generateFrame()
 		}
 
 		// Update game recording
-		if (isGameRecorderRecording)
-		{
-			InputRecorder::InputState inputState;
-			inputState.mInputFlags[0] = controlsIn.getInputPad(0);
-			inputState.mInputFlags[1] = controlsIn.getInputPad(1);
-
-			if ((mGameRecorder.getRangeEnd() % 180) == 0)	// Keyframe every 3 seconds
-			{
-				static std::vector<uint8> data;
-				data.reserve(0x128000);
-				data.clear();
-
-				SaveStateSerializer serializer(mCodeExec, RenderParts::instance());
-				serializer.saveState(data);
-
-				mGameRecorder.addKeyFrame(inputState.mInputFlags, data);
-				mGameRecorder.discardOldFrames(1800);
-			}
-			else
-			{
-				mGameRecorder.addFrame(inputState.mInputFlags);
-			}
-		}
+		updateGameRecording();
 
 		++mFrameNumber;
+
+		// Update rewind buffer
+		updateRewindBuffer();
 	}
 
 	// Return false if frame got interrupted
@@ -449,6 +583,58 @@ bool Simulation::generateFrame()
 	return (completedCurrentFrame && mCodeExec.isCodeExecutionPossible());
 }
 
+void Simulation::updateGameRecording()
+{
+	if (!Configuration::instance().mGameRecorder.mIsRecording)
+		return;
+
+	const ControlsIn& controlsIn = ControlsIn::instance();
+	InputRecorder::InputState inputState;
+	inputState.mInputFlags[0] = controlsIn.getInputPad(0);
+	inputState.mInputFlags[1] = controlsIn.getInputPad(1);
+
+	if ((mGameRecorder.getRangeEnd() % 180) == 0)	// Keyframe every 3 seconds
+	{
+		static std::vector<uint8> data;
+		data.reserve(0x128000);
+		data.clear();
+
+		SaveStateSerializer serializer(mCodeExec, RenderParts::instance());
+		serializer.saveState(data);
+
+		mGameRecorder.addKeyFrame(inputState.mInputFlags, data);
+		mGameRecorder.discardOldFrames(1800);
+	}
+	else
+	{
+		mGameRecorder.addFrame(inputState.mInputFlags);
+	}
+}
+
+void Simulation::discardRecordedFrames(uint32 numFrames)
+{
+	// When going back in time, an active game recording has to continue from there as well
+	if (!Configuration::instance().mGameRecorder.mIsRecording)
+		return;
+
+	numFrames = std::min(numFrames, mGameRecorder.getRangeEnd());
+	mGameRecorder.discardNewFrames(mGameRecorder.getRangeEnd() - numFrames);
+}
+
+void Simulation::updateRewindBuffer()
+{
+	if (!mRewindBuffer.isEnabled())
+		return;
+
+	// RAM and shared memory are not part of the state here, as the rewind buffer gets their changes from the dirty pages
+	mRewindStateData.clear();
+	SaveStateSerializer serializer(mCodeExec, RenderParts::instance());
+	serializer.saveStateWithoutMemory(mRewindStateData);
+
+	mRewindBuffer.addFrame(mFrameNumber, mRewindStateData);
+	mCodeExec.getEmulatorInterface().clearDirtyPages();
+}
+
 float Simulation::getSimulationFrequency() const
 {
 	return (mSimulationFrequencyOverride > 0.0f) ? mSimulationFrequencyOverride : (float)Configuration::instance().mSimulationFrequency;
@@ -14,11 +14,20 @@ class EmulatorInterface;
 class CodeExec;
 class GameRecorder;
 class InputRecorder;
+class RewindBuffer;
 class ROMDataAnalyser;
 
 
 class Simulation
 {
+public:
+	// Simulation state at a frame boundary, for rollback
+	struct Snapshot
+	{
+		uint32 mFrameNumber = 0;
+		std::vector<uint8> mData;
+	};
+
 public:
 	Simulation();
 	~Simulation();
@@ -32,6 +41,8 @@ public:
 	inline void setRunning(bool running)  { mIsRunning = running; }
 
 	CodeExec& getCodeExec()				  { return mCodeExec; }
+	GameRecorder& getGameRecorder()		  { return mGameRecorder; }
+	RewindBuffer& getRewindBuffer()		  { return mRewindBuffer; }
 	ROMDataAnalyser* getROMDataAnalyser() { return mROMDataAnalyser; }
 
 	void resetState();
@@ -41,6 +52,13 @@ public:
 	void reloadLastState();
 	bool loadState(const std::wstring& filename, bool showError = true);
 	void saveState(const std::wstring& filename);
+	bool rewindFrames(uint32 numFrames);
+
+	// Rollback support: Go back to a snapshot, then simulate the frames since then again with corrected inputs
+	//  -> Only possible between frames, as the script call stack can't be restored in the middle of a frame
+	bool saveSnapshot(Snapshot& outSnapshot);
+	bool restoreSnapshot(const Snapshot& snapshot);
+	bool resimulateFrames(const uint16* inputPads, uint32 numFrames);	// Expects two input pads (for player 1 and 2) per frame
 
 	bool triggerFullScriptsReload();
 
@@ -64,10 +82,16 @@ public:
 
 	uint32 saveGameRecording(WString* outFilename = nullptr);
 
+private:
+	void updateGameRecording();
+	void discardRecordedFrames(uint32 numFrames);
+	void updateRewindBuffer();
+
 private:
 	CodeExec& mCodeExec;
 	GameRecorder& mGameRecorder;
 	InputRecorder& mInputRecorder;
+	RewindBuffer& mRewindBuffer;
 	ROMDataAnalyser* mROMDataAnalyser = nullptr;
 
 	bool	mIsRunning = false;
@@ -82,4 +106,5 @@ private:
 	uint32	mLastCorrectionFrame = 0;
 
 	std::wstring mStateLoaded;
+	std::vector<uint8> mRewindStateData;	// Serialized state without RAM and shared memory, for the rewind buffer
 };
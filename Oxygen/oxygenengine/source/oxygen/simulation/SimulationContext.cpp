@@ -0,0 +1,178 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "oxygen/pch.h"
+#include "oxygen/simulation/SimulationContext.h"
+#include "oxygen/simulation/CodeExec.h"
+#include "oxygen/simulation/EmulatorInterface.h"
+#include "oxygen/simulation/SaveStateSerializer.h"
+#include "oxygen/application/EngineMain.h"
+#include "oxygen/application/audio/AudioOutBase.h"
+#include "oxygen/application/input/ControlsIn.h"
+#include "oxygen/rendering/parts/RenderParts.h"
+
+
+thread_local SimulationContext* SimulationContext::mBoundContext = nullptr;
+
+
+SimulationContext::SimulationContext(LemonScriptProgram& sharedProgram) :
+	mCodeExec(*new CodeExec(sharedProgram)),
+	mRenderParts(*new RenderParts()),
+	mControlsIn(*new ControlsIn())
+{
+}
+
+SimulationContext::~SimulationContext()
+{
+	delete &mControlsIn;
+	delete &mRenderParts;
+	delete &mCodeExec;
+}
+
+EmulatorInterface& SimulationContext::getEmulatorInterface()
+{
+	return mCodeExec.getEmulatorInterface();
+}
+
+LemonScriptRuntime& SimulationContext::getLemonScriptRuntime()
+{
+	return mCodeExec.getLemonScriptRuntime();
+}
+
+void SimulationContext::bindToCurrentThread()
+{
+	EmulatorInterface::setThreadInstance(&mCodeExec.getEmulatorInterface());
+	RenderParts::setThreadInstance(&mRenderParts);
+	ControlsIn::setThreadInstance(&mControlsIn);
+	mBoundContext = this;
+}
+
+void SimulationContext::unbindFromCurrentThread()
+{
+	EmulatorInterface::setThreadInstance(nullptr);
+	RenderParts::setThreadInstance(nullptr);
+	ControlsIn::setThreadInstance(nullptr);
+	mBoundContext = nullptr;
+}
+
+bool SimulationContext::playAudio(uint64 sfxId, uint8 contextId)
+{
+	// The audio collection is only read here, and does not change while simulation contexts are in use
+	const AudioCollection::SourceRegistration* sourceReg = EngineMain::instance().getAudioOut().getAudioCollection().getSourceRegistration(sfxId);
+	if (nullptr == sourceReg)
+		return false;
+
+	// Same as in "AudioPlayer::playAudioInternal", continuous emulation audio does not replace what's playing in its channel
+	return startAudio(sfxId, contextId, sourceReg->mAudioDefinition->mChannel, sourceReg->mType != AudioCollection::SourceRegistration::Type::EMULATION_CONTINUOUS);
+}
+
+bool SimulationContext::playOverride(uint64 sfxId, uint8 contextId, uint8 channelId)
+{
+	const AudioCollection::SourceRegistration* sourceReg = EngineMain::instance().getAudioOut().getAudioCollection().getSourceRegistration(sfxId);
+	if (nullptr == sourceReg)
+		return false;
+
+	return startAudio(sfxId, contextId, channelId, sourceReg->mType != AudioCollection::SourceRegistration::Type::EMULATION_CONTINUOUS);
+}
+
+void SimulationContext::stopChannel(uint8 channelId)
+{
+	for (size_t i = 0; i < mPlayingAudio.size(); ++i)
+	{
+		if (mPlayingAudio[i].mChannelId == channelId)
+		{
+			mPlayingAudio.erase(mPlayingAudio.begin() + i);
+			--i;
+		}
+	}
+}
+
+bool SimulationContext::isPlayingAudio(uint64 sfxId) const
+{
+	for (const PlayingAudio& playingAudio : mPlayingAudio)
+	{
+		if (playingAudio.mSfxId == sfxId)
+			return true;
+	}
+	return false;
+}
+
+void SimulationContext::resetIntoGame(const std::vector<std::pair<std::string, std::string>>* enforcedCallStack)
+{
+	bindToCurrentThread();
+	mRenderParts.reset();
+	mPlayingAudio.clear();
+	mCodeExec.reset();
+	mCodeExec.reinitRuntime(enforcedCallStack, CodeExec::CallStackInitPolicy::RESET);
+	mFrameNumber = 0;
+	unbindFromCurrentThread();
+}
+
+bool SimulationContext::loadState(const std::vector<uint8>& stateData)
+{
+	bindToCurrentThread();
+	mRenderParts.reset();
+	mPlayingAudio.clear();
+
+	SaveStateSerializer::StateType stateType;
+	SaveStateSerializer serializer(mCodeExec, mRenderParts);
+	const bool success = serializer.loadState(stateData, &stateType);
+	if (success)
+	{
+		mCodeExec.reinitRuntime(nullptr, (stateType == SaveStateSerializer::StateType::GENSX) ? CodeExec::CallStackInitPolicy::READ_FROM_ASM : CodeExec::CallStackInitPolicy::USE_EXISTING);
+	}
+	unbindFromCurrentThread();
+	return success;
+}
+
+bool SimulationContext::generateFrame(uint16 inputPad0, uint16 inputPad1)
+{
+	bindToCurrentThread();
+	mRenderParts.preFrameUpdate();
+
+	mControlsIn.injectInput(0, inputPad0);
+	mControlsIn.injectInput(1, inputPad1);
+	mControlsIn.update(false);
+
+	const bool completedFrame = mCodeExec.performFrameUpdate();
+	if (completedFrame)
+	{
+		mRenderParts.postFrameUpdate();
+
+		// There's no rendering, but sprites etc. still need to be processed
+		RefreshParameters refreshParameters;
+		refreshParameters.mSkipThisFrame = true;
+		mRenderParts.refresh(refreshParameters);
+		++mFrameNumber;
+	}
+
+	unbindFromCurrentThread();
+	return completedFrame;
+}
+
+bool SimulationContext::startAudio(uint64 sfxId, uint8 contextId, uint8 channelId, bool replaceInChannel)
+{
+	if (channelId == 0xff)
+		return true;
+
+	for (size_t i = 0; i < mPlayingAudio.size(); ++i)
+	{
+		const PlayingAudio& playingAudio = mPlayingAudio[i];
+		if (playingAudio.mChannelId == channelId && playingAudio.mContextId == contextId && (replaceInChannel || playingAudio.mSfxId == sfxId))
+		{
+			mPlayingAudio.erase(mPlayingAudio.begin() + i);
+			--i;
+		}
+	}
+
+	PlayingAudio& playingAudio = vectorAdd(mPlayingAudio);
+	playingAudio.mSfxId = sfxId;
+	playingAudio.mContextId = contextId;
+	playingAudio.mChannelId = channelId;
+	return true;
+}
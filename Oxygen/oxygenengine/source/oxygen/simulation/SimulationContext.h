@@ -0,0 +1,75 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include <rmxbase.h>
+
+class CodeExec;
+class ControlsIn;
+class EmulatorInterface;
+class LemonScriptProgram;
+class LemonScriptRuntime;
+class RenderParts;
+
+
+// An additional simulation instance next to the main simulation, with its own emulator memory, script runtime, render parts and controller input
+//  -> Read-only data like the compiled script program, the ROM and the resource caches are shared with the main simulation
+//  -> Frames can be generated on a different thread, but setup (construction, reset, state loading) is meant to be done on the main thread
+class SimulationContext
+{
+public:
+	explicit SimulationContext(LemonScriptProgram& sharedProgram);
+	~SimulationContext();
+
+	inline CodeExec& getCodeExec()		  { return mCodeExec; }
+	inline RenderParts& getRenderParts()  { return mRenderParts; }
+	inline ControlsIn& getControlsIn()	  { return mControlsIn; }
+	EmulatorInterface& getEmulatorInterface();
+	LemonScriptRuntime& getLemonScriptRuntime();
+
+	// Make this the instance that script bindings on the calling thread operate on
+	void bindToCurrentThread();
+	static void unbindFromCurrentThread();
+	inline static SimulationContext* getBoundContext()  { return mBoundContext; }
+
+	// Audio state for script queries, as audio output is process-wide and only used by the main simulation
+	//  -> Nothing gets played here, but "isPlayingAudio" reports the sounds started by this context's scripts
+	//  -> A sound counts as playing until it gets replaced in its channel and context, or its channel gets stopped or faded out
+	//  -> Sounds without a channel are not tracked, as there's no playback that could tell when they end
+	bool playAudio(uint64 sfxId, uint8 contextId);
+	bool playOverride(uint64 sfxId, uint8 contextId, uint8 channelId);
+	void stopChannel(uint8 channelId);
+	bool isPlayingAudio(uint64 sfxId) const;
+
+	void resetIntoGame(const std::vector<std::pair<std::string, std::string>>* enforcedCallStack);
+	bool loadState(const std::vector<uint8>& stateData);
+
+	inline uint32 getFrameNumber() const  { return mFrameNumber; }
+	bool generateFrame(uint16 inputPad0, uint16 inputPad1);
+
+private:
+	struct PlayingAudio
+	{
+		uint64 mSfxId = 0;
+		uint8 mContextId = 0;
+		uint8 mChannelId = 0;
+	};
+
+private:
+	bool startAudio(uint64 sfxId, uint8 contextId, uint8 channelId, bool replaceInChannel);
+
+private:
+	CodeExec& mCodeExec;
+	RenderParts& mRenderParts;
+	ControlsIn& mControlsIn;
+	uint32 mFrameNumber = 0;
+	std::vector<PlayingAudio> mPlayingAudio;
+
+	static thread_local SimulationContext* mBoundContext;
+};
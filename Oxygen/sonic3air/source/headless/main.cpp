@@ -0,0 +1,65 @@
+/*
+*	Part of the Oxygen Engine / Sonic 3 A.I.R. software distribution.
+*	Copyright (C) 2017-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "sonic3air/pch.h"
+#include "sonic3air/EngineDelegate.h"
+
+#include "oxygen/application/HeadlessRunner.h"
+#include "oxygen/base/PlatformFunctions.h"
+
+
+// See the regular "main.cpp" for why this is here
+#ifndef pathconf
+long pathconf(const char* path, int name)
+{
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+
+int main(int argc, char** argv)
+{
+	EngineMain::earlySetup();
+
+	HeadlessRunner::Options options;
+	if (!HeadlessRunner::readArguments(argc, argv, options))
+	{
+		HeadlessRunner::printUsage();
+		return 1;
+	}
+
+	// Make sure we're in the correct working directory
+	//  -> Paths given as arguments must be resolved before, as they are relative to the original working directory
+	HeadlessRunner::makePathsAbsolute(options);
+	if (argc > 0)
+	{
+		WString wstr;
+		wstr.fromUTF8(std::string(argv[0]));
+		PlatformFunctions::changeWorkingDirectory(wstr.toStdWString());
+	}
+
+	bool success = false;
+	try
+	{
+		// Create engine delegate and engine main instance
+		EngineDelegate myDelegate;
+		EngineMain myMain(myDelegate);
+
+		// Run the simulation without window, audio and frame pacing
+		HeadlessRunner headlessRunner(options);
+		success = myMain.executeHeadless(argc, argv, headlessRunner);
+		headlessRunner.printResult();
+	}
+	catch (const std::exception& e)
+	{
+		RMX_ERROR("Caught unhandled exception in headless runner: " << e.what(), );
+	}
+
+	return success ? 0 : 1;
+}
@@ -232,7 +232,9 @@ OptionsMenu::OptionsMenu(MenuBackground& menuBackground) :
 			.addOption("Auto (Default)", -1)
 			.addOption("Disabled", 0)
 			.addOption("Basic", 1)
-			.addOption("Full", 3);
+			.addOption("Full", 3)
+			.addOption("Full + Registers", 4)
+			.addOption("Full + JIT", 5);
 
 		entries.addEntry<AdvancedOptionMenuEntry>()
 			.setDefaultValue(-1)
@@ -29,6 +29,8 @@
 #include <map>
 #include <unordered_map>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 // Libraries
 #include "rmxbase/_jsoncpp/json/json.h"	// Uses its own namespace "Json"
@@ -61,6 +63,7 @@
 #include "rmxbase/FileCrawler.h"
 #include "rmxbase/JsonHelper.h"
 #include "rmxbase/InputStream.h"
+#include "rmxbase/FileView.h"
 #include "rmxbase/OutputStream.h"
 #include "rmxbase/BinarySerializer.h"
 #include "rmxbase/VectorBinarySerializer.h"
@@ -69,6 +72,7 @@
 #include "rmxbase/Color.h"
 #include "rmxbase/BitmapCodecs.h"
 #include "rmxbase/Logging.h"
+#include "rmxbase/WorkerPool.h"
 
 
 // Library linking via pragma
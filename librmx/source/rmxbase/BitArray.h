@@ -83,6 +83,16 @@ public:
 		return mChunks[chunkIndex];
 	}
 
+	bool anyBitSetInBoth(const BitArray& other) const
+	{
+		for (size_t chunkIndex = 0; chunkIndex < NUM_CHUNKS; ++chunkIndex)
+		{
+			if (mChunks[chunkIndex] & other.mChunks[chunkIndex])
+				return true;
+		}
+		return false;
+	}
+
 	int getNextSetBit(size_t startIndex) const
 	{
 		RMX_ASSERT(startIndex < NUM_BITS, "Invalid index " << startIndex << " for bit array of size " << NUM_BITS);
@@ -8,9 +8,21 @@
 
 #include "../rmxbase.h"
 
-// For data decompression, either use zlib (which is faster) or alternatively the RmxDeflate class
+// For data decompression, either use zlib (which is faster and allows for streaming line by line) or alternatively the RmxDeflate class
 #define USE_ZLIB
 
+#if defined(USE_ZLIB)
+	#include "zlib.h"
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define PNG_FILTERS_SSE2
+	#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define PNG_FILTERS_NEON
+	#include <arm_neon.h>
+#endif
+
 
 namespace
 {
@@ -30,328 +42,599 @@ namespace
 		// Read as big endian
 		return ((uint32)pointer[0] << 24) + ((uint32)pointer[1] << 16) + ((uint32)pointer[2] << 8) + ((uint32)pointer[3]);
 	}
-}
 
 
-#define PNG_IHDR 0x49484452
-#define PNG_IDAT 0x49444154
-#define PNG_IEND 0x49454e44
-#define PNG_PLTE 0x504c5445
+	// Scalar filter implementations, used for 1 and 2 bytes per pixel, and as fallback
 
-const uint32 PNGSignature[2] = { 0x474e5089, 0x0a1a0a0d };
+	void unfilterSub_Scalar(uint8* line, int bytesPerLine, int bpp)
+	{
+		for (int i = bpp; i < bytesPerLine; ++i)
+		{
+			line[i] += line[i - bpp];
+		}
+	}
 
-// PNG header
-struct PNGHeader
-{
-	uint32 width;
-	uint32 height;
-	uint8  bitdepth;
-	uint8  colortype;
-	uint8  compression;
-	uint8  filter;
-	uint8  interlace;
-};
+	void unfilterAverage_Scalar(uint8* line, const uint8* previousLine, int bytesPerLine, int bpp)
+	{
+		for (int i = 0; i < bpp; ++i)
+		{
+			line[i] += previousLine[i] / 2;
+		}
+		for (int i = bpp; i < bytesPerLine; ++i)
+		{
+			line[i] += (line[i - bpp] + previousLine[i]) / 2;
+		}
+	}
 
-#define RETURN(errcode) \
-{ \
-	outResult.mError = errcode; \
-	return (errcode == Bitmap::LoadResult::Error::OK); \
-}
+	void unfilterPaeth_Scalar(uint8* line, const uint8* previousLine, int bytesPerLine, int bpp)
+	{
+		for (int i = 0; i < bpp; ++i)
+		{
+			line[i] += previousLine[i];
+		}
+		for (int i = bpp; i < bytesPerLine; ++i)
+		{
+			const uint8 left = line[i - bpp];
+			const uint8 up = previousLine[i];
+			const uint8 upLeft = previousLine[i - bpp];
+			const int paeth = left + up - upLeft;
+			const int d1 = abs(paeth - left);
+			const int d2 = abs(paeth - up);
+			const int d3 = abs(paeth - upLeft);
+			if ((d1 <= d2) && (d1 <= d3))
+				line[i] += left;
+			else if (d2 <= d3)
+				line[i] += up;
+			else
+				line[i] += upLeft;
+		}
+	}
 
+#if defined(PNG_FILTERS_SSE2)
 
+	// SSE2 filter implementations for 3 and 4 bytes per pixel
+	//  -> These work on one pixel at a time, as each pixel depends on its left neighbor, but handle all of its channels at once
 
-bool BitmapCodecPNG::canDecode(const String& format) const
-{
-	return (format == "png");
-}
+	inline __m128i loadPixel(const uint8* pointer, int bpp)
+	{
+		uint32 value = 0;
+		memcpy(&value, pointer, bpp);
+		return _mm_cvtsi32_si128((int)value);
+	}
 
-bool BitmapCodecPNG::canEncode(const String& format) const
-{
-	return (format == "png");
-}
+	inline void storePixel(uint8* pointer, __m128i pixel, int bpp)
+	{
+		const uint32 value = (uint32)_mm_cvtsi128_si32(pixel);
+		memcpy(pointer, &value, bpp);
+	}
 
-bool BitmapCodecPNG::decode(Bitmap& bitmap, InputStream& stream, Bitmap::LoadResult& outResult)
-{
-	// Load from PNG image data in memory
-	MemInputStream mstream(stream);
-	if (mstream.getRemaining() < 8)
-		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
+	template<int BPP>
+	void unfilterSub_SSE2(uint8* line, int bytesPerLine)
+	{
+		__m128i current = _mm_setzero_si128();
+		for (int i = 0; i < bytesPerLine; i += BPP)
+		{
+			current = _mm_add_epi8(loadPixel(&line[i], BPP), current);
+			storePixel(&line[i], current, BPP);
+		}
+	}
 
-	const uint8* mem = mstream.getCursor();
-	const uint8* end = mstream.getCursor() + mstream.getRemaining();
-	if (memcmp(mem, PNGSignature, 8) != 0)
-		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
-	mem += 8;
+	template<int BPP>
+	void unfilterAverage_SSE2(uint8* line, const uint8* previousLine, int bytesPerLine)
+	{
+		const __m128i ones = _mm_set1_epi8(1);
+		__m128i current = _mm_setzero_si128();
+		for (int i = 0; i < bytesPerLine; i += BPP)
+		{
+			const __m128i left = current;
+			const __m128i up = loadPixel(&previousLine[i], BPP);
 
-	// Read header
-	PNGHeader header;
-	int width = 0;
-	int height = 0;
-	uint32 palette[0x100];
-	int palette_size = 0;
-
-	// Temporary buffer for the image data
-	std::vector<uint8> content;
-	content.reserve(mstream.getRemaining());
-
-	// Read chunks
-	bool finished = false;
-	while (!finished)
+			// "_mm_avg_epu8" rounds up, but the filter needs rounding down
+			__m128i average = _mm_avg_epu8(left, up);
+			average = _mm_sub_epi8(average, _mm_and_si128(_mm_xor_si128(left, up), ones));
+
+			current = _mm_add_epi8(loadPixel(&line[i], BPP), average);
+			storePixel(&line[i], current, BPP);
+		}
+	}
+
+	template<int BPP>
+	void unfilterPaeth_SSE2(uint8* line, const uint8* previousLine, int bytesPerLine)
 	{
-		// Length & chunk type
-		if ((size_t)(end - mem) < 8)
-			RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
+		// Calculations are done with 16-bit values
+		const __m128i zero = _mm_setzero_si128();
+		__m128i left = zero;
+		__m128i up = zero;
+		for (int i = 0; i < bytesPerLine; i += BPP)
+		{
+			const __m128i upLeft = up;
+			up = _mm_unpacklo_epi8(loadPixel(&previousLine[i], BPP), zero);
+
+			// Distances to the predictor "left + up - upLeft"
+			__m128i d1 = _mm_sub_epi16(up, upLeft);
+			__m128i d2 = _mm_sub_epi16(left, upLeft);
+			__m128i d3 = _mm_add_epi16(d1, d2);
+			d1 = _mm_max_epi16(d1, _mm_sub_epi16(zero, d1));
+			d2 = _mm_max_epi16(d2, _mm_sub_epi16(zero, d2));
+			d3 = _mm_max_epi16(d3, _mm_sub_epi16(zero, d3));
+
+			// Select the nearest, preferring left over up over upLeft
+			const __m128i smallest = _mm_min_epi16(d3, _mm_min_epi16(d1, d2));
+			const __m128i useLeft = _mm_cmpeq_epi16(smallest, d1);
+			const __m128i useUp = _mm_cmpeq_epi16(smallest, d2);
+			const __m128i upOrUpLeft = _mm_or_si128(_mm_and_si128(useUp, up), _mm_andnot_si128(useUp, upLeft));
+			const __m128i nearest = _mm_or_si128(_mm_and_si128(useLeft, left), _mm_andnot_si128(useLeft, upOrUpLeft));
+
+			// Add per byte, so that the result wraps around like 8-bit values do
+			left = _mm_add_epi8(_mm_unpacklo_epi8(loadPixel(&line[i], BPP), zero), nearest);
+			storePixel(&line[i], _mm_packus_epi16(left, left), BPP);
+		}
+	}
 
-		const uint8* chunkStart = mem;
-		const uint32 length = readUint32BE(mem);
-		const uint32 type   = readUint32BE(mem + 4);
-		mem += 8;
-		if ((size_t)(end - mem) < length + 4)
-			RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
+#elif defined(PNG_FILTERS_NEON)
+
+	// NEON filter implementations for 3 and 4 bytes per pixel
+	//  -> These work on one pixel at a time, as each pixel depends on its left neighbor, but handle all of its channels at once
+
+	inline uint8x8_t loadPixel(const uint8* pointer, int bpp)
+	{
+		uint64_t value = 0;
+		memcpy(&value, pointer, bpp);
+		return vcreate_u8(value);
+	}
 
-		switch (type)
+	inline void storePixel(uint8* pointer, uint8x8_t pixel, int bpp)
+	{
+		const uint64_t value = vget_lane_u64(vreinterpret_u64_u8(pixel), 0);
+		memcpy(pointer, &value, bpp);
+	}
+
+	template<int BPP>
+	void unfilterSub_NEON(uint8* line, int bytesPerLine)
+	{
+		uint8x8_t current = vdup_n_u8(0);
+		for (int i = 0; i < bytesPerLine; i += BPP)
 		{
-			// IHDR
-			case PNG_IHDR:
+			current = vadd_u8(loadPixel(&line[i], BPP), current);
+			storePixel(&line[i], current, BPP);
+		}
+	}
+
+	template<int BPP>
+	void unfilterAverage_NEON(uint8* line, const uint8* previousLine, int bytesPerLine)
+	{
+		uint8x8_t current = vdup_n_u8(0);
+		for (int i = 0; i < bytesPerLine; i += BPP)
+		{
+			// "vhadd_u8" rounds down, just as the filter needs it
+			const uint8x8_t average = vhadd_u8(current, loadPixel(&previousLine[i], BPP));
+			current = vadd_u8(loadPixel(&line[i], BPP), average);
+			storePixel(&line[i], current, BPP);
+		}
+	}
+
+	template<int BPP>
+	void unfilterPaeth_NEON(uint8* line, const uint8* previousLine, int bytesPerLine)
+	{
+		uint8x8_t left = vdup_n_u8(0);
+		uint8x8_t up = vdup_n_u8(0);
+		for (int i = 0; i < bytesPerLine; i += BPP)
+		{
+			const uint8x8_t upLeft = up;
+			up = loadPixel(&previousLine[i], BPP);
+
+			// Distances to the predictor "left + up - upLeft"
+			const uint16x8_t d1 = vmovl_u8(vabd_u8(up, upLeft));
+			const uint16x8_t d2 = vmovl_u8(vabd_u8(left, upLeft));
+			const uint16x8_t d3 = vabdq_u16(vaddl_u8(left, up), vshll_n_u8(upLeft, 1));
+
+			// Select the nearest, preferring left over up over upLeft
+			const uint8x8_t useLeft = vmovn_u16(vandq_u16(vcleq_u16(d1, d2), vcleq_u16(d1, d3)));
+			const uint8x8_t useUp = vmovn_u16(vcleq_u16(d2, d3));
+			const uint8x8_t nearest = vbsl_u8(useLeft, left, vbsl_u8(useUp, up, upLeft));
+
+			left = vadd_u8(loadPixel(&line[i], BPP), nearest);
+			storePixel(&line[i], left, BPP);
+		}
+	}
+
+#endif
+
+	void unfilterLine(uint8 filter, uint8* line, const uint8* previousLine, int bytesPerLine, int bpp)
+	{
+		switch (filter)
+		{
+			// "Sub" filter
+			case 1:
 			{
-				if (length != 13)
-					RETURN(Bitmap::LoadResult::Error::FILE_ERROR);
-				memcpy(&header, mem, length);
-				width = swapBytes32(header.width);
-				height = swapBytes32(header.height);
+			#if defined(PNG_FILTERS_SSE2)
+				if (bpp == 4)  { unfilterSub_SSE2<4>(line, bytesPerLine); break; }
+				if (bpp == 3)  { unfilterSub_SSE2<3>(line, bytesPerLine); break; }
+			#elif defined(PNG_FILTERS_NEON)
+				if (bpp == 4)  { unfilterSub_NEON<4>(line, bytesPerLine); break; }
+				if (bpp == 3)  { unfilterSub_NEON<3>(line, bytesPerLine); break; }
+			#endif
+				unfilterSub_Scalar(line, bytesPerLine, bpp);
 				break;
 			}
 
-			// IEND
-			case PNG_IEND:
+			// "Up" filter
+			case 2:
 			{
-				finished = true;
+				// This one has no dependency between pixels, so leave the vectorization to the compiler
+				for (int i = 0; i < bytesPerLine; ++i)
+				{
+					line[i] += previousLine[i];
+				}
 				break;
 			}
 
-			// IDAT
-			case PNG_IDAT:
+			// "Average" filter
+			case 3:
 			{
-				const size_t position = content.size();
-				content.resize(position + length);
-				memcpy(&content[position], &mem[0], length);
+			#if defined(PNG_FILTERS_SSE2)
+				if (bpp == 4)  { unfilterAverage_SSE2<4>(line, previousLine, bytesPerLine); break; }
+				if (bpp == 3)  { unfilterAverage_SSE2<3>(line, previousLine, bytesPerLine); break; }
+			#elif defined(PNG_FILTERS_NEON)
+				if (bpp == 4)  { unfilterAverage_NEON<4>(line, previousLine, bytesPerLine); break; }
+				if (bpp == 3)  { unfilterAverage_NEON<3>(line, previousLine, bytesPerLine); break; }
+			#endif
+				unfilterAverage_Scalar(line, previousLine, bytesPerLine, bpp);
 				break;
 			}
 
-			// PLTE
-			case PNG_PLTE:
+			// "Paeth" filter
+			case 4:
 			{
-				palette_size = length / 3;
-				for (int i = 0; i < palette_size; ++i)
-					palette[i] = 0xff000000 + (readUint32LE(mem + i * 3) & 0xffffff);
-				for (int i = palette_size; i < 0x100; ++i)
-					palette[i] = 0x00000000;
+			#if defined(PNG_FILTERS_SSE2)
+				if (bpp == 4)  { unfilterPaeth_SSE2<4>(line, previousLine, bytesPerLine); break; }
+				if (bpp == 3)  { unfilterPaeth_SSE2<3>(line, previousLine, bytesPerLine); break; }
+			#elif defined(PNG_FILTERS_NEON)
+				if (bpp == 4)  { unfilterPaeth_NEON<4>(line, previousLine, bytesPerLine); break; }
+				if (bpp == 3)  { unfilterPaeth_NEON<3>(line, previousLine, bytesPerLine); break; }
+			#endif
+				unfilterPaeth_Scalar(line, previousLine, bytesPerLine, bpp);
 				break;
 			}
 		}
-
-		// CRC
-		const uint32 crc = rmx::getCRC32(chunkStart+4, length+4);
-		mem += length;
-		if (readUint32BE(mem) != crc)
-			RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
-		mem += 4;
-	}
-
-	// Check for empty image data
-	if (content.empty())
-		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
-
-	// This function supports only 8-bit depth, nothing else
-	if (header.bitdepth != 8)
-		RETURN(Bitmap::LoadResult::Error::UNSUPPORTED);
-
-	int bpp = 0;
-	switch (header.colortype)
-	{
-		case 0:  bpp = 1;  break;
-		case 2:  bpp = 3;  break;
-		case 3:  bpp = 1;  break;
-		case 4:  bpp = 2;  break;
-		case 6:  bpp = 4;  break;
-		default:
-			RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
 	}
-	const int bytesPerLine = width * bpp;
-
-	// Decompress image data
-#if !defined(USE_ZLIB)
-
-	int outsize = 0;
-	if ((content[0] & 15) != 8)		// Check zlib header for deflate algorithm
-		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
+}
 
-	uint8* output = Deflate::decode(outsize, &content[2], (int)content.size() - 2);		// Skip the zlib header
-	if (nullptr == output)
-		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
 
-#else
+#define PNG_IHDR 0x49484452
+#define PNG_IDAT 0x49444154
+#define PNG_IEND 0x49454e44
+#define PNG_PLTE 0x504c5445
 
-	std::vector<uint8> outputMemory;
-	outputMemory.reserve(bytesPerLine * height + 0x4000);	// 0x4000 is the internal chunk size used by "ZlibDeflate::decode"
-	if (!ZlibDeflate::decode(outputMemory, &content[0], content.size()))
-		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
+const uint32 PNGSignature[2] = { 0x474e5089, 0x0a1a0a0d };
 
-	uint8* output = &outputMemory[0];
-	const int outsize = (int)outputMemory.size();
+// PNG header
+struct PNGHeader
+{
+	uint32 width;
+	uint32 height;
+	uint8  bitdepth;
+	uint8  colortype;
+	uint8  compression;
+	uint8  filter;
+	uint8  interlace;
+};
 
-#endif
+#define RETURN(errcode) \
+{ \
+	outResult.mError = errcode; \
+	return (errcode == Bitmap::LoadResult::Error::OK); \
+}
 
-	// Create output bitmap
-	bitmap.create(width, height);
-	uint32* data = bitmap.getData();
 
-	// Remove the filter
-	int outpos = 0;
-	uint8* currentLineBuffer = nullptr;		// Pointer to current line
-	for (int line = 0; line < height; ++line)
+namespace
+{
+	struct PNGContent
 	{
-		uint8* previousLineBuffer = currentLineBuffer;
-		if (line == 0)
-		{
-			// Misuse the last line (or parts of it) of the output as a temporary buffer storing zeroes
-			previousLineBuffer = (uint8*)&data[width * (height - 1)];
-			memset(previousLineBuffer, 0, width * bpp);
-		}
+		PNGHeader mHeader;
+		int mWidth = 0;
+		int mHeight = 0;
+		int mBytesPerPixel = 0;
+		uint32 mPalette[0x100] = { 0 };
+		int mPaletteSize = 0;
+		std::unique_ptr<MemInputStream> mInputData;						// Owns the input data if it had to be copied from a non-memory stream
+		std::vector<std::pair<const uint8*, uint32>> mImageDataChunks;	// Pointers into the input data, no copies
+	};
+
+	Bitmap::LoadResult::Error readChunks(InputStream& stream, PNGContent& outContent)
+	{
+		// Load from PNG image data in memory
+		//  -> The memory stream is kept in the content, as the image data chunks point into its buffer
+		outContent.mInputData = std::make_unique<MemInputStream>(stream);
+		MemInputStream& mstream = *outContent.mInputData;
+		if (mstream.getRemaining() < 8)
+			return Bitmap::LoadResult::Error::INVALID_FILE;
+
+		const uint8* mem = mstream.getCursor();
+		const uint8* end = mstream.getCursor() + mstream.getRemaining();
+		if (memcmp(mem, PNGSignature, 8) != 0)
+			return Bitmap::LoadResult::Error::INVALID_FILE;
+		mem += 8;
 
-		const uint8 filter = output[outpos];
-		currentLineBuffer = &output[outpos+1];
-		outpos += bytesPerLine + 1;
-		if (outpos > outsize)
-			RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
+		PNGHeader& header = outContent.mHeader;
+		memset(&header, 0, sizeof(header));
 
-		if (filter != 0)
+		// Read chunks
+		bool finished = false;
+		while (!finished)
 		{
-			uint8* buf = currentLineBuffer;
-			uint8* buf0 = previousLineBuffer;
-			const int leftPixelOffset = -bpp;
-			switch (filter)
+			// Length & chunk type
+			if ((size_t)(end - mem) < 8)
+				return Bitmap::LoadResult::Error::INVALID_FILE;
+
+			const uint8* chunkStart = mem;
+			const uint32 length = readUint32BE(mem);
+			const uint32 type   = readUint32BE(mem + 4);
+			mem += 8;
+			if ((size_t)(end - mem) < (size_t)length + 4)
+				return Bitmap::LoadResult::Error::INVALID_FILE;
+
+			switch (type)
 			{
-				// "Sub" filter
-				case 1:
+				// IHDR
+				case PNG_IHDR:
 				{
-					buf += bpp;
-					for (int i = bpp; i < bytesPerLine; ++i)
-					{
-						*buf += buf[leftPixelOffset];
-						++buf;
-					}
+					if (length != 13)
+						return Bitmap::LoadResult::Error::FILE_ERROR;
+					memcpy(&header, mem, length);
+					outContent.mWidth = swapBytes32(header.width);
+					outContent.mHeight = swapBytes32(header.height);
 					break;
 				}
 
-				// "Up" filter
-				case 2:
+				// IEND
+				case PNG_IEND:
 				{
-					for (int i = 0; i < bytesPerLine; ++i)
-					{
-						*buf += *buf0;
-						++buf;
-						++buf0;
-					}
+					finished = true;
 					break;
 				}
 
-				// "Average" filter
-				case 3:
+				// IDAT
+				case PNG_IDAT:
 				{
-					for (int i = 0; i < bpp; ++i)
-					{
-						*buf += *buf0 / 2;
-						++buf;
-						++buf0;
-					}
-					for (int i = bpp; i < bytesPerLine; ++i)
-					{
-						const uint8 left = buf[leftPixelOffset];
-						const uint8 up = *buf0;
-						*buf += (left + up) / 2;
-						++buf;
-						++buf0;
-					}
+					if (length > 0)
+						outContent.mImageDataChunks.emplace_back(mem, length);
 					break;
 				}
 
-				// "Paeth" filter
-				case 4:
+				// PLTE
+				case PNG_PLTE:
 				{
-					for (int i = 0; i < bpp; ++i)
-					{
-						*buf += *buf0;
-						++buf;
-						++buf0;
-					}
-					for (int i = bpp; i < bytesPerLine; ++i)
-					{
-						const uint8 left = buf[leftPixelOffset];
-						const uint8 up = *buf0;
-						const uint8 upLeft = buf0[leftPixelOffset];
-						const int paeth = left + up - upLeft;
-						const int d1 = abs(paeth - left);
-						const int d2 = abs(paeth - up);
-						const int d3 = abs(paeth - upLeft);
-						if ((d1 <= d2) && (d1 <= d3))
-							*buf += left;
-						else if (d2 <= d3)
-							*buf += up;
-						else
-							*buf += upLeft;
-						++buf;
-						++buf0;
-					}
+					outContent.mPaletteSize = std::min<int>(length / 3, 0x100);
+					for (int i = 0; i < outContent.mPaletteSize; ++i)
+						outContent.mPalette[i] = 0xff000000 + ((uint32)mem[i*3] + ((uint32)mem[i*3+1] << 8) + ((uint32)mem[i*3+2] << 16));
+					for (int i = outContent.mPaletteSize; i < 0x100; ++i)
+						outContent.mPalette[i] = 0x00000000;
 					break;
 				}
 			}
+
+			// CRC
+			const uint32 crc = rmx::getCRC32(chunkStart+4, length+4);
+			mem += length;
+			if (readUint32BE(mem) != crc)
+				return Bitmap::LoadResult::Error::INVALID_FILE;
+			mem += 4;
 		}
 
-		// Convert to 32-bit
+		// Check for empty image data
+		if (outContent.mImageDataChunks.empty() || outContent.mWidth <= 0 || outContent.mHeight <= 0)
+			return Bitmap::LoadResult::Error::INVALID_FILE;
+
+		// This function supports only 8-bit depth, nothing else
+		if (header.bitdepth != 8)
+			return Bitmap::LoadResult::Error::UNSUPPORTED;
+
+		switch (header.colortype)
 		{
-			const uint8* src = currentLineBuffer;
-			uint32* dst = &data[line*width];
-			switch (header.colortype)
-			{
-				// 8-bit grayscale
-				case 0:
-					for (int i = 0; i < width; ++i)
-						dst[i] = 0xff000000 + (0x010101 * src[i]);
-					break;
+			case 0:  outContent.mBytesPerPixel = 1;  break;
+			case 2:  outContent.mBytesPerPixel = 3;  break;
+			case 3:  outContent.mBytesPerPixel = 1;  break;
+			case 4:  outContent.mBytesPerPixel = 2;  break;
+			case 6:  outContent.mBytesPerPixel = 4;  break;
+			default:
+				return Bitmap::LoadResult::Error::INVALID_FILE;
+		}
+		return Bitmap::LoadResult::Error::OK;
+	}
 
-				// 24-bit RGB
-				case 2:
-					for (int i = 0; i < width; ++i)
-						dst[i] = 0xff000000 + (*(uint32*)(&src[i*3]) & 0x00ffffff);
-					break;
+	template<typename FUNC>
+	bool decodeLines(const PNGContent& content, FUNC lineFunction)
+	{
+		// Decompress and unfilter line by line, using only two line buffers: one for the current line, and one for the previous line
+		const int bytesPerLine = content.mWidth * content.mBytesPerPixel;
+		std::vector<uint8> lineBuffers((bytesPerLine + 1) * 2, 0);
+		uint8* currentLine = &lineBuffers[0];
+		uint8* previousLine = &lineBuffers[bytesPerLine + 1];	// Starts out as all zeroes, as needed for the first line
+
+	#if defined(USE_ZLIB)
+
+		z_stream strm;
+		strm.zalloc = nullptr;
+		strm.zfree = nullptr;
+		strm.opaque = nullptr;
+		strm.next_in = nullptr;
+		strm.avail_in = 0;
+		if (inflateInit(&strm) != Z_OK)
+			return false;
+
+		size_t nextChunkIndex = 0;
+		bool success = true;
+		for (int line = 0; line < content.mHeight && success; ++line)
+		{
+			// Inflate exactly one line, including its filter type byte
+			strm.next_out = currentLine;
+			strm.avail_out = bytesPerLine + 1;
+			while (strm.avail_out > 0)
+			{
+				if (strm.avail_in == 0)
+				{
+					// Continue with the next IDAT chunk
+					if (nextChunkIndex >= content.mImageDataChunks.size())
+					{
+						success = false;
+						break;
+					}
+					strm.next_in = (Bytef*)content.mImageDataChunks[nextChunkIndex].first;
+					strm.avail_in = content.mImageDataChunks[nextChunkIndex].second;
+					++nextChunkIndex;
+				}
 
-				// Palette image
-				case 3:
-					for (int i = 0; i < width; ++i)
-						dst[i] = palette[src[i]];
+				const int zlibResult = inflate(&strm, Z_NO_FLUSH);
+				if (zlibResult == Z_STREAM_END)
+				{
+					success = (strm.avail_out == 0);
 					break;
-
-				// 16-bit gray + alpha
-				case 4:
-					for (int i = 0; i < width; ++i)
-						dst[i] = (0x010101 * src[i*2]) + (src[i*2+1] << 24);
+				}
+				if (zlibResult != Z_OK && !(zlibResult == Z_BUF_ERROR && strm.avail_in == 0))
+				{
+					success = false;
 					break;
+				}
+			}
 
-				// 32-bit RGB + alpha
-				case 6:
-					memcpy(dst, src, width*4);
-					break;
+			if (success)
+			{
+				unfilterLine(currentLine[0], &currentLine[1], &previousLine[1], bytesPerLine, content.mBytesPerPixel);
+				lineFunction(line, &currentLine[1]);
+				std::swap(currentLine, previousLine);
 			}
 		}
+
+		inflateEnd(&strm);
+		return success;
+
+	#else
+
+		// Collect the image data chunks, to decompress all at once
+		std::vector<uint8> compressed;
+		for (const auto& chunk : content.mImageDataChunks)
+		{
+			compressed.insert(compressed.end(), chunk.first, chunk.first + chunk.second);
+		}
+		if (compressed.size() < 2 || (compressed[0] & 15) != 8)		// Check zlib header for deflate algorithm
+			return false;
+
+		int outsize = 0;
+		uint8* output = Deflate::decode(outsize, &compressed[2], (int)compressed.size() - 2);		// Skip the zlib header
+		if (nullptr == output)
+			return false;
+
+		bool success = ((int64)outsize >= (int64)(bytesPerLine + 1) * content.mHeight);
+		for (int line = 0; line < content.mHeight && success; ++line)
+		{
+			memcpy(currentLine, &output[(size_t)line * (bytesPerLine + 1)], bytesPerLine + 1);
+			unfilterLine(currentLine[0], &currentLine[1], &previousLine[1], bytesPerLine, content.mBytesPerPixel);
+			lineFunction(line, &currentLine[1]);
+			std::swap(currentLine, previousLine);
+		}
+		delete[] output;
+		return success;
+
+	#endif
 	}
+}
 
-#if !defined(USE_ZLIB)
-	delete[] output;
-#endif
+
+
+bool BitmapCodecPNG::canDecode(const String& format) const
+{
+	return (format == "png");
+}
+
+bool BitmapCodecPNG::canEncode(const String& format) const
+{
+	return (format == "png");
+}
+
+bool BitmapCodecPNG::decode(Bitmap& bitmap, InputStream& stream, Bitmap::LoadResult& outResult)
+{
+	PNGContent content;
+	const Bitmap::LoadResult::Error error = readChunks(stream, content);
+	if (error != Bitmap::LoadResult::Error::OK)
+		RETURN(error);
+
+	// Create output bitmap
+	const int width = content.mWidth;
+	bitmap.create(width, content.mHeight);
+	uint32* data = bitmap.getData();
+
+	// Decode and convert to 32-bit, line by line
+	const uint8 colorType = content.mHeader.colortype;
+	const bool success = decodeLines(content, [&](int line, const uint8* src)
+	{
+		uint32* dst = &data[line * width];
+		switch (colorType)
+		{
+			// 8-bit grayscale
+			case 0:
+				for (int i = 0; i < width; ++i)
+					dst[i] = 0xff000000 + (0x010101 * src[i]);
+				break;
+
+			// 24-bit RGB
+			case 2:
+				for (int i = 0; i < width; ++i)
+					dst[i] = 0xff000000 + (uint32)src[i*3] + ((uint32)src[i*3+1] << 8) + ((uint32)src[i*3+2] << 16);
+				break;
+
+			// Palette image
+			case 3:
+				for (int i = 0; i < width; ++i)
+					dst[i] = content.mPalette[src[i]];
+				break;
+
+			// 16-bit gray + alpha
+			case 4:
+				for (int i = 0; i < width; ++i)
+					dst[i] = (0x010101 * src[i*2]) + (src[i*2+1] << 24);
+				break;
+
+			// 32-bit RGB + alpha
+			case 6:
+				memcpy(dst, src, width*4);
+				break;
+		}
+	});
+
+	if (!success)
+		RETURN(Bitmap::LoadResult::Error::INVALID_FILE);
 	RETURN(Bitmap::LoadResult::Error::OK);
 }
 
+bool BitmapCodecPNG::decodeIndexed(InputStream& stream, std::vector<uint8>& outIndices, int& outWidth, int& outHeight, uint32* outPalette)
+{
+	PNGContent content;
+	if (readChunks(stream, content) != Bitmap::LoadResult::Error::OK)
+		return false;
+
+	// Only palette images can be decoded this way
+	if (content.mHeader.colortype != 3)
+		return false;
+
+	const int width = content.mWidth;
+	outIndices.resize((size_t)width * content.mHeight);
+	const bool success = decodeLines(content, [&](int line, const uint8* src)
+	{
+		memcpy(&outIndices[(size_t)line * width], src, width);
+	});
+	if (!success)
+		return false;
+
+	outWidth = width;
+	outHeight = content.mHeight;
+	if (nullptr != outPalette)
+	{
+		memcpy(outPalette, content.mPalette, sizeof(content.mPalette));
+	}
+	return true;
+}
+
 bool BitmapCodecPNG::encode(const Bitmap& bitmap, OutputStream& stream)
 {
 	// Save image data to memory in PNG format
@@ -31,6 +31,10 @@ public:
 
 class API_EXPORT BitmapCodecPNG : public IBitmapCodec
 {
+public:
+	// Decode a palette PNG into its 8-bit palette indices directly, without conversion to 32-bit colors; the palette has 0x100 entries
+	static bool decodeIndexed(InputStream& stream, std::vector<uint8>& outIndices, int& outWidth, int& outHeight, uint32* outPalette = nullptr);
+
 public:
 	bool canDecode(const String& format) const override;
 	bool canEncode(const String& format) const override;
@@ -16,6 +16,7 @@
 
 	#include <direct.h>
 	#include <io.h>
+	#include "../CleanWindowsInclude.h"
 
 #elif defined(PLATFORM_LINUX)
 	#include <filesystem>
@@ -58,6 +59,13 @@
 	#include <sys/stat.h>
 #endif
 
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_MAC) || defined(PLATFORM_ANDROID) || defined(PLATFORM_IOS)
+	#define USE_POSIX_MMAP
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
 
 namespace rmx
 {
@@ -301,6 +309,83 @@ namespace rmx
 		return true;
 	}
 
+	bool FileIO::mapFile(std::wstring_view filename, FileView& outFileView)
+	{
+	#if defined(PLATFORM_WINDOWS)
+		const HANDLE fileHandle = CreateFileW(std::wstring(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || (uint64)fileSize.QuadPart > (uint64)SIZE_MAX)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		if (fileSize.QuadPart == 0)
+		{
+			// Empty files can't be mapped
+			CloseHandle(fileHandle);
+			outFileView.clear();
+			return true;
+		}
+
+		// The mapped view stays valid after closing the handles
+		const HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* mappedData = (nullptr == mappingHandle) ? nullptr : MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (nullptr != mappingHandle)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		if (nullptr == mappedData)
+			return false;
+
+		const std::shared_ptr<const void> owner(mappedData, [](const void* data) { UnmapViewOfFile(data); });
+		outFileView = FileView(owner, (const uint8*)mappedData, (size_t)fileSize.QuadPart);
+		return true;
+
+	#elif defined(USE_POSIX_MMAP)
+		const int fileDescriptor = open(*WString(filename).toUTF8(), O_RDONLY);
+		if (fileDescriptor < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(fileDescriptor, &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+		{
+			close(fileDescriptor);
+			return false;
+		}
+
+		const size_t fileSize = (size_t)fileStat.st_size;
+		if (fileSize == 0)
+		{
+			// Empty files can't be mapped
+			close(fileDescriptor);
+			outFileView.clear();
+			return true;
+		}
+
+		// The mapping stays valid after closing the file descriptor
+		void* mappedData = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		close(fileDescriptor);
+		if (mappedData == MAP_FAILED)
+			return false;
+
+		const std::shared_ptr<const void> owner(mappedData, [fileSize](const void* data) { munmap(const_cast<void*>(data), fileSize); });
+		outFileView = FileView(owner, (const uint8*)mappedData, fileSize);
+		return true;
+
+	#else
+		// Fallback for platforms without memory-mapped files: Read into a buffer owned by the view
+		std::vector<uint8> buffer;
+		if (!readFile(filename, buffer))
+			return false;
+
+		outFileView = FileView::fromBuffer(std::move(buffer));
+		return true;
+	#endif
+	}
+
 	bool FileIO::saveFile(std::wstring_view filename, const void* data, size_t size)
 	{
 		// Create directory if needed
@@ -346,8 +431,18 @@ namespace rmx
 		std_filesystem::rename(fspathOld, fspathNew, errorCode);
 		return !errorCode;
 	#else
-		RMX_ASSERT(false, "Not implemented: FileIO::renameFile");
-		return false;
+		return (0 == std::rename(WString(oldFilename).toStdString().c_str(), WString(newFilename).toStdString().c_str()));
+	#endif
+	}
+
+	bool FileIO::removeFile(std::wstring_view filename)
+	{
+	#if defined(USE_STD_FILESYSTEM) && !defined(PLATFORM_MAC)
+		const std_filesystem::path fspath(filename);
+		std::error_code errorCode;
+		return std_filesystem::remove(fspath, errorCode) && !errorCode;
+	#else
+		return (0 == std::remove(WString(filename).toStdString().c_str()));
 	#endif
 	}
 
@@ -13,6 +13,8 @@ class InputStream;
 
 namespace rmx
 {
+	class FileView;
+
 
 	class API_EXPORT FileIO
 	{
@@ -31,10 +33,12 @@ namespace rmx
 		static bool getFileTime(std::wstring_view filename, time_t& outTime);
 
 		static bool readFile(std::wstring_view filename, std::vector<uint8>& outData);
+		static bool mapFile(std::wstring_view filename, FileView& outFileView);
 		static bool saveFile(std::wstring_view filename, const void* data, size_t size);
 		static InputStream* createInputStream(std::wstring_view filename);
 
 		static bool renameFile(const std::wstring& oldFilename, const std::wstring& newFilename);
+		static bool removeFile(std::wstring_view filename);
 
 		static void createDirectory(std::wstring_view path);
 		static void listFiles(std::wstring_view path, bool recursive, std::vector<FileEntry>& outFileEntries);
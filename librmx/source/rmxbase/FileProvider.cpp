@@ -20,4 +20,15 @@ namespace rmx
 		}
 	}
 
+	bool FileProvider::readFileView(const std::wstring& filename, FileView& outFileView)
+	{
+		// Default implementation for providers that don't have anything better to offer: Read into a buffer owned by the view
+		std::vector<uint8> buffer;
+		if (!readFile(filename, buffer))
+			return false;
+
+		outFileView = FileView::fromBuffer(std::move(buffer));
+		return true;
+	}
+
 }
@@ -12,6 +12,7 @@
 namespace rmx
 {
 	class FileSystem;
+	class FileView;
 
 
 	class API_EXPORT FileProvider
@@ -25,13 +26,20 @@ namespace rmx
 		virtual bool getFileSize(const std::wstring& filename, uint64& outFileSize)  { return false; }
 		virtual bool getFileTime(const std::wstring& filename, time_t& outFileTime)  { return false; }
 		virtual bool readFile(const std::wstring& filename, std::vector<uint8>& outData)  { return false; }
+		virtual bool readFileView(const std::wstring& filename, FileView& outFileView);
+		virtual bool mapFile(const std::wstring& filename, FileView& outFileView)  { return readFileView(filename, outFileView); }
 
 		virtual bool renameFile(const std::wstring& oldFilename, const std::wstring& newFilename)  { return false; }
+		virtual bool removeFile(const std::wstring& filename)  { return false; }
 		virtual bool listFiles(const std::wstring& path, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries)  { return false; }
 		virtual bool listFilesByMask(const std::wstring& filemask, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries)  { return false; }
 		virtual bool listDirectories(const std::wstring& path, std::vector<std::wstring>& outDirectories)  { return false; }
 		virtual InputStream* createInputStream(const std::wstring& filename)  { return nullptr; }
 
+		// Output the paths of all contained files, for providers whose content is known up-front and does not change (like packages)
+		//  -> This gets used by file systems for their path index; returns false if the provider can't be indexed (like the real file system)
+		virtual bool getIndexedFilePaths(std::vector<std::wstring>& outPaths)  { return false; }
+
 	protected:
 		std::set<FileSystem*> mRegisteredMountPointFileSystems;		// Usually just one
 	};
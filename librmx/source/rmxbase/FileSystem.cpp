@@ -9,9 +9,76 @@
 #include "../rmxbase.h"
 
 
+namespace
+{
+	uint64 getLowercasePathHash(const std::wstring& path)
+	{
+		static thread_local std::wstring lowercasePath;
+		lowercasePath = path;
+		for (wchar_t& character : lowercasePath)
+		{
+			if (character >= 'A' && character <= 'Z')
+				character += 32;
+		}
+		return rmx::getMurmur2_64(std::wstring_view(lowercasePath));
+	}
+}
+
+
 namespace rmx
 {
 
+	FileSystem::MountPointQuery::MountPointQuery(const MountState& mountState, const std::wstring& path, bool canBeDirectory) :
+		mMountState(mountState),
+		mPath(path)
+	{
+		// Directories are not part of the path index
+		if (path.empty() || path.back() == L'/')
+		{
+			mCheckAllMountPoints = true;
+			return;
+		}
+
+		const auto it = mountState.mPathIndex.find(getLowercasePathHash(path));
+		if (it != mountState.mPathIndex.end())
+		{
+			mIndexedMountPoint = it->second;
+		}
+		else if (canBeDirectory)
+		{
+			// Not an indexed file, but it could still be a directory inside any of the indexed mount points
+			mCheckAllMountPoints = true;
+		}
+	}
+
+	const std::wstring* FileSystem::MountPointQuery::getNextLocalPath(const MountPoint*& outMountPoint)
+	{
+		while (mNextIndex < mMountState.mMountPoints.size())
+		{
+			const size_t index = mNextIndex;
+			++mNextIndex;
+			const MountPoint& mountPoint = mMountState.mMountPoints[index];
+			if (mMountState.mIsIndexed[index] && !mCheckAllMountPoints)
+			{
+				// Skip indexed mount points that don't contain the path
+				if (index != mIndexedMountPoint)
+					continue;
+
+				// In case the file provider still fails (which can happen with case-sensitive providers, or hash collisions), go on with all other mount points as usual
+				mCheckAllMountPoints = true;
+			}
+
+			const std::wstring* localPath = applyMountPoint(mountPoint, mPath, mTempPath);
+			if (nullptr != localPath)
+			{
+				outMountPoint = &mountPoint;
+				return localPath;
+			}
+		}
+		return nullptr;
+	}
+
+
 	FileSystem::FileSystem()
 	{
 		// By default, add a real file provider with mounted at root
@@ -21,13 +88,13 @@ namespace rmx
 	FileSystem::~FileSystem()
 	{
 		// Unregister from the file providers
-		for (size_t k = 0; k < mMountPoints.size(); ++k)
+		for (const MountPoint& mountPoint : mMountState->mMountPoints)
 		{
-			mMountPoints[k].mFileProvider->mRegisteredMountPointFileSystems.erase(this);
+			mountPoint.mFileProvider->mRegisteredMountPointFileSystems.erase(this);
 		}
 
 		// Clear the mount points before destroying the managed file provider, so that the calls to "addManagedFileProvider" made by the file provider descructors won't need to do anything
-		mMountPoints.clear();
+		mMountState = std::make_shared<MountState>();
 
 		// Destroy the managed file provider
 		for (FileProvider* fileProvider : mManagedFileProviders)
@@ -39,31 +106,31 @@ namespace rmx
 
 	bool FileSystem::exists(std::wstring_view path)
 	{
-		mTempPath2 = normalizePath(path, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(path, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath, true);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
-			if (nullptr != localPath)
-			{
-				if (mountPoint.mFileProvider->exists(*localPath))
-					return true;
-			}
+			if (mountPoint->mFileProvider->exists(*localPath))
+				return true;
 		}
 		return false;
 	}
 
 	uint64 FileSystem::getFileSize(std::wstring_view filename)
 	{
-		mTempPath2 = normalizePath(filename, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
-			if (nullptr != localPath)
-			{
-				uint64 fileSize = 0;
-				if (mountPoint.mFileProvider->getFileSize(*localPath, fileSize))
-					return fileSize;
-			}
+			uint64 fileSize = 0;
+			if (mountPoint->mFileProvider->getFileSize(*localPath, fileSize))
+				return fileSize;
 		}
 		return 0;
 	}
@@ -71,30 +138,30 @@ namespace rmx
 	time_t FileSystem::getFileTime(std::wstring_view filename)
 	{
 		time_t time = 0;
-		mTempPath2 = normalizePath(filename, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
-			if (nullptr != localPath)
-			{
-				if (mountPoint.mFileProvider->getFileTime(*localPath, time))
-					return time;
-			}
+			if (mountPoint->mFileProvider->getFileTime(*localPath, time))
+				return time;
 		}
 		return time;
 	}
 
 	bool FileSystem::readFile(std::wstring_view filename, std::vector<uint8>& outData)
 	{
-		mTempPath2 = normalizePath(filename, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
-			if (nullptr != localPath)
-			{
-				if (mountPoint.mFileProvider->readFile(*localPath, outData))
-					return true;
-			}
+			if (mountPoint->mFileProvider->readFile(*localPath, outData))
+				return true;
 		}
 		return false;
 	}
@@ -102,39 +169,74 @@ namespace rmx
 	bool FileSystem::saveFile(std::wstring_view filename, const void* data, size_t size)
 	{
 		// TODO: Use file providers here as well
-		mTempPath2 = normalizePath(filename, mTempPath2, false);
-		return FileIO::saveFile(mTempPath2, data, size);
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		return FileIO::saveFile(normalizedPath, data, size);
 	}
 
 	InputStream* FileSystem::createInputStream(std::wstring_view filename)
 	{
-		mTempPath2 = normalizePath(filename, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
-			if (nullptr != localPath)
-			{
-				InputStream* stream = mountPoint.mFileProvider->createInputStream(*localPath);
-				if (nullptr != stream)
-					return stream;
-			}
+			InputStream* stream = mountPoint->mFileProvider->createInputStream(*localPath);
+			if (nullptr != stream)
+				return stream;
 		}
 		return nullptr;
 	}
 
+	bool FileSystem::readFileView(std::wstring_view filename, FileView& outFileView)
+	{
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
+		{
+			if (mountPoint->mFileProvider->readFileView(*localPath, outFileView))
+				return true;
+		}
+		return false;
+	}
+
+	bool FileSystem::mapFile(std::wstring_view filename, FileView& outFileView)
+	{
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		const std::shared_ptr<MountState> mountState = getMountState();
+		MountPointQuery query(*mountState, normalizedPath);
+		const MountPoint* mountPoint;
+		while (const std::wstring* localPath = query.getNextLocalPath(mountPoint))
+		{
+			if (mountPoint->mFileProvider->mapFile(*localPath, outFileView))
+				return true;
+		}
+		return false;
+	}
+
 	void FileSystem::createDirectory(std::wstring_view path)
 	{
 		// TODO: Use file providers here as well
-		mTempPath2 = normalizePath(path, mTempPath2, true);
-		FileIO::createDirectory(mTempPath2);
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(path, normalizedPath, true);
+		FileIO::createDirectory(normalizedPath);
 	}
 
 	void FileSystem::listFiles(std::wstring_view path, bool recursive, std::vector<rmx::FileIO::FileEntry>& outEntries)
 	{
-		mTempPath2 = normalizePath(path, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(path, normalizedPath, false);
+		std::wstring tempPath;
+		const std::shared_ptr<MountState> mountState = getMountState();
+		for (const MountPoint& mountPoint : mountState->mMountPoints)
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
+			const std::wstring* localPath = applyMountPoint(mountPoint, normalizedPath, tempPath);
 			if (nullptr != localPath)
 			{
 				mountPoint.mFileProvider->listFiles(*localPath, recursive, outEntries);
@@ -152,10 +254,13 @@ namespace rmx
 
 	void FileSystem::listFilesByMask(std::wstring_view filemask, bool recursive, std::vector<rmx::FileIO::FileEntry>& outEntries)
 	{
-		mTempPath2 = normalizePath(filemask, mTempPath2, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filemask, normalizedPath, false);
+		std::wstring tempPath;
+		const std::shared_ptr<MountState> mountState = getMountState();
+		for (const MountPoint& mountPoint : mountState->mMountPoints)
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
+			const std::wstring* localPath = applyMountPoint(mountPoint, normalizedPath, tempPath);
 			if (nullptr != localPath)
 			{
 				mountPoint.mFileProvider->listFilesByMask(*localPath, recursive, outEntries);
@@ -173,10 +278,13 @@ namespace rmx
 
 	void FileSystem::listDirectories(std::wstring_view path, std::vector<std::wstring>& outEntries)
 	{
-		mTempPath2 = normalizePath(path, mTempPath2, true);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(path, normalizedPath, true);
+		std::wstring tempPath;
+		const std::shared_ptr<MountState> mountState = getMountState();
+		for (const MountPoint& mountPoint : mountState->mMountPoints)
 		{
-			const std::wstring* localPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
+			const std::wstring* localPath = applyMountPoint(mountPoint, normalizedPath, tempPath);
 			if (nullptr != localPath)
 			{
 				mountPoint.mFileProvider->listDirectories(*localPath, outEntries);
@@ -185,9 +293,9 @@ namespace rmx
 			{
 				// Handle the special case that the mount point includes the given path
 				//  -> In this case, we want the mount point itself to act as a virtual directory
-				if (startsWith(mountPoint.mMountPoint, mTempPath2))
+				if (startsWith(mountPoint.mMountPoint, normalizedPath))
 				{
-					const size_t startPos = mTempPath2.size();
+					const size_t startPos = normalizedPath.size();
 					size_t endPos = startPos;
 					while (endPos < mountPoint.mMountPoint.size() && mountPoint.mMountPoint[endPos] != '/')
 					{
@@ -204,12 +312,15 @@ namespace rmx
 
 	bool FileSystem::renameFile(std::wstring_view oldFilename, std::wstring_view newFilename)
 	{
-		mTempPath2 = normalizePath(oldFilename, mTempPath2, false);
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(oldFilename, normalizedPath, false);
 		std::wstring newTempPath(newFilename);
 		normalizePath(newTempPath, false);
-		for (MountPoint& mountPoint : mMountPoints)
+		std::wstring tempPath;
+		const std::shared_ptr<MountState> mountState = getMountState();
+		for (const MountPoint& mountPoint : mountState->mMountPoints)
 		{
-			const std::wstring* oldLocalPath = applyMountPoint(mountPoint, mTempPath2, mTempPath);
+			const std::wstring* oldLocalPath = applyMountPoint(mountPoint, normalizedPath, tempPath);
 			if (nullptr != oldLocalPath)
 			{
 				std::wstring tempPathForMounting;
@@ -224,6 +335,24 @@ namespace rmx
 		return false;
 	}
 
+	bool FileSystem::removeFile(std::wstring_view filename)
+	{
+		std::wstring normalizedPath;
+		normalizedPath = normalizePath(filename, normalizedPath, false);
+		std::wstring tempPath;
+		const std::shared_ptr<MountState> mountState = getMountState();
+		for (const MountPoint& mountPoint : mountState->mMountPoints)
+		{
+			const std::wstring* localPath = applyMountPoint(mountPoint, normalizedPath, tempPath);
+			if (nullptr != localPath)
+			{
+				if (mountPoint.mFileProvider->removeFile(*localPath))
+					return true;
+			}
+		}
+		return false;
+	}
+
 	bool FileSystem::exists(std::string_view path)
 	{
 		return exists(String(path).toStdWString());
@@ -239,6 +368,11 @@ namespace rmx
 		return readFile(String(filename).toStdWString(), outData);
 	}
 
+	bool FileSystem::readFileView(std::string_view filename, FileView& outFileView)
+	{
+		return readFileView(String(filename).toStdWString(), outFileView);
+	}
+
 	bool FileSystem::saveFile(std::wstring_view filename, const std::vector<uint8>& data)
 	{
 		return saveFile(filename, data.empty() ? nullptr : &data[0], data.size());
@@ -267,12 +401,17 @@ namespace rmx
 	void FileSystem::clearMountPoints()
 	{
 		// This also removes the default real file provider -- this way you can get rid of it
-		mMountPoints.clear();
+		std::lock_guard<std::mutex> lock(mMountStateMutex);
+		mMountState = std::make_shared<MountState>();
 	}
 
 	void FileSystem::addMountPoint(FileProvider& fileProvider, std::wstring_view mountPoint, std::wstring_view prefixReplacement, int priority)
 	{
-		MountPoint& newMountPoint = vectorAdd(mMountPoints);
+		std::lock_guard<std::mutex> lock(mMountStateMutex);
+		std::shared_ptr<MountState> mountState = createModifiedMountState();
+		std::vector<MountPoint>& mountPoints = mountState->mMountPoints;
+
+		MountPoint& newMountPoint = vectorAdd(mountPoints);
 		newMountPoint.mFileProvider = &fileProvider;
 		newMountPoint.mPriority = priority;
 		if (!mountPoint.empty() || !prefixReplacement.empty())
@@ -283,7 +422,8 @@ namespace rmx
 		}
 
 		fileProvider.mRegisteredMountPointFileSystems.insert(this);
-		std::sort(mMountPoints.begin(), mMountPoints.end(), [](const MountPoint& a, const MountPoint& b) { return a.mPriority > b.mPriority; } );
+		std::sort(mountPoints.begin(), mountPoints.end(), [](const MountPoint& a, const MountPoint& b) { return a.mPriority > b.mPriority; } );
+		mMountState = mountState;
 	}
 
 	void FileSystem::normalizePath(std::wstring& path, bool isDirectory)
@@ -319,17 +459,73 @@ namespace rmx
 	void FileSystem::onFileProviderDestroyed(FileProvider& fileProvider)
 	{
 		// Remove all mount points of this file provider
-		for (size_t k = 0; k < mMountPoints.size(); ++k)
+		std::lock_guard<std::mutex> lock(mMountStateMutex);
+		std::shared_ptr<MountState> mountState = createModifiedMountState();
+		std::vector<MountPoint>& mountPoints = mountState->mMountPoints;
+		for (size_t k = 0; k < mountPoints.size(); ++k)
 		{
-			if (&fileProvider == mMountPoints[k].mFileProvider)
+			if (&fileProvider == mountPoints[k].mFileProvider)
 			{
-				mMountPoints.erase(mMountPoints.begin() + k);
+				mountPoints.erase(mountPoints.begin() + k);
 				--k;
 			}
 		}
+		mMountState = mountState;
+	}
+
+	std::shared_ptr<FileSystem::MountState> FileSystem::getMountState() const
+	{
+		std::shared_ptr<MountState> mountState;
+		{
+			std::lock_guard<std::mutex> lock(mMountStateMutex);
+			mountState = mMountState;
+		}
+
+		// The path index gets built only when actually needed, as there are usually multiple mount point changes in a row
+		std::call_once(mountState->mPathIndexBuilt, &FileSystem::buildPathIndex, std::ref(*mountState));
+		return mountState;
+	}
+
+	std::shared_ptr<FileSystem::MountState> FileSystem::createModifiedMountState() const
+	{
+		// Note that this must only be called while the mount state mutex is locked
+		std::shared_ptr<MountState> mountState = std::make_shared<MountState>();
+		if (mMountState)
+		{
+			mountState->mMountPoints = mMountState->mMountPoints;
+		}
+		return mountState;
+	}
+
+	void FileSystem::buildPathIndex(MountState& mountState)
+	{
+		std::vector<std::wstring> localPaths;
+		std::wstring path;
+		mountState.mIsIndexed.resize(mountState.mMountPoints.size(), false);
+		for (size_t index = 0; index < mountState.mMountPoints.size(); ++index)
+		{
+			const MountPoint& mountPoint = mountState.mMountPoints[index];
+			localPaths.clear();
+			if (!mountPoint.mFileProvider->getIndexedFilePaths(localPaths))
+				continue;
+
+			mountState.mIsIndexed[index] = true;
+			for (const std::wstring& localPath : localPaths)
+			{
+				// Convert into a path as seen from outside, i.e. the reverse of "applyMountPoint"
+				if (!startsWith(localPath, mountPoint.mPrefixReplacement))
+					continue;
+
+				path = localPath;
+				removeMountPointPath(mountPoint, path);
+
+				// Mount points are sorted by priority, so the first one to add a path is the one that counts
+				mountState.mPathIndex.emplace(getLowercasePathHash(path), index);
+			}
+		}
 	}
 
-	const std::wstring* FileSystem::applyMountPoint(const MountPoint& mountPoint, const std::wstring& inPath, std::wstring& tempPath) const
+	const std::wstring* FileSystem::applyMountPoint(const MountPoint& mountPoint, const std::wstring& inPath, std::wstring& tempPath)
 	{
 		// Check if path starts with the mount point
 		if (!mountPoint.mMountPoint.empty() && !startsWith(inPath, mountPoint.mMountPoint))
@@ -348,7 +544,7 @@ namespace rmx
 		}
 	}
 
-	void FileSystem::removeMountPointPath(const MountPoint& mountPoint, std::wstring& path) const
+	void FileSystem::removeMountPointPath(const MountPoint& mountPoint, std::wstring& path)
 	{
 		// Check if path starts with the mount point
 		if (!mountPoint.mPrefixReplacement.empty() && !startsWith(path, mountPoint.mPrefixReplacement))
@@ -14,8 +14,10 @@ class InputStream;
 namespace rmx
 {
 	class FileProvider;
+	class FileView;
 
 
+	// Note: Using the file system from multiple threads is supported, as long as the file providers' "exists", "readFile", etc. are thread-safe as well
 	class API_EXPORT FileSystem
 	{
 	friend class FileProvider;
@@ -32,17 +34,26 @@ namespace rmx
 		bool saveFile(std::wstring_view filename, const void* data, size_t size);
 		InputStream* createInputStream(std::wstring_view filename);
 
+		// Read a file without copying its contents, if the file provider supports it (e.g. for files inside a memory-mapped package)
+		bool readFileView(std::wstring_view filename, FileView& outFileView);
+
+		// Memory-map a file, meant for large container files like packages, of which only parts get accessed
+		//  -> Falls back to reading the file into a buffer for file providers that don't support this
+		bool mapFile(std::wstring_view filename, FileView& outFileView);
+
 		void createDirectory(std::wstring_view path);
 		void listFiles(std::wstring_view path, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries);
 		void listFilesByMask(std::wstring_view filemask, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries);
 		void listDirectories(std::wstring_view path, std::vector<std::wstring>& outDirectories);
 
 		bool renameFile(std::wstring_view oldFilename, std::wstring_view newFilename);
+		bool removeFile(std::wstring_view filename);
 
 		// Wrapper functions
 		bool exists(std::string_view path);
 		uint64 getFileSize(std::string_view filename);
 		bool readFile(std::string_view filename, std::vector<uint8>& outData);
+		bool readFileView(std::string_view filename, FileView& outFileView);
 		bool saveFile(std::wstring_view filename, const std::vector<uint8>& data);
 		bool saveFile(std::string_view filename, const std::vector<uint8>& data);
 		bool saveFile(std::string_view filename, const void* data, size_t size);
@@ -74,19 +85,46 @@ namespace rmx
 			bool mNeedsPrefixConversion = false;	// Set if mount point and prefix replacement are different
 		};
 
+		// Mount points together with the path index built from them
+		//  -> Gets replaced as a whole when mount points change, so that other threads can continue using the old one in the meantime
+		struct MountState
+		{
+			std::vector<MountPoint> mMountPoints;			// Sorted by priority, highest first
+			std::vector<bool> mIsIndexed;					// One flag per mount point, set if all of its files are part of the path index
+			std::unordered_map<uint64, size_t> mPathIndex;	// Maps the lowercase hash of each indexed file path to the highest priority indexed mount point containing it
+			std::once_flag mPathIndexBuilt;
+		};
+
+		// Iterates over the mount points that can possibly contain a file, using the path index
+		struct MountPointQuery
+		{
+			MountPointQuery(const MountState& mountState, const std::wstring& path, bool canBeDirectory = false);
+			const std::wstring* getNextLocalPath(const MountPoint*& outMountPoint);
+
+			const MountState& mMountState;
+			const std::wstring& mPath;
+			std::wstring mTempPath;
+			size_t mNextIndex = 0;
+			size_t mIndexedMountPoint = (size_t)-1;		// Index of the mount point found via the path index, or -1 if there's none
+			bool mCheckAllMountPoints = false;			// If set, the path index is not used (anymore)
+		};
+
 	private:
 		void onFileProviderDestroyed(FileProvider& fileProvider);
 
-		const std::wstring* applyMountPoint(const MountPoint& mountPoint, const std::wstring& inPath, std::wstring& tempPath) const;
-		void removeMountPointPath(const MountPoint& mountPoint, std::wstring& path) const;
+		std::shared_ptr<MountState> getMountState() const;
+		std::shared_ptr<MountState> createModifiedMountState() const;
+		static void buildPathIndex(MountState& mountState);
+
+		static const std::wstring* applyMountPoint(const MountPoint& mountPoint, const std::wstring& inPath, std::wstring& tempPath);
+		static void removeMountPointPath(const MountPoint& mountPoint, std::wstring& path);
 
 	private:
 		RealFileProvider mDefaultRealFileProvider;
 		std::set<FileProvider*> mManagedFileProviders;	// List of file providers that get deleted automatically with this file system -- though file providers that have mount points here can be managed outside as well, they're not in this list then
-		std::vector<MountPoint> mMountPoints;
 
-		mutable std::wstring mTempPath;		// Only for temporary internal use
-		mutable std::wstring mTempPath2;	// Only for temporary internal use
+		std::shared_ptr<MountState> mMountState;
+		mutable std::mutex mMountStateMutex;		// Protects the "mMountState" pointer itself, not its contents
 	};
 
 }
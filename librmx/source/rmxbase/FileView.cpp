@@ -0,0 +1,56 @@
+/*
+*	rmx Library
+*	Copyright (C) 2008-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "../rmxbase.h"
+
+
+namespace
+{
+	static const uint8 EMPTY_DATA = 0;	// Memory input streams don't accept a null pointer, not even for empty data
+}
+
+
+namespace rmx
+{
+
+	FileView FileView::fromBuffer(std::vector<uint8>&& buffer)
+	{
+		std::shared_ptr<std::vector<uint8>> owner = std::make_shared<std::vector<uint8>>(std::move(buffer));
+		return FileView(owner, owner->data(), owner->size());
+	}
+
+	FileView::FileView(const std::shared_ptr<const void>& owner, const uint8* data, size_t size) :
+		mOwner(owner),
+		mData(data),
+		mSize(size)
+	{
+	}
+
+	FileView FileView::getSubView(size_t offset, size_t size) const
+	{
+		if (offset > mSize || size > mSize - offset)
+			return FileView();
+
+		return FileView(mOwner, mData + offset, size);
+	}
+
+	void FileView::clear()
+	{
+		mOwner.reset();
+		mData = nullptr;
+		mSize = 0;
+	}
+
+}
+
+
+FileViewInputStream::FileViewInputStream(const rmx::FileView& fileView) :
+	MemInputStream(fileView.empty() ? &EMPTY_DATA : fileView.getData(), fileView.getSize()),
+	mFileView(fileView)
+{
+}
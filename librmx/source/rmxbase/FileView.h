@@ -0,0 +1,54 @@
+/*
+*	rmx Library
+*	Copyright (C) 2008-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+
+namespace rmx
+{
+
+	// Read-only view on file contents, which keeps the underlying memory alive for as long as there's a view referencing it
+	//  -> That memory can be a memory-mapped file, or a buffer owned by the view
+	class API_EXPORT FileView
+	{
+	public:
+		static FileView fromBuffer(std::vector<uint8>&& buffer);
+
+	public:
+		FileView() {}
+		FileView(const std::shared_ptr<const void>& owner, const uint8* data, size_t size);
+
+		inline bool empty() const			{ return (mSize == 0); }
+		inline const uint8* getData() const	{ return mData; }
+		inline size_t getSize() const		{ return mSize; }
+
+		// Returns a view on a part of the data, sharing ownership with this view; or an empty view if the range is invalid
+		FileView getSubView(size_t offset, size_t size) const;
+
+		void clear();
+
+	private:
+		std::shared_ptr<const void> mOwner;
+		const uint8* mData = nullptr;
+		size_t mSize = 0;
+	};
+
+}
+
+
+// Input from a file view, which gets kept alive by the stream
+class API_EXPORT FileViewInputStream : public MemInputStream
+{
+public:
+	explicit FileViewInputStream(const rmx::FileView& fileView);
+
+	const char* getType() const override  { return "fileview"; }
+
+private:
+	rmx::FileView mFileView;
+};
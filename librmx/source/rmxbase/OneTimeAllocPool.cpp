@@ -47,4 +47,12 @@ namespace rmx
 		mRemainingSize -= bytes;
 		return ptr;
 	}
+
+	void OneTimeAllocPool::swap(OneTimeAllocPool& other)
+	{
+		std::swap(mPages, other.mPages);
+		std::swap(mPageSize, other.mPageSize);
+		std::swap(mNextAllocationPointer, other.mNextAllocationPointer);
+		std::swap(mRemainingSize, other.mRemainingSize);
+	}
 }
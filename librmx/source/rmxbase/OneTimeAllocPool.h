@@ -23,6 +23,8 @@ namespace rmx
 		void clear();
 		uint8* allocateMemory(size_t bytes);
 
+		void swap(OneTimeAllocPool& other);
+
 	private:
 		struct Page
 		{
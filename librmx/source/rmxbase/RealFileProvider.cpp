@@ -32,11 +32,21 @@ namespace rmx
 		return FileIO::readFile(filename, outData);
 	}
 
+	bool RealFileProvider::mapFile(const std::wstring& filename, FileView& outFileView)
+	{
+		return FileIO::mapFile(filename, outFileView);
+	}
+
 	bool RealFileProvider::renameFile(const std::wstring& oldFilename, const std::wstring& newFilename)
 	{
 		return FileIO::renameFile(oldFilename, newFilename);
 	}
 
+	bool RealFileProvider::removeFile(const std::wstring& filename)
+	{
+		return FileIO::removeFile(filename);
+	}
+
 	bool RealFileProvider::listFiles(const std::wstring& path, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries)
 	{
 		FileIO::listFiles(path, recursive, outFileEntries);
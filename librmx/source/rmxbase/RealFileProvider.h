@@ -21,8 +21,10 @@ namespace rmx
 		bool getFileSize(const std::wstring& filename, uint64& outFileSize) override;
 		bool getFileTime(const std::wstring& filename, time_t& outFileTime) override;
 		bool readFile(const std::wstring& filename, std::vector<uint8>& outData) override;
+		bool mapFile(const std::wstring& filename, FileView& outFileView) override;
 		
 		bool renameFile(const std::wstring& oldFilename, const std::wstring& newFilename) override;
+		bool removeFile(const std::wstring& filename) override;
 		bool listFiles(const std::wstring& path, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries) override;
 		bool listFilesByMask(const std::wstring& filemask, bool recursive, std::vector<FileIO::FileEntry>& outFileEntries) override;
 		bool listDirectories(const std::wstring& path, std::vector<std::wstring>& outDirectories) override;
@@ -40,3 +40,52 @@ private:
 };
 
 template<typename CLASS> CLASS* SingleInstance<CLASS>::mSingleInstance = nullptr;
+
+
+// Like "SingleInstance", but a thread can bind its own instance to be returned by "instance()" calls from that thread
+//  -> Threads without a bound instance get the primary instance, which is the first one created
+template<class CLASS> class ThreadLocalInstance
+{
+public:
+	static bool hasInstance()
+	{
+		return (mThreadInstance != nullptr) || (mPrimaryInstance != nullptr);
+	}
+
+	static CLASS& instance()
+	{
+		return (mThreadInstance != nullptr) ? *mThreadInstance : *mPrimaryInstance;
+	}
+
+	static bool hasThreadInstance()
+	{
+		return (mThreadInstance != nullptr);
+	}
+
+	static void setThreadInstance(CLASS* instance)
+	{
+		mThreadInstance = instance;
+	}
+
+protected:
+	ThreadLocalInstance()
+	{
+		if (mPrimaryInstance == nullptr)
+			mPrimaryInstance = static_cast<CLASS*>(this);
+	}
+
+	virtual ~ThreadLocalInstance()
+	{
+		if (mPrimaryInstance == static_cast<CLASS*>(this))
+			mPrimaryInstance = nullptr;
+		if (mThreadInstance == static_cast<CLASS*>(this))
+			mThreadInstance = nullptr;
+	}
+
+private:
+	static CLASS* mPrimaryInstance;
+	static thread_local CLASS* mThreadInstance;
+};
+
+template<typename CLASS> CLASS* ThreadLocalInstance<CLASS>::mPrimaryInstance = nullptr;
+template<typename CLASS> thread_local CLASS* ThreadLocalInstance<CLASS>::mThreadInstance = nullptr;
@@ -0,0 +1,115 @@
+/*
+*	rmx Library
+*	Copyright (C) 2008-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "../rmxbase.h"
+
+
+size_t WorkerPool::getDefaultNumWorkerThreads()
+{
+	return std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8) - 1;
+}
+
+WorkerPool::WorkerPool(size_t numWorkerThreads)
+{
+	mThreads.reserve(numWorkerThreads);
+	for (size_t k = 0; k < numWorkerThreads; ++k)
+	{
+		mThreads.emplace_back(&WorkerPool::workerThreadFunc, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mShutdown = true;
+	}
+	mStartCondition.notify_all();
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+void WorkerPool::execute(size_t numTasks, const TaskFunction& taskFunction)
+{
+	if (numTasks == 0)
+		return;
+
+	if (mThreads.empty() || numTasks == 1)
+	{
+		for (size_t index = 0; index < numTasks; ++index)
+		{
+			taskFunction(index);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTaskFunction = &taskFunction;
+		mNumTasks = numTasks;
+		mNextTask = 0;
+		++mGeneration;
+	}
+	mStartCondition.notify_all();
+
+	processTasks(taskFunction, numTasks);
+
+	// All tasks are handed out now, wait for the ones still running on worker threads
+	//  -> Worker threads waking up only after this won't find anything to do any more
+	std::unique_lock<std::mutex> lock(mMutex);
+	mFinishedCondition.wait(lock, [&] { return mActiveWorkers == 0; });
+	mTaskFunction = nullptr;
+	mNumTasks = 0;
+}
+
+void WorkerPool::workerThreadFunc()
+{
+	uint32 lastGeneration = 0;
+	while (true)
+	{
+		const TaskFunction* taskFunction = nullptr;
+		size_t numTasks = 0;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mStartCondition.wait(lock, [&] { return mShutdown || mGeneration != lastGeneration; });
+			if (mShutdown)
+				return;
+
+			lastGeneration = mGeneration;
+			if (nullptr == mTaskFunction)
+				continue;
+
+			taskFunction = mTaskFunction;
+			numTasks = mNumTasks;
+			++mActiveWorkers;
+		}
+
+		processTasks(*taskFunction, numTasks);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mActiveWorkers;
+			if (mActiveWorkers == 0)
+				mFinishedCondition.notify_one();
+		}
+	}
+}
+
+void WorkerPool::processTasks(const TaskFunction& taskFunction, size_t numTasks)
+{
+	while (true)
+	{
+		const size_t index = mNextTask++;
+		if (index >= numTasks)
+			break;
+
+		taskFunction(index);
+	}
+}
@@ -0,0 +1,54 @@
+/*
+*	rmx Library
+*	Copyright (C) 2008-2022 by Eukaryot
+*
+*	Published under the GNU GPLv3 open source software license, see license.txt
+*	or https://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+// Set of persistent worker threads for splitting up short, frequently repeated work (like rendering a frame) into tasks
+//  -> The calling thread works on tasks as well, so a pool with 0 worker threads simply executes everything on the calling thread
+class API_EXPORT WorkerPool
+{
+public:
+	typedef std::function<void(size_t)> TaskFunction;
+
+public:
+	// Number of worker threads to use by default, so that all hardware threads are busy (including the calling thread), but with a reasonable limit
+	static size_t getDefaultNumWorkerThreads();
+
+public:
+	explicit WorkerPool(size_t numWorkerThreads);
+	~WorkerPool();
+
+	inline size_t getNumThreads() const  { return mThreads.size() + 1; }
+
+	// Calls the task function once for each task index, and returns when all of them are done
+	void execute(size_t numTasks, const TaskFunction& taskFunction);
+
+private:
+	void workerThreadFunc();
+	void processTasks(const TaskFunction& taskFunction, size_t numTasks);
+
+private:
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mStartCondition;
+	std::condition_variable mFinishedCondition;
+
+	const TaskFunction* mTaskFunction = nullptr;
+	size_t mNumTasks = 0;
+	std::atomic<size_t> mNextTask = 0;
+	size_t mActiveWorkers = 0;	// Number of worker threads currently processing tasks
+	uint32 mGeneration = 0;		// Gets increased with each call to "execute", so that worker threads can tell when there's new work
+	bool mShutdown = false;
+};